@@ -0,0 +1,1114 @@
+/**
+ * Benchmark of the plugin's hot paths - token parsing, Function construction,
+ * navigation, rendering, renaming, the function cache, sharding and config
+ * generation.
+ *
+ * The plugin modules are compiled against a fake IDA SDK (see
+ * fakesdk/fakesdk.h), so the benchmark runs on a plain machine without IDA.
+ * Decompiler outputs are the fixtures - either recorded RetDec JSON outputs
+ * (e.g. by retdec-decompiler --output-format json), or synthetic outputs
+ * generated by the benchmark. RetDec itself is not benchmarked, its times
+ * are in the plugin's trace (see trace.h).
+ *
+ * Config generation needs RetDec's config library - it is benchmarked only
+ * if the benchmark is built with it (RETDEC_BENCHMARK_CONFIG). Its fixtures
+ * are the functions, and synthetic global variables and types (see
+ * generateData()) - recorded outputs have no data.
+ *
+ * parseTokens() is compared with the former DOM parser, see
+ * legacyParseTokens(). Both must produce the same tokens for all the
+ * outputs, otherwise the benchmark fails.
+ *
+ * Usage:
+ *     retdec-benchmark [-i iterations] [-n functions] [-o results.json]
+ *             [output.json | directory ...]
+ *
+ * -i  Iterations of each suite (10).
+ * -n  Number of synthetic functions (200), used if no outputs are given.
+ * -o  Save the results as JSON.
+ * Directories are searched for *.json outputs (not recursively).
+ */
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <vector>
+
+#include <rapidjson/document.h>
+
+#include "fakesdk.h"
+
+#ifdef RETDEC_BENCHMARK_CONFIG
+#include "config.h"
+#endif
+#include "function.h"
+#include "functioncache.h"
+#include "shards.h"
+#include "token.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+/**
+ * Decompiler output of one benchmarked function.
+ */
+struct Fixture
+{
+    std::string name;
+    func_t* fnc = nullptr;
+    std::string output;
+    /// C source of the output, see sourceOf().
+    std::string source;
+};
+
+/**
+ * Results of one benchmark suite.
+ */
+struct SuiteResult
+{
+    std::string name;
+    /// Operations (functions, lines, ...) in one iteration.
+    std::size_t ops = 0;
+    /// Time of each iteration in microseconds.
+    std::vector<double> times;
+
+    double best() const
+    {
+        return *std::min_element(times.begin(), times.end());
+    }
+    double mean() const
+    {
+        double sum = 0.0;
+        for (double t : times)
+        {
+            sum += t;
+        }
+        return sum / times.size();
+    }
+};
+
+/**
+ * Keeps the benchmarked results alive, so that the work is not optimized out.
+ */
+volatile std::size_t sink = 0;
+
+/**
+ * Address of the former parser (retdec::common::Address) - hexadecimal with
+ * "0x" prefix, or decimal. Returns \c false if the string is not a valid
+ * address.
+ */
+bool legacyParseAddress(const std::string& str, ea_t& ea)
+{
+    bool hex = str.size() > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X');
+    const char* digits = str.c_str() + (hex ? 2 : 0);
+    if (*digits == '\0' || *digits == '-' || *digits == '+' || std::isspace(*digits))
+    {
+        return false;
+    }
+
+    char* end = nullptr;
+    unsigned long long val = std::strtoull(digits, &end, hex ? 16 : 10);
+    if (*end != '\0')
+    {
+        return false;
+    }
+
+    ea = ea_t(val);
+    return true;
+}
+
+/**
+ * Token parser of the plugin before the streaming parser - it builds the
+ * JSON document and then walks it. It is the reference for parseTokens().
+ */
+std::vector<Token> legacyParseTokens(const std::string& json, ea_t defaultEa)
+{
+    static const std::map<std::string, Token::Kind> kinds =
+    {
+        {"nl", Token::Kind::NEW_LINE},
+        {"ws", Token::Kind::WHITE_SPACE},
+        {"punc", Token::Kind::PUNCTUATION},
+        {"op", Token::Kind::OPERATOR},
+        {"i_gvar", Token::Kind::ID_GVAR},
+        {"i_lvar", Token::Kind::ID_LVAR},
+        {"i_mem", Token::Kind::ID_MEM},
+        {"i_lab", Token::Kind::ID_LAB},
+        {"i_fnc", Token::Kind::ID_FNC},
+        {"i_arg", Token::Kind::ID_ARG},
+        {"keyw", Token::Kind::KEYWORD},
+        {"type", Token::Kind::TYPE},
+        {"preproc", Token::Kind::PREPROCESSOR},
+        {"inc", Token::Kind::INCLUDE},
+        {"l_bool", Token::Kind::LITERAL_BOOL},
+        {"l_int", Token::Kind::LITERAL_INT},
+        {"l_fp", Token::Kind::LITERAL_FP},
+        {"l_str", Token::Kind::LITERAL_STR},
+        {"l_sym", Token::Kind::LITERAL_SYM},
+        {"l_ptr", Token::Kind::LITERAL_PTR},
+        {"cmnt", Token::Kind::COMMENT},
+    };
+
+    std::vector<Token> res;
+
+    rapidjson::StringStream rss(json.c_str());
+    rapidjson::Document d;
+    rapidjson::ParseResult ok = d.ParseStream(rss);
+    if (!ok)
+    {
+        return res;
+    }
+
+    auto tokens = d.FindMember("tokens");
+    if (tokens == d.MemberEnd() || !tokens->value.IsArray())
+    {
+        return res;
+    }
+
+    ea_t ea = defaultEa;
+
+    for (auto i = tokens->value.Begin(), e = tokens->value.End(); i != e; ++i)
+    {
+        auto& obj = *i;
+        if (!obj.IsObject())
+        {
+            continue;
+        }
+
+        auto addr = obj.FindMember("addr");
+        if (addr != obj.MemberEnd() && addr->value.IsString())
+        {
+            if (!legacyParseAddress(addr->value.GetString(), ea))
+            {
+                ea = defaultEa;
+            }
+        }
+        auto kind = obj.FindMember("kind");
+        auto val = obj.FindMember("val");
+        if (kind != obj.MemberEnd() && kind->value.IsString()
+            && val != obj.MemberEnd() && val->value.IsString())
+        {
+            auto k = kinds.find(kind->value.GetString());
+            if (k == kinds.end())
+            {
+                continue;
+            }
+
+            res.emplace_back(Token(
+                    k->second,
+                    ea,
+                    std::string(
+                            val->value.GetString(),
+                            val->value.GetStringLength())));
+        }
+    }
+
+    return res;
+}
+
+/**
+ * Compare the tokens of both parsers. Returns the index of the first
+ * different token, or std::string::npos if they are the same.
+ */
+std::size_t firstDifference(const std::vector<Token>& a, const std::vector<Token>& b)
+{
+    std::size_t n = std::min(a.size(), b.size());
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (a[i].kind != b[i].kind || a[i].ea != b[i].ea || a[i].value != b[i].value)
+        {
+            return i;
+        }
+    }
+    return a.size() == b.size() ? std::string::npos : n;
+}
+
+/**
+ * C source of the tokens - what the plugin displays.
+ */
+std::string sourceOf(const std::vector<Token>& tokens)
+{
+    std::string ret;
+    for (auto& t : tokens)
+    {
+        ret += t.value;
+    }
+    return ret;
+}
+
+/**
+ * Load the recorded output, and add its function to the fake database.
+ * The function's range is given by the addresses in the output.
+ * Returns \c true if the output cannot be used.
+ */
+bool loadFixture(const fs::path& path, Fixture& fx)
+{
+    std::ifstream file(path.string(), std::ios::binary);
+    fx.output.assign(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+
+    auto tokens = parseTokens(fx.output, BADADDR);
+    ea_t start = BADADDR;
+    ea_t end = 0;
+    for (auto& t : tokens)
+    {
+        if (t.ea != BADADDR)
+        {
+            start = std::min(start, t.ea);
+            end = std::max(end, t.ea + 1);
+        }
+    }
+    if (start == BADADDR)
+    {
+        return true;
+    }
+
+    fx.name = path.stem().string();
+    fx.fnc = fakeAddFunction(start, end, fx.name);
+    fx.source = sourceOf(tokens);
+    return false;
+}
+
+/**
+ * Recorded outputs in the given files and directories.
+ */
+std::vector<Fixture> loadFixtures(const std::vector<std::string>& paths)
+{
+    std::vector<fs::path> files;
+    for (auto& p : paths)
+    {
+        std::error_code ec;
+        if (fs::is_directory(p, ec))
+        {
+            for (auto& e : fs::directory_iterator(p, ec))
+            {
+                if (e.path().extension() == ".json")
+                {
+                    files.push_back(e.path());
+                }
+            }
+        }
+        else
+        {
+            files.push_back(p);
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::vector<Fixture> fixtures;
+    for (auto& f : files)
+    {
+        Fixture fx;
+        if (loadFixture(f, fx))
+        {
+            std::cerr << "Skipping " << f.string() << " - no tokens with addresses\n";
+            continue;
+        }
+        fixtures.push_back(std::move(fx));
+    }
+    return fixtures;
+}
+
+/**
+ * Synthetic output of one function, in the layout of the RetDec outputs of
+ * selective decompilations - file header, functions, meta-information.
+ * Calls @p callees and uses the global variables g0 ... g15, so that the
+ * functions share identifiers like in a real program.
+ */
+std::vector<Token> generateTokens(
+        std::mt19937& rnd,
+        const std::string& name,
+        ea_t start,
+        ea_t end,
+        const std::vector<std::string>& callees)
+{
+    using K = Token::Kind;
+    std::vector<Token> tokens;
+    ea_t ea = start;
+    auto tok = [&](K kind, const std::string& val)
+    {
+        tokens.emplace_back(Token(kind, ea, val));
+    };
+    auto nl = [&]() { tok(K::NEW_LINE, "\n"); };
+    auto ws = [&](std::size_t n) { tok(K::WHITE_SPACE, std::string(n, ' ')); };
+    auto pick = [&](std::size_t n) { return std::size_t(rnd() % n); };
+
+    tok(K::COMMENT, "//");
+    nl();
+    tok(K::COMMENT, "// This file was generated by the Retargetable Decompiler");
+    nl();
+    tok(K::COMMENT, "// Website: https://retdec.com");
+    nl();
+    tok(K::COMMENT, "//");
+    nl();
+    nl();
+    tok(K::INCLUDE, "#include <stdint.h>");
+    nl();
+    nl();
+    tok(K::COMMENT, "// ------------------------ Functions -------------------------");
+    nl();
+    nl();
+
+    std::stringstream range;
+    range << "// Address range: " << std::hex << std::showbase << start << " - " << end;
+    tok(K::COMMENT, range.str());
+    nl();
+    tok(K::TYPE, "int32_t");
+    ws(1);
+    tok(K::ID_FNC, name);
+    tok(K::PUNCTUATION, "(");
+    tok(K::TYPE, "int32_t");
+    ws(1);
+    tok(K::ID_ARG, "a1");
+    tok(K::PUNCTUATION, ",");
+    ws(1);
+    tok(K::TYPE, "int32_t");
+    ws(1);
+    tok(K::ID_ARG, "a2");
+    tok(K::PUNCTUATION, ")");
+    ws(1);
+    tok(K::PUNCTUATION, "{");
+    nl();
+
+    std::size_t depth = 1;
+    std::size_t vars = 1;
+    while (ea + 16 < end)
+    {
+        ea += 2 + pick(10);
+        ws(4 * depth);
+        switch (pick(6))
+        {
+            case 0:
+            case 1:
+            {
+                tok(K::TYPE, "int32_t");
+                ws(1);
+                tok(K::ID_LVAR, "v" + std::to_string(vars++));
+                ws(1);
+                tok(K::OPERATOR, "=");
+                ws(1);
+                tok(K::ID_GVAR, "g" + std::to_string(pick(16)));
+                ws(1);
+                tok(K::OPERATOR, pick(2) ? "+" : "*");
+                ws(1);
+                tok(K::LITERAL_INT, std::to_string(pick(1000)));
+                tok(K::PUNCTUATION, ";");
+                break;
+            }
+            case 2:
+            {
+                tok(K::ID_LVAR, "v" + std::to_string(1 + pick(vars)));
+                ws(1);
+                tok(K::OPERATOR, "=");
+                ws(1);
+                tok(K::ID_FNC, callees.empty() ? name : callees[pick(callees.size())]);
+                tok(K::PUNCTUATION, "(");
+                tok(K::ID_ARG, "a1");
+                tok(K::PUNCTUATION, ",");
+                ws(1);
+                tok(K::LITERAL_STR, "\"value: %d\\n\"");
+                tok(K::PUNCTUATION, ")");
+                tok(K::PUNCTUATION, ";");
+                break;
+            }
+            case 3:
+            {
+                if (depth < 4)
+                {
+                    tok(K::KEYWORD, "if");
+                    ws(1);
+                    tok(K::PUNCTUATION, "(");
+                    tok(K::ID_ARG, "a2");
+                    ws(1);
+                    tok(K::OPERATOR, ">");
+                    ws(1);
+                    tok(K::LITERAL_INT, std::to_string(pick(100)));
+                    tok(K::PUNCTUATION, ")");
+                    ws(1);
+                    tok(K::PUNCTUATION, "{");
+                    ++depth;
+                    break;
+                }
+            }
+            [[fallthrough]];
+            case 4:
+            {
+                if (depth > 1)
+                {
+                    tokens.pop_back();
+                    ws(4 * --depth);
+                    tok(K::PUNCTUATION, "}");
+                    break;
+                }
+            }
+            [[fallthrough]];
+            default:
+            {
+                tok(K::ID_GVAR, "g" + std::to_string(pick(16)));
+                ws(1);
+                tok(K::OPERATOR, "=");
+                ws(1);
+                tok(K::ID_ARG, "a1");
+                tok(K::PUNCTUATION, ";");
+                ws(1);
+                std::stringstream cmt;
+                cmt << "// " << std::hex << std::showbase << ea;
+                tok(K::COMMENT, cmt.str());
+                break;
+            }
+        }
+        nl();
+    }
+    while (depth > 1)
+    {
+        ws(4 * --depth);
+        tok(K::PUNCTUATION, "}");
+        nl();
+    }
+
+    ea = end - 1;
+    ws(4);
+    tok(K::KEYWORD, "return");
+    ws(1);
+    tok(K::ID_LVAR, "v1");
+    tok(K::PUNCTUATION, ";");
+    nl();
+    tok(K::PUNCTUATION, "}");
+    nl();
+    nl();
+
+    ea = start;
+    tok(K::COMMENT, "// --------------------- Meta-Information ---------------------");
+    nl();
+    nl();
+    tok(K::COMMENT, "// Detected compiler/packer: gcc");
+    nl();
+    tok(K::COMMENT, "// Detected functions: 1");
+    nl();
+
+    return tokens;
+}
+
+/**
+ * Synthetic outputs of @p count functions, and their functions in the fake
+ * database. Deterministic - the same for each run.
+ */
+std::vector<Fixture> generateFixtures(std::size_t count)
+{
+    std::mt19937 rnd(1);
+
+    std::vector<std::string> names;
+    std::vector<ea_t> starts;
+    ea_t ea = 0x401000;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::stringstream ss;
+        ss << "function_" << std::hex << ea;
+        names.push_back(ss.str());
+        starts.push_back(ea);
+        // 64 B to 4 kB - most functions are small.
+        ea += 64 << (rnd() % 7);
+    }
+    starts.push_back(ea);
+
+    std::vector<Fixture> fixtures;
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        std::vector<std::string> callees;
+        for (std::size_t j = 0; j < 4; ++j)
+        {
+            callees.push_back(names[rnd() % count]);
+        }
+
+        auto tokens = generateTokens(rnd, names[i], starts[i], starts[i + 1], callees);
+        Fixture fx;
+        fx.name = names[i];
+        fx.fnc = fakeAddFunction(starts[i], starts[i + 1], names[i]);
+        fx.output = serializeTokens(tokens);
+        fx.source = sourceOf(tokens);
+        fixtures.push_back(std::move(fx));
+    }
+    return fixtures;
+}
+
+/**
+ * Synthetic data of the program with the given functions, for the config
+ * generation - the functions get types, and there are global variables g0,
+ * g1, ... (one per function) of various types, some of them structures, and
+ * imported functions (function-typed data). Deterministic.
+ */
+void generateData(const std::vector<Fixture>& fixtures)
+{
+    std::mt19937 rnd(2);
+    auto pick = [&](std::size_t n) { return std::size_t(rnd() % n); };
+
+    tinfo_t int32(BTF_INT32);
+    tinfo_t charPtr;
+    charPtr.create_ptr(tinfo_t(BTF_CHAR));
+
+    auto functionType = [&](std::size_t args, cm_t cc)
+    {
+        func_type_data_t fi;
+        fi.rettype = int32;
+        fi.retloc._set_reg1(0);
+        fi.cc = cc;
+        for (std::size_t i = 0; i < args; ++i)
+        {
+            funcarg_t a;
+            a.type = i % 2 ? charPtr : int32;
+            if (cc == CM_CC_FASTCALL && i < 2)
+            {
+                a.argloc._set_reg1(int(i + 1));
+            }
+            else
+            {
+                a.argloc.set_stkoff(sval_t(4 * (i + 1)));
+            }
+            fi.push_back(a);
+        }
+        tinfo_t ret;
+        ret.create_func(fi);
+        return ret;
+    };
+
+    ea_t textStart = BADADDR;
+    ea_t textEnd = 0;
+    for (auto& fx : fixtures)
+    {
+        textStart = std::min(textStart, fx.fnc->start_ea);
+        textEnd = std::max(textEnd, fx.fnc->end_ea);
+        fakeSetType(
+                fx.fnc->start_ea,
+                functionType(1 + pick(4), pick(2) ? CM_CC_CDECL : CM_CC_FASTCALL));
+    }
+    fakeAddSegment(textStart, textEnd, ".text");
+
+    // Structures may point to the ones defined before them.
+    std::vector<tinfo_t> structures;
+    for (std::size_t i = 0; i < 8; ++i)
+    {
+        udt_type_data_t udt;
+        for (std::size_t j = 0, n = 2 + pick(5); j < n; ++j)
+        {
+            udt_member_t m;
+            m.name = ("m" + std::to_string(j)).c_str();
+            switch (pick(4))
+            {
+                case 0: m.type = int32; break;
+                case 1: m.type = tinfo_t(BTF_DOUBLE); break;
+                case 2: m.type = charPtr; break;
+                default:
+                {
+                    if (structures.empty())
+                    {
+                        m.type = tinfo_t(BTF_UINT16);
+                    }
+                    else
+                    {
+                        m.type.create_ptr(structures[pick(structures.size())]);
+                    }
+                    break;
+                }
+            }
+            udt.push_back(m);
+        }
+        tinfo_t s;
+        s.create_udt(udt, BTF_STRUCT);
+        structures.push_back(fakeNamedType("struct_" + std::to_string(i), s));
+    }
+
+    ea_t dataStart = (textEnd + 0xFFF) & ~ea_t(0xFFF);
+    ea_t ea = dataStart;
+    for (std::size_t i = 0; i < fixtures.size(); ++i)
+    {
+        tinfo_t type;
+        flags_t flags = FF_DWORD;
+        asize_t size = 4;
+        switch (pick(8))
+        {
+            case 0:
+            {
+                type = int32;
+                break;
+            }
+            case 1:
+            {
+                type = tinfo_t(BTF_UINT64);
+                flags = FF_QWORD;
+                size = 8;
+                break;
+            }
+            case 2:
+            {
+                size = 4 + pick(60);
+                type.create_array(tinfo_t(BTF_CHAR), uint32(size));
+                flags = FF_STRLIT;
+                break;
+            }
+            case 3:
+            {
+                // Untyped array - its type is given by the flags.
+                size = 4 * (1 + pick(16));
+                break;
+            }
+            case 4:
+            {
+                flags = FF_DOUBLE;
+                size = 8;
+                break;
+            }
+            case 5:
+            {
+                type = structures[pick(structures.size())];
+                flags = FF_STRUCT;
+                size = type.get_size();
+                break;
+            }
+            case 6:
+            {
+                type.create_ptr(structures[pick(structures.size())]);
+                flags = FF_QWORD;
+                size = 8;
+                break;
+            }
+            default:
+            {
+                // Unnamed alignment before the variable - not a global.
+                fakeAddData(ea, FF_ALIGN, 8, "");
+                ea += 8;
+                type = int32;
+                break;
+            }
+        }
+        fakeAddData(ea, flags, size, "g" + std::to_string(i));
+        if (!type.empty())
+        {
+            fakeSetType(ea, type);
+        }
+        ea += size;
+    }
+    fakeAddSegment(dataStart, ea, ".data");
+
+    ea_t importStart = (ea + 0xFFF) & ~ea_t(0xFFF);
+    ea = importStart;
+    for (std::size_t i = 0; i < fixtures.size() / 8 + 1; ++i)
+    {
+        fakeAddData(ea, FF_QWORD, 8, "import_" + std::to_string(i));
+        fakeSetType(ea, functionType(1 + pick(4), CM_CC_STDCALL));
+        ea += 8;
+    }
+    fakeAddSegment(importStart, ea, ".idata");
+}
+
+/**
+ * Run the suite @p iterations times. @p prepare is not timed.
+ * @p run returns the number of operations done.
+ */
+SuiteResult runSuite(
+        const std::string& name,
+        std::size_t iterations,
+        const std::function<void()>& prepare,
+        const std::function<std::size_t()>& run)
+{
+    SuiteResult res;
+    res.name = name;
+    for (std::size_t i = 0; i < iterations; ++i)
+    {
+        prepare();
+        auto start = std::chrono::steady_clock::now();
+        res.ops = run();
+        std::chrono::duration<double, std::micro> elapsed =
+                std::chrono::steady_clock::now() - start;
+        res.times.push_back(elapsed.count());
+    }
+    return res;
+}
+
+void printUsage()
+{
+    std::cerr << "Usage: retdec-benchmark [-i iterations] [-n functions] "
+                 "[-o results.json] [output.json | directory ...]\n";
+}
+
+/**
+ * Positive number argument. Returns \c true if it is not one.
+ */
+bool parseNumber(const char* arg, std::size_t& val)
+{
+    char* end = nullptr;
+    unsigned long n = std::strtoul(arg, &end, 10);
+    if (end == arg || *end != '\0' || n == 0)
+    {
+        return true;
+    }
+    val = n;
+    return false;
+}
+
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    std::size_t iterations = 10;
+    std::size_t count = 200;
+    std::string out;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "-i" && hasValue)
+        {
+            if (parseNumber(argv[++i], iterations))
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg == "-n" && hasValue)
+        {
+            if (parseNumber(argv[++i], count))
+            {
+                printUsage();
+                return 1;
+            }
+        }
+        else if (arg == "-o" && hasValue)
+        {
+            out = argv[++i];
+        }
+        else if (!arg.empty() && arg[0] == '-')
+        {
+            printUsage();
+            return 1;
+        }
+        else
+        {
+            paths.push_back(arg);
+        }
+    }
+
+    bool recorded = !paths.empty();
+    auto fixtures = recorded ? loadFixtures(paths) : generateFixtures(count);
+    if (fixtures.empty())
+    {
+        std::cerr << "There are no functions to benchmark.\n";
+        return 1;
+    }
+    if (!recorded)
+    {
+        generateData(fixtures);
+    }
+
+    std::vector<std::vector<Token>> tokens;
+    std::vector<Function> functions;
+    auto makeFunctions = [&]()
+    {
+        functions.clear();
+        for (std::size_t i = 0; i < fixtures.size(); ++i)
+        {
+            functions.emplace_back(fixtures[i].fnc, tokens[i]);
+        }
+    };
+    auto none = []() {};
+
+    std::vector<SuiteResult> results;
+
+    std::vector<std::vector<Token>> legacyTokens;
+    results.push_back(runSuite("parseTokens (DOM)", iterations, none, [&]()
+    {
+        legacyTokens.clear();
+        for (auto& fx : fixtures)
+        {
+            legacyTokens.push_back(legacyParseTokens(fx.output, fx.fnc->start_ea));
+        }
+        return fixtures.size();
+    }));
+
+    results.push_back(runSuite("parseTokens", iterations, none, [&]()
+    {
+        tokens.clear();
+        for (auto& fx : fixtures)
+        {
+            tokens.push_back(parseTokens(fx.output, fx.fnc->start_ea));
+        }
+        return fixtures.size();
+    }));
+
+    // Both parsers must give the same tokens - the DOM parser is the
+    // reference.
+    std::size_t equal = 0;
+    for (std::size_t i = 0; i < fixtures.size(); ++i)
+    {
+        std::size_t diff = firstDifference(legacyTokens[i], tokens[i]);
+        if (diff == std::string::npos)
+        {
+            ++equal;
+            continue;
+        }
+
+        std::cerr << "parseTokens differs from the DOM parser in " << fixtures[i].name
+                  << ", token " << diff << " (tokens: " << legacyTokens[i].size()
+                  << " vs " << tokens[i].size() << ")\n";
+    }
+
+    results.push_back(runSuite("Function", iterations, none, [&]()
+    {
+        makeFunctions();
+        return functions.size();
+    }));
+
+    results.push_back(runSuite("navigation", iterations, none, [&]()
+    {
+        std::size_t ops = 0;
+        for (auto& f : functions)
+        {
+            for (YX yx = f.min_yx(), next; yx < f.max_yx(); yx = next, ++ops)
+            {
+                sink = sink + f.yx_2_ea(yx);
+                if ((next = f.next_yx(yx)) == yx)
+                {
+                    break;
+                }
+            }
+            for (YX yx = f.max_yx(), prev; f.min_yx() < yx; yx = prev, ++ops)
+            {
+                sink = sink + (f.getToken(yx) ? 1 : 0);
+                if ((prev = f.prev_yx(yx)) == yx)
+                {
+                    break;
+                }
+            }
+            for (ea_t ea = f.getStart(); ea < f.getEnd(); ++ea, ++ops)
+            {
+                sink = sink + f.ea_2_yx(ea).y;
+            }
+        }
+        return ops;
+    }));
+
+    // Disassembly lines highlighted for the current line of a synced view.
+    results.push_back(runSuite("sync", iterations, none, [&]()
+    {
+        std::size_t ops = 0;
+        for (auto& f : functions)
+        {
+            for (std::size_t y = 0; y <= f.max_yx().y; ++y)
+            {
+                auto eas = f.yx_2_eas(YX(y, 0));
+                for (ea_t ea : eas)
+                {
+                    sink = sink + (eas.contains(ea) ? 1 : 0);
+                }
+                ++ops;
+            }
+        }
+        return ops;
+    }));
+
+    // Rendered lines are cached in functions - render fresh ones.
+    results.push_back(runSuite("rendering", iterations, makeFunctions, [&]()
+    {
+        std::size_t ops = 0;
+        for (auto& f : functions)
+        {
+            for (std::size_t y = 0; y <= f.max_yx().y; ++y, ++ops)
+            {
+                sink = sink + f.colored_line(y).size();
+                sink = sink + f.line_yx(YX(y, 0)).size();
+            }
+        }
+        return ops;
+    }));
+
+    // Same work as RetDec::modifyFunctions() does in each function - the
+    // lines are indexed by FunctionCache. Renamed there and back again.
+    std::vector<std::map<std::string, std::vector<std::size_t>>> identifiers;
+    auto indexFunctions = [&]()
+    {
+        identifiers.clear();
+        for (auto& f : functions)
+        {
+            identifiers.push_back(f.lines_with(Token::Kind::ID_FNC));
+        }
+    };
+    results.push_back(runSuite("rename", iterations, indexFunctions, [&]()
+    {
+        std::size_t ops = 0;
+        for (std::size_t i = 0; i < functions.size(); ++i)
+        {
+            for (auto& p : identifiers[i])
+            {
+                std::string renamed = p.first + "_renamed";
+                functions[i].rename(Token::Kind::ID_FNC, p.first, renamed, p.second);
+                functions[i].rename(Token::Kind::ID_FNC, renamed, p.first, p.second);
+                ops += 2;
+            }
+        }
+        return ops;
+    }));
+
+    // Functions are put to a cache with the budget of a half of them, so
+    // that there are evictions, then looked up and renamed.
+    std::size_t totalSize = 0;
+    for (auto& f : functions)
+    {
+        totalSize += f.memorySize();
+    }
+    results.push_back(runSuite("FunctionCache", iterations, makeFunctions, [&]()
+    {
+        FunctionCache cache;
+        cache.setBudget(totalSize / 2);
+        std::size_t ops = 0;
+        for (auto& f : functions)
+        {
+            ea_t ea = f.getStart();
+            cache.put(ea, std::move(f));
+            ++ops;
+        }
+        for (auto& fx : fixtures)
+        {
+            sink = sink + (cache.get(fx.fnc->start_ea) ? 1 : 0);
+            ++ops;
+        }
+        for (auto& fx : fixtures)
+        {
+            cache.rename(Token::Kind::ID_FNC, fx.name, fx.name + "_renamed");
+            ++ops;
+        }
+        return ops;
+    }));
+
+    const std::size_t shardCount = 16;
+    results.push_back(runSuite("createShards", iterations, none, [&]()
+    {
+        sink = sink + createShards(shardCount).size();
+        return get_func_qty();
+    }));
+
+    // Outputs of the shards are the outputs of their functions, which have
+    // the same sections as the whole shard outputs.
+    std::vector<Shard> shards = createShards(shardCount);
+    for (auto& s : shards)
+    {
+        for (auto& fx : fixtures)
+        {
+            if (s.start <= fx.fnc->start_ea && fx.fnc->start_ea < s.end)
+            {
+                s.output += fx.source;
+            }
+        }
+        s.status = Shard::Status::DONE;
+    }
+    results.push_back(runSuite("mergeShards", iterations, none, [&]()
+    {
+        sink = sink + mergeShards(shards).size();
+        return shards.size();
+    }));
+
+#ifdef RETDEC_BENCHMARK_CONFIG
+    // Config of the whole program, as for full decompilations. The model is
+    // dropped (or its parts invalidated) before each iteration.
+    retdec::config::Config config;
+    if (fillConfig(config))
+    {
+        std::cerr << "Unable to fill the config.\n";
+        return 1;
+    }
+    auto configEntries = [&config]()
+    {
+        return config.functions.size() + config.globals.size();
+    };
+    results.push_back(runSuite("fillConfig (full)", iterations, invalidateConfig, [&]()
+    {
+        fillConfig(config);
+        return configEntries();
+    }));
+
+    // All the types are translated again, with the functions and globals
+    // which use them.
+    results.push_back(runSuite("type2string", iterations, invalidateConfigTypes, [&]()
+    {
+        fillConfig(config);
+        return configEntries();
+    }));
+
+    results.push_back(runSuite("generateGlobals", iterations, invalidateConfigGlobals, [&]()
+    {
+        fillConfig(config);
+        return config.globals.size();
+    }));
+
+    // Every 8th function changed - only they are updated in the config.
+    auto changeFunctions = [&]()
+    {
+        for (std::size_t i = 0; i < fixtures.size(); i += 8)
+        {
+            invalidateConfigFunction(fixtures[i].fnc->start_ea);
+        }
+    };
+    results.push_back(runSuite("fillConfig (incremental)", iterations, changeFunctions, [&]()
+    {
+        fillConfig(config);
+        return (fixtures.size() + 7) / 8;
+    }));
+#endif
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Benchmark: " << fixtures.size()
+              << (recorded ? " recorded" : " synthetic") << " functions, "
+              << iterations << " iterations\n";
+    std::cout << "Tokens of parseTokens and the DOM parser equal: "
+              << equal << "/" << fixtures.size() << " outputs\n";
+    for (auto& r : results)
+    {
+        std::cout << "    " << std::left << std::setw(26) << r.name << std::right
+                  << " best " << std::setw(10) << r.best() / 1000.0 << " ms"
+                  << ", mean " << std::setw(10) << r.mean() / 1000.0 << " ms"
+                  << ", " << std::setw(10) << r.best() / std::max<std::size_t>(1, r.ops)
+                  << " us/op (" << r.ops << " ops)\n";
+    }
+
+    int ret = equal == fixtures.size() ? 0 : 1;
+    if (out.empty())
+    {
+        return ret;
+    }
+
+    std::ofstream json(out, std::ios::binary);
+    json << std::fixed << std::setprecision(3);
+    json << "{\n"
+         << "  \"functions\": " << fixtures.size() << ",\n"
+         << "  \"fixtures\": \"" << (recorded ? "recorded" : "synthetic") << "\",\n"
+         << "  \"iterations\": " << iterations << ",\n"
+         << "  \"parsers_equal\": " << (ret == 0 ? "true" : "false") << ",\n"
+         << "  \"suites\": [";
+    for (std::size_t i = 0; i < results.size(); ++i)
+    {
+        auto& r = results[i];
+        json << (i ? "," : "") << "\n    {"
+             << "\"name\": \"" << r.name << "\", "
+             << "\"ops\": " << r.ops << ", "
+             << "\"best_us\": " << r.best() << ", "
+             << "\"mean_us\": " << r.mean() << "}";
+    }
+    json << "\n  ]\n}\n";
+    if (!json)
+    {
+        std::cerr << "Unable to write " << out << "\n";
+        return 1;
+    }
+
+    std::cout << "Results saved to " << out << "\n";
+    return ret;
+}
@@ -0,0 +1,43 @@
+/**
+ * Stand-ins of the plugin functions the config module uses from the modules
+ * which are not benchmarked (profile, utils) - those need the input file of
+ * a real IDA database. The fake input is a decompilable x86 PE file, and
+ * there is no decompiler-config.json.
+ */
+
+#include "profile.h"
+#include "utils.h"
+
+namespace {
+
+BinaryProfile makeProfile()
+{
+    BinaryProfile p;
+    p.inputPath = "benchmark.exe";
+    p.x86 = true;
+    p.decompilable = true;
+    return p;
+}
+
+} // anonymous namespace
+
+const BinaryProfile& getBinaryProfile()
+{
+    static const BinaryProfile profile = makeProfile();
+    return profile;
+}
+
+bool isX86()
+{
+    return getBinaryProfile().x86;
+}
+
+std::string getInputPath()
+{
+    return getBinaryProfile().inputPath;
+}
+
+std::string getPluginPath()
+{
+    return std::string();
+}
@@ -0,0 +1,12 @@
+#ifndef FAKESDK_ALLINS_HPP
+#define FAKESDK_ALLINS_HPP
+
+/// Instruction types - only the ones the fake database decodes.
+enum
+{
+    NN_null = 0,
+    NN_mov,
+    NN_retn,
+};
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_AUTO_HPP
+#define FAKESDK_AUTO_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef FAKESDK_BYTES_HPP
+#define FAKESDK_BYTES_HPP
+
+#include "pro.h"
+
+typedef uint32 flags_t;
+
+// Item flags - the values of the real SDK.
+//
+#define MS_CLS          0x00000600
+#define FF_CODE         0x00000600
+#define FF_DATA         0x00000400
+#define FF_TAIL         0x00000200
+#define FF_UNK          0x00000000
+
+#define FF_NAME         0x00004000
+#define FF_LABL         0x00008000
+#define FF_ANYNAME      (FF_LABL | FF_NAME)
+
+#define MS_0TYPE        0x00F00000
+#define FF_0OFF         0x00500000
+#define MS_1TYPE        0x0F000000
+#define FF_1OFF         0x05000000
+
+#define DT_TYPE         0xF0000000
+#define FF_BYTE         0x00000000
+#define FF_WORD         0x10000000
+#define FF_DWORD        0x20000000
+#define FF_QWORD        0x30000000
+#define FF_TBYTE        0x40000000
+#define FF_STRLIT       0x50000000
+#define FF_STRUCT       0x60000000
+#define FF_OWORD        0x70000000
+#define FF_FLOAT        0x80000000
+#define FF_DOUBLE       0x90000000
+#define FF_PACKREAL     0xA0000000
+#define FF_ALIGN        0xB0000000
+#define FF_CUSTOM       0xD0000000
+#define FF_YWORD        0xE0000000
+
+inline bool is_code(flags_t f) { return (f & MS_CLS) == FF_CODE; }
+inline bool is_data(flags_t f) { return (f & MS_CLS) == FF_DATA; }
+inline bool is_head(flags_t f) { return (f & FF_DATA) != 0; }
+inline bool has_any_name(flags_t f) { return (f & FF_ANYNAME) != 0; }
+inline bool is_defarg0(flags_t f) { return (f & MS_0TYPE) != 0; }
+inline bool is_defarg1(flags_t f) { return (f & MS_1TYPE) != 0; }
+
+inline bool is_data_type(flags_t f, flags_t type)
+{
+    return is_data(f) && (f & DT_TYPE) == type;
+}
+inline bool is_byte(flags_t f) { return is_data_type(f, FF_BYTE); }
+inline bool is_word(flags_t f) { return is_data_type(f, FF_WORD); }
+inline bool is_dword(flags_t f) { return is_data_type(f, FF_DWORD); }
+inline bool is_qword(flags_t f) { return is_data_type(f, FF_QWORD); }
+inline bool is_oword(flags_t f) { return is_data_type(f, FF_OWORD); }
+inline bool is_yword(flags_t f) { return is_data_type(f, FF_YWORD); }
+inline bool is_tbyte(flags_t f) { return is_data_type(f, FF_TBYTE); }
+inline bool is_float(flags_t f) { return is_data_type(f, FF_FLOAT); }
+inline bool is_double(flags_t f) { return is_data_type(f, FF_DOUBLE); }
+inline bool is_pack_real(flags_t f) { return is_data_type(f, FF_PACKREAL); }
+inline bool is_strlit(flags_t f) { return is_data_type(f, FF_STRLIT); }
+inline bool is_struct(flags_t f) { return is_data_type(f, FF_STRUCT); }
+inline bool is_align(flags_t f) { return is_data_type(f, FF_ALIGN); }
+inline bool is_custom(flags_t f) { return is_data_type(f, FF_CUSTOM); }
+
+/// Flags of the item head at the address, 0 if there is none.
+flags_t get_flags(ea_t ea);
+/// The same as get_flags() - the fake database has no byte values.
+flags_t get_full_flags(ea_t ea);
+/// Next item head after @p ea, below @p maxea. BADADDR if there is none.
+ea_t next_head(ea_t ea, ea_t maxea);
+/// Size of the item at the address, 1 if there is none.
+asize_t get_item_size(ea_t ea);
+/// Size of one element of the data item with flags @p f.
+asize_t get_data_elsize(ea_t ea, flags_t f, const void* ti = nullptr);
+
+#endif
@@ -0,0 +1,9 @@
+#ifndef FAKESDK_DEMANGLE_HPP
+#define FAKESDK_DEMANGLE_HPP
+
+#include "pro.h"
+
+/// Demangler flags - names are not mangled here, see demangle_name().
+#define MNG_SHORT_FORM  0
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_DISKIO_HPP
+#define FAKESDK_DISKIO_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
@@ -0,0 +1,585 @@
+#include <algorithm>
+#include <cstdarg>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include "allins.hpp"
+#include "demangle.hpp"
+#include "fakesdk.h"
+#include "idp.hpp"
+#include "kernwin.hpp"
+#include "ua.hpp"
+
+namespace {
+
+struct FakeFunction
+{
+    func_t fnc;
+    std::string name;
+};
+
+/**
+ * Item - function code (one instruction) or data.
+ */
+struct FakeItem
+{
+    flags_t flags = 0;
+    asize_t size = 1;
+    std::string name;
+    tinfo_t type;
+};
+
+struct FakeSegment
+{
+    segment_t seg;
+    std::string name;
+};
+
+/// Functions, owned. A deque - the func_t pointers stay valid.
+std::deque<FakeFunction> functions;
+/// Functions sorted by their start addresses.
+std::vector<FakeFunction*> sorted;
+/// Items by their heads.
+std::map<ea_t, FakeItem> items;
+/// Segments, owned. A deque - the segment_t pointers stay valid.
+std::deque<FakeSegment> segments;
+/// Segments sorted by their start addresses.
+std::vector<FakeSegment*> sortedSegments;
+
+const FakeItem* findItem(ea_t ea)
+{
+    auto it = items.find(ea);
+    return it != items.end() ? &it->second : nullptr;
+}
+
+} // anonymous namespace
+
+func_t* fakeAddFunction(ea_t start, ea_t end, const std::string& name)
+{
+    functions.push_back(FakeFunction{func_t(start, end), name});
+    auto* f = &functions.back();
+    auto it = std::upper_bound(sorted.begin(), sorted.end(), start,
+            [](ea_t ea, const FakeFunction* ff) { return ea < ff->fnc.start_ea; });
+    sorted.insert(it, f);
+
+    auto& item = items[start];
+    item.flags = FF_CODE | FF_NAME;
+    item.size = end - start;
+    item.name = name;
+    return &f->fnc;
+}
+
+void fakeClearFunctions()
+{
+    for (auto* ff : sorted)
+    {
+        items.erase(ff->fnc.start_ea);
+    }
+    sorted.clear();
+    functions.clear();
+}
+
+void fakeAddData(ea_t ea, flags_t flags, asize_t size, const std::string& name)
+{
+    auto& item = items[ea];
+    item.flags = FF_DATA | flags | (name.empty() ? 0 : FF_NAME);
+    item.size = size;
+    item.name = name;
+}
+
+void fakeSetType(ea_t ea, const tinfo_t& type)
+{
+    auto it = items.find(ea);
+    if (it != items.end())
+    {
+        it->second.type = type;
+    }
+}
+
+segment_t* fakeAddSegment(ea_t start, ea_t end, const std::string& name)
+{
+    segments.push_back(FakeSegment{segment_t(start, end), name});
+    auto* s = &segments.back();
+    auto it = std::upper_bound(sortedSegments.begin(), sortedSegments.end(), start,
+            [](ea_t ea, const FakeSegment* fs) { return ea < fs->seg.start_ea; });
+    sortedSegments.insert(it, s);
+    return &s->seg;
+}
+
+static FakeFunction* findFunction(ea_t ea)
+{
+    auto it = std::upper_bound(sorted.begin(), sorted.end(), ea,
+            [](ea_t a, const FakeFunction* ff) { return a < ff->fnc.start_ea; });
+    if (it == sorted.begin())
+    {
+        return nullptr;
+    }
+    --it;
+    return (*it)->fnc.contains(ea) ? *it : nullptr;
+}
+
+func_t* get_func(ea_t ea)
+{
+    auto* ff = findFunction(ea);
+    return ff ? &ff->fnc : nullptr;
+}
+
+std::size_t get_func_qty()
+{
+    return sorted.size();
+}
+
+func_t* getn_func(std::size_t n)
+{
+    return n < sorted.size() ? &sorted[n]->fnc : nullptr;
+}
+
+ssize_t get_func_name(qstring* out, ea_t ea)
+{
+    auto* ff = findFunction(ea);
+    if (ff == nullptr)
+    {
+        return -1;
+    }
+    *out = ff->name.c_str();
+    return ssize_t(ff->name.size());
+}
+
+ssize_t get_func_cmt(qstring*, const func_t*, bool)
+{
+    return -1;
+}
+
+//
+//==============================================================================
+// Items
+//==============================================================================
+//
+
+flags_t get_flags(ea_t ea)
+{
+    auto* item = findItem(ea);
+    return item ? item->flags : 0;
+}
+
+flags_t get_full_flags(ea_t ea)
+{
+    return get_flags(ea);
+}
+
+ea_t next_head(ea_t ea, ea_t maxea)
+{
+    auto it = items.upper_bound(ea);
+    return it != items.end() && it->first < maxea ? it->first : BADADDR;
+}
+
+asize_t get_item_size(ea_t ea)
+{
+    auto* item = findItem(ea);
+    return item ? item->size : 1;
+}
+
+asize_t get_data_elsize(ea_t, flags_t f, const void*)
+{
+    switch (f & DT_TYPE)
+    {
+        case FF_WORD: return 2;
+        case FF_DWORD: return 4;
+        case FF_QWORD: return 8;
+        case FF_TBYTE: return 10;
+        case FF_OWORD: return 16;
+        case FF_FLOAT: return 4;
+        case FF_DOUBLE: return 8;
+        case FF_PACKREAL: return 10;
+        case FF_YWORD: return 32;
+        default: return 1;
+    }
+}
+
+ssize_t get_name(qstring* out, ea_t ea, int)
+{
+    auto* item = findItem(ea);
+    if (item == nullptr || item->name.empty())
+    {
+        return -1;
+    }
+    *out = item->name.c_str();
+    return ssize_t(item->name.size());
+}
+
+int demangle_name(qstring*, const char*, uint32, int)
+{
+    return -1;
+}
+
+bool get_tinfo(tinfo_t* tif, ea_t ea)
+{
+    auto* item = findItem(ea);
+    if (item == nullptr || item->type.empty())
+    {
+        return false;
+    }
+    *tif = item->type;
+    return true;
+}
+
+int guess_tinfo(tinfo_t*, tid_t)
+{
+    return GUESS_FUNC_FAILED;
+}
+
+int decode_insn(insn_t* out, ea_t ea)
+{
+    auto* item = findItem(ea);
+    if (item == nullptr || !is_code(item->flags))
+    {
+        return 0;
+    }
+    out->ea = ea;
+    out->size = ushort(std::min<asize_t>(item->size, 0xFFFF));
+    out->itype = item->size == 1 ? NN_retn : NN_mov;
+    return out->size;
+}
+
+ssize_t get_reg_name(qstring* out, int reg, std::size_t width, int)
+{
+    std::string name = "r" + std::to_string(reg) + "_" + std::to_string(width);
+    *out = name.c_str();
+    return ssize_t(name.size());
+}
+
+//
+//==============================================================================
+// Segments
+//==============================================================================
+//
+
+int get_segm_qty()
+{
+    return int(sortedSegments.size());
+}
+
+segment_t* getnseg(int n)
+{
+    return n >= 0 && std::size_t(n) < sortedSegments.size()
+            ? &sortedSegments[n]->seg
+            : nullptr;
+}
+
+segment_t* getseg(ea_t ea)
+{
+    for (auto* fs : sortedSegments)
+    {
+        if (fs->seg.contains(ea))
+        {
+            return &fs->seg;
+        }
+    }
+    return nullptr;
+}
+
+ssize_t get_visible_segm_name(qstring* out, const segment_t* s, int)
+{
+    for (auto* fs : sortedSegments)
+    {
+        if (&fs->seg == s)
+        {
+            *out = fs->name.c_str();
+            return ssize_t(fs->name.size());
+        }
+    }
+    return -1;
+}
+
+//
+//==============================================================================
+// Types
+//==============================================================================
+//
+
+struct tinfo_t::detail_t
+{
+    type_t decl = BT_UNK;
+    /// Name of a named type, see fakeNamedType().
+    std::string name;
+    /// Pointed object, or array element.
+    tinfo_t target;
+    uint32 nelems = 0;
+    func_type_data_t func;
+    udt_type_data_t members;
+
+    type_t base() const { return decl & 0x0F; }
+};
+
+tinfo_t::tinfo_t(type_t declType)
+{
+    auto d = std::make_shared<detail_t>();
+    d->decl = declType;
+    m_detail = d;
+}
+
+tinfo_t fakeNamedType(const std::string& name, const tinfo_t& type)
+{
+    auto d = std::make_shared<tinfo_t::detail_t>(
+            type.empty() ? tinfo_t::detail_t() : *type.m_detail);
+    d->name = name;
+    tinfo_t ret;
+    ret.m_detail = d;
+    return ret;
+}
+
+#define FULL_TYPE(t) (m_detail && m_detail->decl == (t))
+#define BASE_TYPE(t) (m_detail && m_detail->base() == (t))
+
+bool tinfo_t::is_char() const { return FULL_TYPE(BTF_CHAR); }
+bool tinfo_t::is_uchar() const { return FULL_TYPE(BTF_UCHAR); }
+bool tinfo_t::is_int16() const { return FULL_TYPE(BTF_INT16) || FULL_TYPE(BT_INT16); }
+bool tinfo_t::is_uint16() const { return FULL_TYPE(BTF_UINT16); }
+bool tinfo_t::is_int32() const { return FULL_TYPE(BTF_INT32) || FULL_TYPE(BT_INT32); }
+bool tinfo_t::is_uint() const { return FULL_TYPE(BTF_UINT); }
+bool tinfo_t::is_uint32() const { return FULL_TYPE(BTF_UINT32); }
+bool tinfo_t::is_int64() const { return FULL_TYPE(BTF_INT64) || FULL_TYPE(BT_INT64); }
+bool tinfo_t::is_uint64() const { return FULL_TYPE(BTF_UINT64); }
+bool tinfo_t::is_int128() const { return BASE_TYPE(BT_INT128); }
+bool tinfo_t::is_ldouble() const { return FULL_TYPE(BTF_LDOUBLE); }
+bool tinfo_t::is_double() const { return FULL_TYPE(BTF_DOUBLE); }
+bool tinfo_t::is_float() const { return FULL_TYPE(BTF_FLOAT); }
+bool tinfo_t::is_bool() const { return BASE_TYPE(BT_BOOL); }
+bool tinfo_t::is_void() const { return BASE_TYPE(BT_VOID); }
+bool tinfo_t::is_unknown() const { return BASE_TYPE(BT_UNK); }
+bool tinfo_t::is_ptr() const { return BASE_TYPE(BT_PTR); }
+bool tinfo_t::is_func() const { return BASE_TYPE(BT_FUNC); }
+bool tinfo_t::is_array() const { return BASE_TYPE(BT_ARRAY); }
+bool tinfo_t::is_struct() const { return FULL_TYPE(BTF_STRUCT); }
+
+#undef FULL_TYPE
+#undef BASE_TYPE
+
+std::size_t tinfo_t::get_size() const
+{
+    if (empty())
+    {
+        return BADSIZE;
+    }
+
+    auto& d = *m_detail;
+    switch (d.base())
+    {
+        case BT_VOID: return 0;
+        case BT_INT8: return 1;
+        case BT_INT16: return 2;
+        case BT_INT32: return 4;
+        case BT_INT64: return 8;
+        case BT_INT128: return 16;
+        case BT_INT: return 4;
+        case BT_BOOL: return 1;
+        case BT_FLOAT: return is_double() ? 8 : is_ldouble() ? 10 : 4;
+        case BT_PTR: return sizeof(ea_t);
+        case BT_ARRAY: return d.nelems * d.target.get_size();
+        case BT_COMPLEX:
+        {
+            std::size_t size = 0;
+            for (auto& m : d.members)
+            {
+                size += m.type.get_size();
+            }
+            return size;
+        }
+        default: return BADSIZE;
+    }
+}
+
+tinfo_t tinfo_t::get_pointed_object() const
+{
+    return is_ptr() ? m_detail->target : tinfo_t();
+}
+
+tinfo_t tinfo_t::get_array_element() const
+{
+    return is_array() ? m_detail->target : tinfo_t();
+}
+
+int tinfo_t::get_array_nelems() const
+{
+    return is_array() ? int(m_detail->nelems) : -1;
+}
+
+bool tinfo_t::get_func_details(func_type_data_t* fi) const
+{
+    if (!is_func())
+    {
+        return false;
+    }
+    *fi = m_detail->func;
+    return true;
+}
+
+cm_t tinfo_t::get_cc() const
+{
+    return is_func() ? m_detail->func.cc : cm_t(CM_CC_INVALID);
+}
+
+int tinfo_t::get_udt_nmembers() const
+{
+    return is_struct() ? int(m_detail->members.size()) : -1;
+}
+
+int tinfo_t::find_udt_member(udt_member_t* udm, int strmemFlags) const
+{
+    if (!is_struct() || !(strmemFlags & STRMEM_INDEX)
+            || udm->offset >= m_detail->members.size())
+    {
+        return -1;
+    }
+    int i = int(udm->offset);
+    *udm = m_detail->members[i];
+    return i;
+}
+
+bool tinfo_t::get_final_type_name(qstring* out) const
+{
+    if (empty() || m_detail->name.empty())
+    {
+        return false;
+    }
+    *out = m_detail->name.c_str();
+    return true;
+}
+
+bool tinfo_t::serialize(qtype* type, qtype* fields) const
+{
+    if (empty())
+    {
+        return false;
+    }
+
+    qtype unused;
+    fields = fields ? fields : &unused;
+    type->str().clear();
+    fields->str().clear();
+    serialize_to(type->str(), fields->str());
+    return true;
+}
+
+bool tinfo_t::create_ptr(const tinfo_t& tif)
+{
+    auto d = std::make_shared<detail_t>();
+    d->decl = BT_PTR;
+    d->target = tif;
+    m_detail = d;
+    return true;
+}
+
+bool tinfo_t::create_array(const tinfo_t& tif, uint32 nelems)
+{
+    auto d = std::make_shared<detail_t>();
+    d->decl = BT_ARRAY;
+    d->target = tif;
+    d->nelems = nelems;
+    m_detail = d;
+    return true;
+}
+
+bool tinfo_t::create_func(func_type_data_t& fi)
+{
+    auto d = std::make_shared<detail_t>();
+    d->decl = BT_FUNC;
+    d->func = fi;
+    m_detail = d;
+    return true;
+}
+
+bool tinfo_t::create_udt(udt_type_data_t& udt, type_t declType)
+{
+    auto d = std::make_shared<detail_t>();
+    d->decl = declType;
+    d->members = udt;
+    m_detail = d;
+    return true;
+}
+
+/**
+ * Named types are serialized as references (by their names), like by IDA.
+ */
+void tinfo_t::serialize_to(std::string& type, std::string& fields) const
+{
+    if (empty())
+    {
+        type += char(BT_UNK);
+        return;
+    }
+
+    auto& d = *m_detail;
+    if (!d.name.empty())
+    {
+        type += '=';
+        type.append(d.name.c_str(), d.name.size() + 1);
+        return;
+    }
+
+    type += char(d.decl);
+    switch (d.base())
+    {
+        case BT_PTR:
+        {
+            d.target.serialize_to(type, fields);
+            break;
+        }
+        case BT_ARRAY:
+        {
+            type += std::to_string(d.nelems) + ';';
+            d.target.serialize_to(type, fields);
+            break;
+        }
+        case BT_FUNC:
+        {
+            type += char(d.func.cc);
+            d.func.rettype.serialize_to(type, fields);
+            type += std::to_string(d.func.size()) + ';';
+            for (auto& a : d.func)
+            {
+                a.type.serialize_to(type, fields);
+            }
+            break;
+        }
+        case BT_COMPLEX:
+        {
+            type += std::to_string(d.members.size()) + ';';
+            for (auto& m : d.members)
+            {
+                m.type.serialize_to(type, fields);
+                fields.append(m.name.c_str(), m.name.length() + 1);
+            }
+            break;
+        }
+        default:
+        {
+            break;
+        }
+    }
+}
+
+//
+//==============================================================================
+// Output
+//==============================================================================
+//
+
+int msg(const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    int n = std::vprintf(format, va);
+    va_end(va);
+    return n;
+}
+
+void warning(const char* format, ...)
+{
+    va_list va;
+    va_start(va, format);
+    std::vfprintf(stderr, format, va);
+    va_end(va);
+}
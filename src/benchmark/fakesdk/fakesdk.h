@@ -0,0 +1,36 @@
+#ifndef FAKESDK_FAKESDK_H
+#define FAKESDK_FAKESDK_H
+
+#include <string>
+
+#include "bytes.hpp"
+#include "funcs.hpp"
+#include "segment.hpp"
+#include "typeinf.hpp"
+
+/**
+ * IDA SDK stand-in.
+ *
+ * The benchmarked plugin modules (token, function, functioncache, shards,
+ * trace, yx, and config if RetDec is available) are compiled against these
+ * headers instead of the IDA SDK, so the benchmark runs on a plain machine
+ * without IDA. The fake database holds functions, segments and named data
+ * items with their types - the benchmark fills it from the fixtures.
+ */
+
+/// Add a function to the fake database, with its code item (see
+/// decode_insn()). Returns the function.
+func_t* fakeAddFunction(ea_t start, ea_t end, const std::string& name);
+/// Remove all the functions from the fake database.
+void fakeClearFunctions();
+/// Add a data item of @p size bytes - @p flags are its data type flags
+/// (e.g. FF_DWORD). It is named if @p name is not empty.
+void fakeAddData(ea_t ea, flags_t flags, asize_t size, const std::string& name);
+/// Set the type of the function or data item at the address.
+void fakeSetType(ea_t ea, const tinfo_t& type);
+/// Add a segment. Returns the segment.
+segment_t* fakeAddSegment(ea_t start, ea_t end, const std::string& name);
+/// Copy of the type with a name, e.g. a named structure.
+tinfo_t fakeNamedType(const std::string& name, const tinfo_t& type);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_FRAME_HPP
+#define FAKESDK_FRAME_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
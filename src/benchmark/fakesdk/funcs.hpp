@@ -0,0 +1,50 @@
+#ifndef FAKESDK_FUNCS_HPP
+#define FAKESDK_FUNCS_HPP
+
+#include "pro.h"
+
+/**
+ * Address range [start_ea, end_ea).
+ */
+struct range_t
+{
+    ea_t start_ea = 0;
+    ea_t end_ea = 0;
+
+    range_t() = default;
+    range_t(ea_t start, ea_t end) : start_ea(start), end_ea(end) {}
+
+    bool contains(ea_t ea) const { return start_ea <= ea && ea < end_ea; }
+    bool empty() const { return end_ea <= start_ea; }
+    asize_t size() const { return end_ea - start_ea; }
+};
+
+#define FUNC_NORET      0x00000001
+#define FUNC_FAR        0x00000002
+#define FUNC_LIB        0x00000004
+#define FUNC_STATICDEF  0x00000008
+#define FUNC_THUNK      0x00000080
+
+/**
+ * Function - its main chunk only, the fake database has no tails.
+ */
+struct func_t : public range_t
+{
+    uint64 flags = 0;
+
+    func_t() = default;
+    func_t(ea_t start, ea_t end, uint64 f = 0) : range_t(start, end), flags(f) {}
+};
+
+/// Function containing the address, or \c nullptr.
+func_t* get_func(ea_t ea);
+/// Number of functions.
+std::size_t get_func_qty();
+/// Function by its index - functions are sorted by their start addresses.
+func_t* getn_func(std::size_t n);
+/// Name of the function containing the address. Returns its length, or -1.
+ssize_t get_func_name(qstring* out, ea_t ea);
+/// Function comment - functions have none here. Returns -1.
+ssize_t get_func_cmt(qstring* out, const func_t* pfn, bool repeatable);
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef FAKESDK_IDA_HPP
+#define FAKESDK_IDA_HPP
+
+#include "pro.h"
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef FAKESDK_IDP_HPP
+#define FAKESDK_IDP_HPP
+
+#include "pro.h"
+
+/// Name of the register @p reg of @p width bytes - "r<reg>_<width>" here.
+/// Returns its length, or -1.
+ssize_t get_reg_name(qstring* out, int reg, std::size_t width, int reghi = -1);
+
+#endif
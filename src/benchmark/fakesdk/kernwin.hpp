@@ -0,0 +1,11 @@
+#ifndef FAKESDK_KERNWIN_HPP
+#define FAKESDK_KERNWIN_HPP
+
+#include "pro.h"
+
+/// Print to the output window - the standard output here.
+int msg(const char* format, ...);
+/// Show a warning - printed to the standard error here, it does not block.
+void warning(const char* format, ...);
+
+#endif
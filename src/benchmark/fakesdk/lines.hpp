@@ -0,0 +1,21 @@
+#ifndef FAKESDK_LINES_HPP
+#define FAKESDK_LINES_HPP
+
+#include "pro.h"
+
+// Color tags - the values of the real SDK.
+//
+#define COLOR_ON        '\1'
+#define COLOR_OFF       '\2'
+
+#define SCOLOR_ON       "\1"
+#define SCOLOR_OFF      "\2"
+
+#define SCOLOR_DEFAULT  "\x01"
+#define SCOLOR_AUTOCMT  "\x04"
+#define SCOLOR_NUMBER   "\x0C"
+#define SCOLOR_DREF     "\x0F"
+#define SCOLOR_MACRO    "\x1C"
+#define SCOLOR_KEYWORD  "\x20"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_LOADER_HPP
+#define FAKESDK_LOADER_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
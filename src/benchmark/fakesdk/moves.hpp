@@ -0,0 +1,7 @@
+#ifndef FAKESDK_MOVES_HPP
+#define FAKESDK_MOVES_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
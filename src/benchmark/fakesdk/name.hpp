@@ -0,0 +1,11 @@
+#ifndef FAKESDK_NAME_HPP
+#define FAKESDK_NAME_HPP
+
+#include "pro.h"
+
+/// Name of the item at the address. Returns its length, or -1.
+ssize_t get_name(qstring* out, ea_t ea, int gtnFlags = 0);
+/// Demangle the name - names are not mangled here. Returns -1.
+int demangle_name(qstring* out, const char* name, uint32 disableMask, int reqtype = 0);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef FAKESDK_PRO_H
+#define FAKESDK_PRO_H
+
+/**
+ * IDA SDK stand-in for the benchmark - only what the benchmarked modules
+ * use, with the real SDK's names and semantics. See fakesdk.h.
+ */
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <sys/types.h>
+
+typedef unsigned char uchar;
+typedef unsigned short ushort;
+typedef unsigned int uint;
+typedef std::uint32_t uint32;
+typedef std::int64_t int64;
+typedef std::uint64_t uint64;
+
+#ifdef __EA64__
+typedef uint64 ea_t;
+typedef uint64 asize_t;
+typedef int64 sval_t;
+#else
+typedef uint32 ea_t;
+typedef uint32 asize_t;
+typedef std::int32_t sval_t;
+#endif
+
+#ifdef _WIN32
+typedef std::ptrdiff_t ssize_t;
+#endif
+
+typedef ea_t tid_t;
+typedef uchar type_t;
+
+#define BADADDR ea_t(-1)
+#define BADSIZE asize_t(-1)
+#define idaapi
+
+/**
+ * String of the SDK - only the members the benchmarked modules use.
+ */
+class qstring
+{
+public:
+    qstring() = default;
+    qstring(const char* str) : m_str(str) {}
+
+    const char* c_str() const { return m_str.c_str(); }
+    std::size_t length() const { return m_str.size(); }
+    std::size_t size() const { return m_str.size() + 1; }
+    bool empty() const { return m_str.empty(); }
+    void clear() { m_str.clear(); }
+    qstring& operator=(const char* str) { m_str = str; return *this; }
+
+private:
+    std::string m_str;
+};
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef FAKESDK_SEGMENT_HPP
+#define FAKESDK_SEGMENT_HPP
+
+#include "funcs.hpp"
+
+/**
+ * Segment - only its range here.
+ */
+struct segment_t : public range_t
+{
+    segment_t() = default;
+    segment_t(ea_t start, ea_t end) : range_t(start, end) {}
+};
+
+/// Number of segments.
+int get_segm_qty();
+/// Segment by its index - segments are sorted by their start addresses.
+segment_t* getnseg(int n);
+/// Segment containing the address, or \c nullptr.
+segment_t* getseg(ea_t ea);
+/// Name of the segment. Returns its length, or -1.
+ssize_t get_visible_segm_name(qstring* out, const segment_t* s, int flags = 0);
+
+#endif
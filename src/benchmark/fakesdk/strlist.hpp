@@ -0,0 +1,7 @@
+#ifndef FAKESDK_STRLIST_HPP
+#define FAKESDK_STRLIST_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_STRUCT_HPP
+#define FAKESDK_STRUCT_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
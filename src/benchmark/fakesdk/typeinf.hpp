@@ -0,0 +1,253 @@
+#ifndef FAKESDK_TYPEINF_HPP
+#define FAKESDK_TYPEINF_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "name.hpp"
+#include "pro.h"
+
+// Base types and their flags - the values of the real SDK.
+//
+#define BT_UNK          0x00
+#define BT_VOID         0x01
+#define BT_INT8         0x02
+#define BT_INT16        0x03
+#define BT_INT32        0x04
+#define BT_INT64        0x05
+#define BT_INT128       0x06
+#define BT_INT          0x07
+#define BT_BOOL         0x08
+#define BT_FLOAT        0x09
+#define BT_PTR          0x0A
+#define BT_ARRAY        0x0B
+#define BT_FUNC         0x0C
+#define BT_COMPLEX      0x0D
+
+#define BTMT_SIGNED     0x10
+#define BTMT_UNSIGNED   0x20
+#define BTMT_CHAR       0x30
+#define BTMT_DOUBLE     0x10
+#define BTMT_LNGDBL     0x20
+#define BTMT_STRUCT     0x00
+
+#define BTF_VOID        (BT_VOID)
+#define BTF_CHAR        (BT_INT8 | BTMT_CHAR)
+#define BTF_UCHAR       (BT_INT8 | BTMT_UNSIGNED)
+#define BTF_INT16       (BT_INT16 | BTMT_SIGNED)
+#define BTF_UINT16      (BT_INT16 | BTMT_UNSIGNED)
+#define BTF_INT32       (BT_INT32 | BTMT_SIGNED)
+#define BTF_UINT32      (BT_INT32 | BTMT_UNSIGNED)
+#define BTF_INT64       (BT_INT64 | BTMT_SIGNED)
+#define BTF_UINT64      (BT_INT64 | BTMT_UNSIGNED)
+#define BTF_INT128      (BT_INT128 | BTMT_SIGNED)
+#define BTF_UINT        (BT_INT | BTMT_UNSIGNED)
+#define BTF_BOOL        (BT_BOOL)
+#define BTF_FLOAT       (BT_FLOAT)
+#define BTF_DOUBLE      (BT_FLOAT | BTMT_DOUBLE)
+#define BTF_LDOUBLE     (BT_FLOAT | BTMT_LNGDBL)
+#define BTF_STRUCT      (BT_COMPLEX | BTMT_STRUCT)
+
+// Calling conventions - the values of the real SDK.
+//
+typedef uchar cm_t;
+
+#define CM_CC_INVALID   0x00
+#define CM_CC_UNKNOWN   0x10
+#define CM_CC_VOIDARG   0x20
+#define CM_CC_CDECL     0x30
+#define CM_CC_ELLIPSIS  0x40
+#define CM_CC_STDCALL   0x50
+#define CM_CC_PASCAL    0x60
+#define CM_CC_FASTCALL  0x70
+#define CM_CC_THISCALL  0x80
+#define CM_CC_MANUAL    0x90
+#define CM_CC_SPOILED   0xA0
+#define CM_CC_RESERVE4  0xB0
+#define CM_CC_RESERVE3  0xC0
+#define CM_CC_SPECIALE  0xD0
+#define CM_CC_SPECIALP  0xE0
+#define CM_CC_SPECIAL   0xF0
+
+/**
+ * Serialized type - only the members the benchmarked modules use.
+ */
+class qtype
+{
+public:
+    const uchar* c_str() const
+    {
+        return reinterpret_cast<const uchar*>(m_str.c_str());
+    }
+    std::size_t length() const { return m_str.size(); }
+
+    std::string& str() { return m_str; }
+
+private:
+    std::string m_str;
+};
+
+// Argument locations - the values of the real SDK.
+//
+#define ALOC_NONE       0
+#define ALOC_STACK      1
+#define ALOC_DIST       2
+#define ALOC_REG1       3
+#define ALOC_REG2       4
+#define ALOC_RREL       5
+#define ALOC_STATIC     6
+#define ALOC_CUSTOM     7
+
+/**
+ * Location of an argument or of a return value.
+ */
+class argloc_t
+{
+public:
+    int atype() const { return m_type; }
+    bool is_reg1() const { return m_type == ALOC_REG1; }
+    bool is_reg2() const { return m_type == ALOC_REG2; }
+    bool is_reg() const { return is_reg1() || is_reg2(); }
+    bool is_rrel() const { return m_type == ALOC_RREL; }
+    bool is_ea() const { return m_type == ALOC_STATIC; }
+    bool is_stkoff() const { return m_type == ALOC_STACK; }
+    bool is_scattered() const { return m_type == ALOC_DIST; }
+    bool is_fragmented() const { return m_type == ALOC_DIST || m_type == ALOC_REG2; }
+    bool is_custom() const { return m_type == ALOC_CUSTOM; }
+    bool is_badloc() const { return m_type == ALOC_NONE; }
+
+    int reg1() const { return int(m_value); }
+    sval_t stkoff() const { return sval_t(m_value); }
+    ea_t get_ea() const { return ea_t(m_value); }
+
+    void _set_reg1(int reg) { m_type = ALOC_REG1; m_value = uint64(reg); }
+    void set_stkoff(sval_t off) { m_type = ALOC_STACK; m_value = uint64(off); }
+    void set_ea(ea_t ea) { m_type = ALOC_STATIC; m_value = ea; }
+
+private:
+    int m_type = ALOC_NONE;
+    uint64 m_value = 0;
+};
+
+struct func_type_data_t;
+struct udt_type_data_t;
+struct udt_member_t;
+
+/// find_udt_member(): udt_member_t::offset is the member index.
+#define STRMEM_INDEX    0x0001
+
+/**
+ * Type - an immutable tree, cheap to copy. Only the members the benchmarked
+ * modules use, and the ones to create types (see also fakeNamedType()).
+ */
+class tinfo_t
+{
+public:
+    tinfo_t() = default;
+    explicit tinfo_t(type_t declType);
+
+    bool empty() const { return m_detail == nullptr; }
+    bool present() const { return !empty(); }
+
+    bool is_char() const;
+    bool is_uchar() const;
+    bool is_int16() const;
+    bool is_uint16() const;
+    bool is_int32() const;
+    bool is_uint() const;
+    bool is_uint32() const;
+    bool is_int64() const;
+    bool is_uint64() const;
+    bool is_int128() const;
+    bool is_ldouble() const;
+    bool is_double() const;
+    bool is_float() const;
+    bool is_bool() const;
+    bool is_void() const;
+    bool is_unknown() const;
+    bool is_ptr() const;
+    bool is_func() const;
+    bool is_array() const;
+    bool is_struct() const;
+
+    /// Size in bytes, BADSIZE for functions.
+    std::size_t get_size() const;
+    tinfo_t get_pointed_object() const;
+    tinfo_t get_array_element() const;
+    int get_array_nelems() const;
+    bool get_func_details(func_type_data_t* fi) const;
+    cm_t get_cc() const;
+    int get_udt_nmembers() const;
+    /// Only STRMEM_INDEX is supported. Returns the member index, or -1.
+    int find_udt_member(udt_member_t* udm, int strmemFlags) const;
+    bool get_final_type_name(qstring* out) const;
+    bool serialize(qtype* type, qtype* fields = nullptr) const;
+
+    bool create_ptr(const tinfo_t& tif);
+    bool create_array(const tinfo_t& tif, uint32 nelems = 0);
+    bool create_func(func_type_data_t& fi);
+    bool create_udt(udt_type_data_t& udt, type_t declType);
+
+    /// Type details, see fakesdk.cpp.
+    struct detail_t;
+
+private:
+    friend tinfo_t fakeNamedType(const std::string& name, const tinfo_t& type);
+
+    /// Serialize the type to @p type, and its member names to @p fields.
+    void serialize_to(std::string& type, std::string& fields) const;
+
+    std::shared_ptr<const detail_t> m_detail;
+};
+
+/**
+ * Function argument.
+ */
+struct funcarg_t
+{
+    argloc_t argloc;
+    qstring name;
+    tinfo_t type;
+};
+
+/**
+ * Function type details.
+ */
+struct func_type_data_t : public std::vector<funcarg_t>
+{
+    tinfo_t rettype;
+    argloc_t retloc;
+    cm_t cc = CM_CC_UNKNOWN;
+};
+
+/**
+ * Structure member.
+ */
+struct udt_member_t
+{
+    /// Offset in bits, or the index with STRMEM_INDEX.
+    uint64 offset = 0;
+    qstring name;
+    tinfo_t type;
+};
+
+/**
+ * Structure type details.
+ */
+struct udt_type_data_t : public std::vector<udt_member_t>
+{
+};
+
+// guess_tinfo() results.
+//
+#define GUESS_FUNC_FAILED   0
+#define GUESS_FUNC_TRIVIAL  1
+#define GUESS_FUNC_OK       2
+
+/// Type of the item at the address. Returns \c false if it has none.
+bool get_tinfo(tinfo_t* tif, ea_t ea);
+/// Guess the type of the item - never succeeds here.
+int guess_tinfo(tinfo_t* tif, tid_t id);
+
+#endif
@@ -0,0 +1,21 @@
+#ifndef FAKESDK_UA_HPP
+#define FAKESDK_UA_HPP
+
+#include "pro.h"
+
+/**
+ * Instruction - only its address, size and type.
+ */
+struct insn_t
+{
+    ea_t ea = BADADDR;
+    ushort itype = 0;
+    ushort size = 0;
+};
+
+/// Decode the instruction at the address. Returns its size, or 0.
+/// Code items of the fake database are single instructions - "retn" if it
+/// is 1 byte long, "mov" otherwise.
+int decode_insn(insn_t* out, ea_t ea);
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef FAKESDK_XREF_HPP
+#define FAKESDK_XREF_HPP
+
+// Not used by the benchmarked modules.
+#include "pro.h"
+
+#endif
@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <set>
+
+#include "batch.h"
+#include "shards.h"
+#include "trace.h"
+
+std::vector<func_t*> getCallNeighbourhood(func_t* f)
+{
+    std::vector<func_t*> ret = {f};
+    std::set<ea_t> seen = {f->start_ea};
+
+    func_item_iterator_t fii;
+    for (bool ok = fii.set(f); ok; ok = fii.next_code())
+    {
+        xrefblk_t xb;
+        for (bool x = xb.first_from(fii.current(), XREF_FAR); x; x = xb.next_from())
+        {
+            if (!xb.iscode || (xb.type != fl_CN && xb.type != fl_CF))
+            {
+                continue;
+            }
+
+            func_t* callee = get_func(xb.to);
+            if (callee == nullptr
+                    || callee->start_ea != xb.to
+                    || (callee->flags & (FUNC_LIB | FUNC_THUNK))
+                    || !seen.insert(callee->start_ea).second)
+            {
+                continue;
+            }
+
+            ret.push_back(callee);
+            if (ret.size() > batchNeighbourhoodLimit)
+            {
+                return ret;
+            }
+        }
+    }
+
+    return ret;
+}
+
+namespace {
+
+/**
+ * Line text without the new line.
+ */
+std::string lineText(
+        std::vector<Token>::const_iterator begin,
+        std::vector<Token>::const_iterator end)
+{
+    std::string ret;
+    for (auto it = begin; it != end; ++it)
+    {
+        if (it->kind != Token::Kind::NEW_LINE)
+        {
+            ret += it->value;
+        }
+    }
+    return ret;
+}
+
+/**
+ * One top-level item (with the following blank lines) in the section with
+ * function definitions.
+ */
+struct Item
+{
+    std::vector<Token>::const_iterator begin;
+    std::vector<Token>::const_iterator end;
+    /// Start of the function the item belongs to, BADADDR if shared.
+    ea_t owner = BADADDR;
+};
+
+} // anonymous namespace
+
+std::map<ea_t, std::vector<Token>> splitBatchTokens(
+        const std::vector<Token>& tokens,
+        const std::vector<func_t*>& fncs)
+{
+    TRACE_SCOPE("splitBatchTokens");
+
+    std::map<ea_t, func_t*> starts;
+    for (func_t* f : fncs)
+    {
+        starts[f->start_ea] = f;
+    }
+    auto findOwner = [&starts](ea_t ea)
+    {
+        auto it = starts.upper_bound(ea);
+        if (ea == BADADDR || it == starts.begin())
+        {
+            return BADADDR;
+        }
+        --it;
+        return it->second->contains(ea) ? it->first : BADADDR;
+    };
+
+    // Output = prefix, items of the "Functions" section, suffix.
+    auto prefixEnd = tokens.end();
+    auto suffixBegin = tokens.end();
+    std::vector<Item> items;
+
+    bool inFunctions = false;
+    int depth = 0;
+    bool afterBlank = false;
+    bool hasContent = false;
+    Item item;
+
+    for (auto lineBegin = tokens.begin(); lineBegin != tokens.end();)
+    {
+        auto lineEnd = std::find_if(lineBegin, tokens.end(),
+                [](const Token& t) { return t.kind == Token::Kind::NEW_LINE; });
+        if (lineEnd != tokens.end())
+        {
+            ++lineEnd;
+        }
+
+        std::string text = lineText(lineBegin, lineEnd);
+        std::string title;
+        if (depth == 0 && isSectionHeader(text, &title))
+        {
+            if (inFunctions)
+            {
+                item.end = lineBegin;
+                items.push_back(item);
+                suffixBegin = lineBegin;
+                inFunctions = false;
+            }
+            else if (title == "Functions" && prefixEnd == tokens.end())
+            {
+                prefixEnd = lineEnd;
+                item.begin = lineEnd;
+                inFunctions = true;
+            }
+        }
+        else if (inFunctions)
+        {
+            // Items are separated by blank lines, which belong to the
+            // preceding item.
+            bool blank = isBlank(text);
+            if (blank && !hasContent && items.empty())
+            {
+                // Blank lines after the section header are shared.
+                prefixEnd = lineEnd;
+                item.begin = lineEnd;
+            }
+            else if (depth == 0 && !blank && afterBlank && hasContent)
+            {
+                item.end = lineBegin;
+                items.push_back(item);
+                item = Item();
+                item.begin = lineBegin;
+                hasContent = false;
+            }
+            afterBlank = depth == 0 && blank;
+            hasContent = hasContent || !blank;
+
+            for (auto it = lineBegin; it != lineEnd; ++it)
+            {
+                if (it->kind == Token::Kind::PUNCTUATION)
+                {
+                    if (it->value == "{") ++depth;
+                    else if (it->value == "}") depth = std::max(0, depth - 1);
+                }
+                if (item.owner == BADADDR)
+                {
+                    item.owner = findOwner(it->ea);
+                }
+            }
+        }
+
+        lineBegin = lineEnd;
+    }
+    if (inFunctions)
+    {
+        item.end = tokens.end();
+        items.push_back(item);
+    }
+
+    std::map<ea_t, std::vector<Token>> ret;
+    if (prefixEnd == tokens.end())
+    {
+        return ret;
+    }
+
+    std::set<ea_t> owners;
+    for (auto& i : items)
+    {
+        if (i.owner != BADADDR)
+        {
+            owners.insert(i.owner);
+        }
+    }
+
+    for (ea_t owner : owners)
+    {
+        auto& out = ret[owner];
+        auto append = [&out, owner](
+                std::vector<Token>::const_iterator b,
+                std::vector<Token>::const_iterator e)
+        {
+            for (; b != e; ++b)
+            {
+                out.push_back(*b);
+                if (out.back().ea == BADADDR)
+                {
+                    out.back().ea = owner;
+                }
+            }
+        };
+
+        append(tokens.begin(), prefixEnd);
+        for (auto& i : items)
+        {
+            if (i.owner == owner || i.owner == BADADDR)
+            {
+                append(i.begin, i.end);
+            }
+        }
+        append(suffixBegin, tokens.end());
+    }
+
+    return ret;
+}
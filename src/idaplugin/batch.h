@@ -0,0 +1,40 @@
+#ifndef RETDEC_BATCH_H
+#define RETDEC_BATCH_H
+
+#include <map>
+#include <vector>
+
+#include "token.h"
+#include "utils.h"
+
+/**
+ * Batch selective decompilation.
+ *
+ * Several functions are decompiled by one RetDec run (one selected range per
+ * function), so the fixed costs of a decompilation - loading the input,
+ * decoder setup, signature matching - are paid only once. The JSON output
+ * of the run is split back into outputs of the individual functions, each
+ * with the shared parts (header, structures, prototypes, globals, ...) and
+ * its own definition.
+ */
+
+/// Maximal number of callees in the call-graph neighbourhood.
+constexpr std::size_t batchNeighbourhoodLimit = 16;
+
+/**
+ * Call-graph neighbourhood of the given function - the function itself and
+ * the (non-library) functions it calls, in the order of their calls.
+ */
+std::vector<func_t*> getCallNeighbourhood(func_t* f);
+
+/**
+ * Split tokens of a batch decompilation of @p fncs into tokens of the
+ * individual functions. Tokens without an address get the start of their
+ * function. Functions whose definitions are not in the output are not in
+ * the result.
+ */
+std::map<ea_t, std::vector<Token>> splitBatchTokens(
+        const std::vector<Token>& tokens,
+        const std::vector<func_t*>& fncs);
+
+#endif
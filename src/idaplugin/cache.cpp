@@ -0,0 +1,207 @@
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <sstream>
+
+#include "cache.h"
+#include "config.h"
+#include "profile.h"
+#include "retdec.h"
+#include "trace.h"
+
+/**
+ * Netnode holding the cached outputs.
+ * Blobs are indexed by function start addresses.
+ */
+static const char* cacheNodeName = "$ retdec decompilation cache";
+static const uchar cacheBlobTag = 'D';
+
+namespace {
+
+/**
+ * 64-bit FNV-1a hash.
+ */
+class Hasher
+{
+public:
+    void add(const void* data, std::size_t size)
+    {
+        auto* p = static_cast<const uchar*>(data);
+        for (std::size_t i = 0; i < size; ++i)
+        {
+            m_hash ^= p[i];
+            m_hash *= 0x100000001b3ULL;
+        }
+    }
+
+    void add(const std::string& str)
+    {
+        // Include the terminator so that ("ab", "c") != ("a", "bc").
+        add(str.c_str(), str.size() + 1);
+    }
+
+    void add(uint64_t val)
+    {
+        add(&val, sizeof(val));
+    }
+
+    std::string toString() const
+    {
+        std::stringstream ss;
+        ss << std::hex << std::setw(16) << std::setfill('0') << m_hash;
+        return ss.str();
+    }
+
+private:
+    uint64_t m_hash = 0xcbf29ce484222325ULL;
+};
+
+/**
+ * Names of the objects referenced from the function (callees, globals).
+ * Decompilation output contains them, so renaming them must change the key.
+ * Returns the (sorted) addresses of the objects.
+ */
+std::vector<ea_t> addReferencedNames(Hasher& h, func_t* f)
+{
+    std::vector<ea_t> refs;
+    qstring name;
+    func_item_iterator_t fii;
+    for (bool ok = fii.set(f); ok; ok = fii.next_code())
+    {
+        xrefblk_t xb;
+        for (bool x = xb.first_from(fii.current(), XREF_ALL); x; x = xb.next_from())
+        {
+            if (xb.iscode && xb.type == fl_F)
+            {
+                continue;
+            }
+            if (f->contains(xb.to))
+            {
+                continue;
+            }
+
+            h.add(uint64_t(xb.to));
+            if (get_name(&name, xb.to) > 0)
+            {
+                h.add(std::string(name.c_str()));
+            }
+            // Data references may point inside the objects.
+            refs.push_back(xb.iscode ? xb.to : get_item_head(xb.to));
+        }
+    }
+
+    std::sort(refs.begin(), refs.end());
+    refs.erase(std::unique(refs.begin(), refs.end()), refs.end());
+    return refs;
+}
+
+} // anonymous namespace
+
+std::string getCacheKey(func_t* f, std::vector<ea_t>* refs)
+{
+    TRACE_SCOPE("getCacheKey");
+    Hasher h;
+
+    // Plugin (decompiler) version.
+    //
+    h.add(RetDec::pluginVersion);
+    h.add(RetDec::pluginBuildDate);
+
+    // Decompiler config.
+    //
+    h.add(getDecompilerConfigText());
+
+    // Input file.
+    //
+    auto& profile = getBinaryProfile();
+    h.add(profile.md5, sizeof(profile.md5));
+    h.add(std::string(inf.procname));
+    h.add(uint64_t(inf.filetype));
+    h.add(uint64_t(inf.min_ea));
+    h.add(uint64_t(inf.is_64bit()));
+
+    // Function.
+    //
+    h.add(uint64_t(f->start_ea));
+    h.add(uint64_t(f->end_ea));
+    h.add(uint64_t(f->flags));
+
+    std::vector<uchar> bytes;
+    func_tail_iterator_t fti(f);
+    for (bool ok = fti.main(); ok; ok = fti.next())
+    {
+        const range_t& r = fti.chunk();
+        h.add(uint64_t(r.start_ea));
+        h.add(uint64_t(r.end_ea));
+
+        bytes.resize(r.size());
+        if (!bytes.empty())
+        {
+            get_bytes(bytes.data(), bytes.size(), r.start_ea);
+            h.add(bytes.data(), bytes.size());
+        }
+    }
+
+    qstring buff;
+    get_func_name(&buff, f->start_ea);
+    h.add(std::string(buff.c_str()));
+
+    buff.clear();
+    get_func_cmt(&buff, f, false);
+    h.add(std::string(buff.c_str()));
+
+    buff.clear();
+    print_type(&buff, f->start_ea, PRTYPE_1LINE);
+    h.add(std::string(buff.c_str()));
+
+    // Config entries - prototypes of the callees and types of the globals
+    // are in the output too.
+    //
+    auto objects = addReferencedNames(h, f);
+    h.add(getConfigEntriesText(f, objects));
+
+    if (refs)
+    {
+        *refs = std::move(objects);
+    }
+    return h.toString();
+}
+
+bool loadCachedOutput(func_t* f, const std::string& key, std::string& output)
+{
+    TRACE_SCOPE("loadCachedOutput");
+    netnode node(cacheNodeName);
+    if (node == BADNODE)
+    {
+        return false;
+    }
+
+    // Blob = key + '\0' + output.
+    bytevec_t blob;
+    if (node.getblob(&blob, f->start_ea, cacheBlobTag) <= 0
+            || blob.size() <= key.size()
+            || memcmp(blob.begin(), key.c_str(), key.size() + 1) != 0)
+    {
+        return false;
+    }
+
+    output.assign(
+            reinterpret_cast<const char*>(blob.begin()) + key.size() + 1,
+            blob.size() - key.size() - 1);
+    return true;
+}
+
+void storeCachedOutput(func_t* f, const std::string& key, const std::string& output)
+{
+    TRACE_SCOPE("storeCachedOutput");
+    netnode node;
+    if (!node.create(cacheNodeName))
+    {
+        node = netnode(cacheNodeName);
+    }
+
+    std::string blob = key;
+    blob.push_back('\0');
+    blob += output;
+    node.setblob(blob.data(), blob.size(), f->start_ea, cacheBlobTag);
+}
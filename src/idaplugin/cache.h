@@ -0,0 +1,40 @@
+#ifndef RETDEC_CACHE_H
+#define RETDEC_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * Persistent decompilation cache.
+ *
+ * RetDec JSON outputs are stored in the IDB (netnode blobs), so functions
+ * decompiled in the previous sessions do not have to be decompiled again
+ * after the database is reopened.
+ *
+ * Entries are content-addressed. The key is a hash of everything the
+ * decompilation of a function depends on - its bytes and ranges (all the
+ * chunks), name, type and comment, names, types and prototypes of the
+ * objects it references (their config entries), decompiler-config.json, the
+ * input file properties and the plugin version. When any of these
+ * changes, the key changes and the stale entry is simply not hit. There is
+ * at most one entry per function, a new one overwrites the old one.
+ *
+ * Must be used from the main thread only.
+ */
+
+/// Cache key of the decompilation of the given function.
+/// @param refs If not null, set to the (sorted) addresses of the objects the
+///             function references - the config entries it needs, see
+///             fillSelectiveConfig().
+std::string getCacheKey(func_t* f, std::vector<ea_t>* refs = nullptr);
+
+/// Get the decompiler output cached for the given function under the given
+/// key. Returns \c true if found.
+bool loadCachedOutput(func_t* f, const std::string& key, std::string& output);
+
+/// Cache the decompiler output of the given function under the given key.
+void storeCachedOutput(func_t* f, const std::string& key, const std::string& output);
+
+#endif
@@ -1,205 +1,173 @@
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include <allins.hpp>
+
 #include <retdec/utils/binary_path.h>
 
 #include "config.h"
-#include "retdec.h"
+#include "profile.h"
+#include "trace.h"
 #include "utils.h"
 
 /**
- * Perform startup check that determines, if plugin can decompile IDA's input file.
- * @return True if plugin can decompile IDA's input, false otherwise.
+ * IDA type -> LLVM IR type translation state.
  */
-bool canDecompileInput(
-        std::string& arch,
-        std::string& endian,
-        unsigned& bitSize,
-        retdec::common::Address& rawSectionVma,
-        retdec::common::Address& rawEntryPoint,
-        bool& isRaw
-)
+struct TypeContext
 {
-    std::string procName = inf.procname;
-    auto fileType = inf.filetype;
+    /// Already translated composite types (serialized IDA type -> LLVM IR
+    /// type). Structures are translated to their names.
+    std::map<std::string, std::string> translated;
+    /// Generated structure definitions (structure name -> LLVM IR definition).
+    std::map<std::string, std::string> structures;
+};
 
-    // 32-bit binary -> is_32bit() == 1 && is_64bit() == 0.
-    // 64-bit binary -> is_32bit() == 1 && is_64bit() == 1.
-    // Allow 64-bit x86 and arm.
-    if (inf.is_64bit())
-    {
-        if (!isX86() && procName != "ARM")
-        {
-            WARNING_GUI(RetDec::pluginName << " version " << RetDec::pluginVersion
-                    << " cannot decompile 64-bit for PROCNAME = " << procName
-            );
-            return false;
-        }
-    }
-    else if (!inf.is_32bit())
+/**
+ * Persistent config model.
+ *
+ * IDA functions and data are converted to config objects only once. After
+ * that, IDB change notifications (see RetDec::on_idb_event()) mark the
+ * affected objects dirty and only those are regenerated. Selective
+ * decompilations take just the entries they need from the model (see
+ * fillSelectiveConfig()), the whole program's config is filled only for full
+ * decompilations (see fillConfig()).
+ */
+struct ConfigModel
+{
+    /// Config header - everything but the objects, see generateHeader().
+    retdec::config::Config header;
+    /// Config the model was last materialized into.
+    const retdec::config::Config* filled = nullptr;
+    /// Input file the config header was generated for.
+    std::string inputFile;
+    /// Version of decompiler-config.json the header was generated from.
+    unsigned configVersion = 0;
+
+    bool headerDirty = true;
+    bool functionsDirty = true;
+    bool globalsDirty = true;
+    /// Filled config does not reflect the model, it must be materialized
+    /// again as a whole.
+    bool configDirty = true;
+
+    /// Start addresses of functions to regenerate.
+    std::set<ea_t> dirtyFunctions;
+    /// Addresses of data objects to regenerate.
+    std::set<ea_t> dirtyObjects;
+
+    /// Functions (including linked ones) and globals regenerated since the
+    /// filled config was materialized, with their entries in the config
+    /// (none if they were not there) - see materializeChanges().
+    std::map<ea_t, std::optional<retdec::common::Function>> staleFunctions;
+    std::map<ea_t, std::optional<retdec::common::Object>> staleGlobals;
+    /// Number of structures in the filled config - structures are only
+    /// added until the types are invalidated.
+    std::size_t filledStructures = 0;
+
+    /// IDA functions by their start addresses.
+    std::map<ea_t, retdec::common::Function> functions;
+    /// Linked functions defined by function-typed data (e.g. imports).
+    std::map<ea_t, retdec::common::Function> linkedFunctions;
+    /// Global variables by their addresses.
+    std::map<ea_t, retdec::common::Object> globals;
+    /// Functions classified by isLinkedFunction() (start -> is linked).
+    /// Survives regenerations, dropped on code changes.
+    std::map<ea_t, bool> linkage;
+
+    TypeContext types;
+};
+
+static ConfigModel model;
+
+/**
+ * Parsed decompiler-config.json.
+ *
+ * Parsing the config is expensive, so it is parsed only once, and re-read only
+ * when the file's modification time or size changes. Decompilations start
+ * from copies of the parsed config.
+ */
+struct ConfigTemplate
+{
+    fs::path path;
+    /// Directory relative paths in the config are relative to.
+    std::string baseDir;
+
+    bool exists = false;
+    fs::file_time_type mtime;
+    std::uintmax_t size = 0;
+    /// Incremented each time the file is (re)read.
+    unsigned version = 0;
+
+    /// File contents.
+    std::string text;
+    /// Parsed contents, with fixed relative paths.
+    retdec::config::Config config;
+};
+
+static ConfigTemplate configTemplate;
+
+/**
+ * Get the config template, re-read it if the file changed.
+ */
+const ConfigTemplate& getConfigTemplate()
+{
+    auto& t = configTemplate;
+    if (t.path.empty())
     {
-        WARNING_GUI(RetDec::pluginName << " version " << RetDec::pluginVersion
-                << " cannot decompile PROCNAME = " << procName
-        );
-        return false;
+        // Plugin path does not change - resolve it only once.
+        t.path = getDecompilerConfigPath(&t.baseDir);
     }
 
-    if (!(fileType == f_BIN
-        || fileType == f_PE
-        || fileType == f_ELF
-        || fileType == f_COFF
-        || fileType == f_MACHO
-        || fileType == f_HEX))
+    std::error_code ec;
+    bool exists = fs::exists(t.path, ec);
+    auto mtime = exists ? fs::last_write_time(t.path, ec) : fs::file_time_type();
+    auto size = exists ? fs::file_size(t.path, ec) : 0;
+    if (ec)
     {
-        if (fileType == f_LOADER)
-        {
-            WARNING_GUI("Custom IDA loader plugin was used.\n"
-                    "Decompilation will be attempted, but:\n"
-                    "1. RetDec idaplugin can not check if the input can be "
-                    "decompiled. Decompilation may fail.\n"
-                    "2. If the custom loader behaves differently than the RetDec "
-                    "loader, decompilation may fail or produce nonsensical result."
-            );
-        }
-        else
-        {
-            WARNING_GUI(RetDec::pluginName
-                    << " version " << RetDec::pluginVersion
-                    << " cannot decompile this input file (file type = "
-                    << fileType << ").\n"
-            );
-            return false;
-        }
+        exists = false;
     }
 
-    // Check Intel HEX.
-    //
-    if (fileType == f_HEX)
+    if (t.version > 0 && exists == t.exists && mtime == t.mtime && size == t.size)
     {
-        if (procName == "mipsr" || procName == "mipsb")
-        {
-            arch = "mips";
-            endian = "big";
-        }
-        else if (procName == "mipsrl"
-                || procName == "mipsl"
-                || procName == "psp")
-        {
-            arch = "mips";
-            endian = "little";
-        }
-        else
-        {
-            WARNING_GUI("Intel HEX input file can be decompiled only for one of "
-                    "these {mipsr, mipsb, mipsrl, mipsl, psp} processors, "
-                    "not \"" << procName << "\".\n");
-            return false;
-        }
+        return t;
     }
 
-    // Check BIN (RAW).
-    //
-    if (fileType == f_BIN)
-    {
-        if (inf.is_64bit())
-            bitSize = 64;
-        else if (inf.is_32bit())
-            bitSize = 32;
-        else
-        {
-            WARNING_GUI("Can decompile only 32/64 bit f_BIN.\n");
-            return false;
-        }
-        isRaw = true;
+    t.exists = exists;
+    t.mtime = mtime;
+    t.size = size;
+    ++t.version;
+    t.text.clear();
+    t.config = retdec::config::Config();
 
-        // Section VMA.
-        //
-        rawSectionVma = inf.min_ea;
+    if (exists)
+    {
+        TRACE_SCOPE("Config::fromFile");
 
-        // Entry point.
-        //
-        if (inf.start_ea != BADADDR)
-        {
-            rawEntryPoint = inf.start_ea;
-        }
-        else
-        {
-            rawEntryPoint = rawSectionVma;
-        }
+        std::ifstream file(t.path.string(), std::ios::binary);
+        t.text.assign(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
 
-        // Architecture + endian.
-        //
-        if (procName == "mipsr" || procName == "mipsb")
-        {
-            arch = "mips";
-            endian = "big";
-        }
-        else if (procName == "mipsrl" || procName == "mipsl" || procName == "psp")
-        {
-            arch = "mips";
-            endian = "little";
-        }
-        else if (procName == "ARM")
-        {
-            arch = "arm";
-            endian = "little";
-        }
-        else if (procName == "ARMB")
-        {
-            arch = "arm";
-            endian = "big";
-        }
-        else if (procName == "PPCL")
-        {
-            arch = "powerpc";
-            endian = "little";
-        }
-        else if (procName == "PPC")
-        {
-            arch = "powerpc";
-            endian = "big";
-        }
-        else if (isX86())
-        {
-            arch = inf.is_64bit() ? "x86-64" : "x86";
-            endian = "little";
-        }
-        else
-        {
-            WARNING_GUI("Binary input file can be decompiled only for one of these "
-                    "{mipsr, mipsb, mipsrl, mipsl, psp, ARM, ARMB, PPCL, PPC, 80386p, "
-                    "80386r, 80486p, 80486r, 80586p, 80586r, 80686p, p2, p3, p4} "
-                    "processors, not \"" << procName << "\".\n");
-            return false;
-        }
+        t.config = retdec::config::Config::fromFile(t.path.string());
+        t.config.parameters.fixRelativePaths(t.baseDir);
     }
 
-    return true;
+    return t;
 }
 
-bool generateHeader(retdec::config::Config& config, std::string out)
+const std::string& getDecompilerConfigText()
 {
-    auto inFile = getInputPath();
-    if (inFile.empty())
-    {
-        WARNING_GUI("Cannot decompile - there is no input file.");
-        return true;
-    }
-
-    std::string arch;
-    std::string endian;
-    unsigned bitSize = 0;
-    retdec::common::Address rawSectionVma;
-    retdec::common::Address rawEntryPoint;
-    bool isRaw = false;
-    if (!canDecompileInput(
-            arch,
-            endian,
-            bitSize,
-            rawSectionVma,
-            rawEntryPoint,
-            isRaw))
-    {
-        return true;
-    }
+    return getConfigTemplate().text;
+}
 
+fs::path getDecompilerConfigPath(std::string* baseDir)
+{
     auto idaPath = retdec::utils::getThisBinaryDirectoryPath();
     auto configPath = idaPath;
 
@@ -213,49 +181,57 @@ bool generateHeader(retdec::config::Config& config, std::string out)
     configPath.append("retdec");
     configPath.append("decompiler-config.json");
 
-    if (fs::exists(configPath))
+    if (baseDir)
     {
-        config = retdec::config::Config::fromFile(configPath.string());
-        if (plgPath.length() > 0)
-        {
-            config.parameters.fixRelativePaths(plgPath);
-        }
-        else
-        {
-            config.parameters.fixRelativePaths(idaPath.string());
-        }
+        *baseDir = plgPath.length() > 0 ? plgPath : idaPath.string();
+    }
+
+    return configPath;
+}
+
+bool generateHeader(retdec::config::Config& config, const std::string& inFile)
+{
+    TRACE_SCOPE("generateHeader");
+    // Never warns, see warnUndecompilableInput().
+    auto& profile = getBinaryProfile();
+    if (!profile.decompilable)
+    {
+        return true;
     }
 
-    if (!arch.empty())
+    auto& configTmpl = getConfigTemplate();
+    config = configTmpl.exists ? configTmpl.config : retdec::config::Config();
+    model.configVersion = configTmpl.version;
+
+    if (!profile.arch.empty())
     {
-        config.architecture.setName(arch);
+        config.architecture.setName(profile.arch);
     }
-    if (endian == "little")
+    if (profile.endian == "little")
     {
         config.architecture.setIsEndianLittle();
     }
-    else if (endian == "big")
+    else if (profile.endian == "big")
     {
         config.architecture.setIsEndianBig();
     }
-    if (rawSectionVma.isDefined())
+    if (profile.rawSectionVma.isDefined())
     {
-        config.parameters.setSectionVMA(rawSectionVma);
+        config.parameters.setSectionVMA(profile.rawSectionVma);
     }
-    if (rawEntryPoint.isDefined())
+    if (profile.rawEntryPoint.isDefined())
     {
-        config.parameters.setEntryPoint(rawEntryPoint);
+        config.parameters.setEntryPoint(profile.rawEntryPoint);
     }
 
-    if (isRaw && bitSize)
+    if (profile.isRaw && profile.bitSize)
     {
         config.fileFormat.setIsRaw();
-        config.fileFormat.setFileClassBits(bitSize);
-        config.architecture.setBitSize(bitSize);
+        config.fileFormat.setFileClassBits(profile.bitSize);
+        config.architecture.setBitSize(profile.bitSize);
     }
 
     config.parameters.setInputFile(inFile);
-    config.parameters.setOutputFile(out);
 
     return false;
 }
@@ -266,107 +242,184 @@ std::string defaultTypeString()
 }
 
 /**
- * TODO - recursive structure types?
+ * IDA type snapshot - everything needed to translate the type to an LLVM IR
+ * type, without touching IDA. Taken on the main thread by snapshotType(),
+ * translated on any thread by renderType().
+ * Composite types are translated only once (see TypeContext::translated), so
+ * their snapshots are just the cached LLVM IR types.
  */
-std::string type2string(
-        retdec::config::Config& config,
-        std::map<tinfo_t, std::string>& structIdSet,
-        const tinfo_t &type)
+struct TypeFacts
 {
-    std::string ret = defaultTypeString();
+    enum class Kind
+    {
+        SIMPLE,   ///< LLVM IR type, or structure name, in name.
+        POINTER,  ///< Pointer to children[0].
+        FUNCTION, ///< Returns children[0], arguments are children[1...].
+        ARRAY,    ///< arraySize elements of children[0].
+    };
 
-    if (type.empty())
-        return ret;
+    Kind kind = Kind::SIMPLE;
+    std::string name = defaultTypeString();
+    std::vector<TypeFacts> children;
+    int arraySize = 0;
+};
 
-    if (type.is_char() || type.is_uchar()) ret = "i8";
-    else if (type.is_int16() || type.is_uint16()) ret = "i16";
-    else if (type.is_int32() || type.is_uint() || type.is_uint32()) ret = "i32";
-    else if (type.is_int64() || type.is_uint64()) ret = "i64";
-    else if (type.is_int128()) ret = "i128";
-    else if (type.is_ldouble()) ret = "f80";
-    else if (type.is_double()) ret = "double";
-    else if (type.is_float()) ret = "float";
-    else if (type.is_bool()) ret = "i1";
-    else if (type.is_void()) ret = "void";
-    else if (type.is_unknown()) ret = "i32";
+TypeFacts simpleType(const std::string& name)
+{
+    TypeFacts ret;
+    ret.name = name;
+    return ret;
+}
 
-    else if (type.is_ptr())
-    {
-        tinfo_t base = type.get_pointed_object();
-        ret = type2string(config, structIdSet, base) + "*";
-    }
-    else if (type.is_func())
+/**
+ * Translate the type snapshot to an LLVM IR type.
+ * Does not touch IDA - may be called from any thread.
+ */
+std::string renderType(const TypeFacts& type)
+{
+    switch (type.kind)
     {
-        func_type_data_t fncType;
-        if (type.get_func_details(&fncType))
+        case TypeFacts::Kind::POINTER:
+        {
+            return renderType(type.children[0]) + "*";
+        }
+        case TypeFacts::Kind::FUNCTION:
         {
-            ret = type2string(config, structIdSet, fncType.rettype);
+            std::string ret = renderType(type.children[0]);
             ret += "(";
-
-            bool first = true;
-            for (auto const &a : fncType)
+            for (std::size_t i = 1; i < type.children.size(); ++i)
             {
-                if (first)
-                {
-                    first = false;
-                }
-                else
+                if (i > 1)
                 {
                     ret += ", ";
                 }
-
-                ret += type2string(config, structIdSet, a.type);
+                ret += renderType(type.children[i]);
             }
-
             ret += ")";
+            return ret;
         }
-        else
+        case TypeFacts::Kind::ARRAY:
+        {
+            std::string baseType = renderType(type.children[0]);
+            if (type.arraySize > 0)
+            {
+                return "[" + std::to_string(type.arraySize) + " x " + baseType + "]";
+            }
+            return baseType + "*";
+        }
+        case TypeFacts::Kind::SIMPLE:
+        default:
         {
-            ret = "i32*";
+            return type.name;
         }
     }
-    else if (type.is_array())
+}
+
+/**
+ * Key of the type in TypeContext::translated, empty if the type cannot be
+ * serialized.
+ */
+std::string typeKey(const tinfo_t& type)
+{
+    qtype typeStr;
+    qtype fields;
+    if (!type.serialize(&typeStr, &fields))
     {
-        tinfo_t base = type.get_array_element();
-        std::string baseType = type2string(config, structIdSet, base);
-        int arraySize = type.get_array_nelems();
+        return std::string();
+    }
+
+    std::string key(reinterpret_cast<const char*>(typeStr.c_str()), typeStr.length());
+    key += '\0';
+    key.append(reinterpret_cast<const char*>(fields.c_str()), fields.length());
+    return key;
+}
+
+/**
+ * Snapshot of the IDA type. Composite types are translated right away and
+ * cached in @p types - structure definitions are added to it as well, and
+ * only their names are in the snapshot.
+ */
+TypeFacts snapshotType(TypeContext& types, const tinfo_t &type)
+{
+    if (type.empty())
+        return simpleType(defaultTypeString());
+
+    if (type.is_char() || type.is_uchar()) return simpleType("i8");
+    else if (type.is_int16() || type.is_uint16()) return simpleType("i16");
+    else if (type.is_int32() || type.is_uint() || type.is_uint32()) return simpleType("i32");
+    else if (type.is_int64() || type.is_uint64()) return simpleType("i64");
+    else if (type.is_int128()) return simpleType("i128");
+    else if (type.is_ldouble()) return simpleType("f80");
+    else if (type.is_double()) return simpleType("double");
+    else if (type.is_float()) return simpleType("float");
+    else if (type.is_bool()) return simpleType("i1");
+    else if (type.is_void()) return simpleType("void");
+    else if (type.is_unknown()) return simpleType("i32");
+
+    std::string key = typeKey(type);
+    if (!key.empty())
+    {
+        auto it = types.translated.find(key);
+        if (it != types.translated.end())
+        {
+            return simpleType(it->second);
+        }
+    }
 
-        if (arraySize > 0)
+    TypeFacts ret;
+    if (type.is_ptr())
+    {
+        ret.kind = TypeFacts::Kind::POINTER;
+        ret.children.push_back(snapshotType(types, type.get_pointed_object()));
+    }
+    else if (type.is_func())
+    {
+        func_type_data_t fncType;
+        if (type.get_func_details(&fncType))
         {
-            ret = "[" + std::to_string(arraySize) + " x " + baseType + "]";
+            ret.kind = TypeFacts::Kind::FUNCTION;
+            ret.children.reserve(fncType.size() + 1);
+            ret.children.push_back(snapshotType(types, fncType.rettype));
+            for (auto const &a : fncType)
+            {
+                ret.children.push_back(snapshotType(types, a.type));
+            }
         }
         else
         {
-            ret = baseType + "*";
+            ret.name = "i32*";
         }
     }
+    else if (type.is_array())
+    {
+        ret.kind = TypeFacts::Kind::ARRAY;
+        ret.children.push_back(snapshotType(types, type.get_array_element()));
+        ret.arraySize = type.get_array_nelems();
+    }
     else if (type.is_struct())
     {
-        auto it = structIdSet.find(type);
+        // Structure which cannot be cached might contain itself.
+        if (key.empty())
+        {
+            return simpleType(defaultTypeString());
+        }
+
         std::string strName = "%";
+        qstring idaStrName = ""; // make sure it is empty.
 
-        // This structure have already been generated.
-        //
-        if (it != structIdSet.end())
+        if (type.get_final_type_name(&idaStrName) && !idaStrName.empty())
         {
-            return it->second;
+            strName += idaStrName.c_str();
         }
         else
         {
-            qstring idaStrName = ""; // make sure it is empty.
-
-            if (type.get_final_type_name(&idaStrName) && !idaStrName.empty())
-            {
-                strName += idaStrName.c_str();
-            }
-            else
-            {
-                strName += "struct_" + std::to_string(config.structures.size());
-            }
-
-            structIdSet[type] = strName;
+            strName += "struct_" + std::to_string(types.structures.size());
         }
 
+        // Cached before the members are translated - members of recursive
+        // structures (pointers to the structure itself) get its name.
+        types.translated[key] = strName;
+
         std::string body;
 
         int elemCnt = type.get_udt_nmembers();
@@ -383,7 +436,7 @@ std::string type2string(
 
                 if (type.find_udt_member(&mem, STRMEM_INDEX) >= 0)
                 {
-                    memType = type2string(config, structIdSet, mem.type);
+                    memType = renderType(snapshotType(types, mem.type));
                 }
 
                 if (first)
@@ -405,34 +458,20 @@ std::string type2string(
             body = "{ " + defaultTypeString() + " }";
         }
 
-        ret = strName;  // only structure name is returned.
+        types.structures[strName] = strName + " = type " + body;
 
-        retdec::common::Type ccType(strName + " = type " + body);
-        config.structures.insert(ccType);
-    }
-    else if (type.is_union())
-    {
-        ret = defaultTypeString();
-    }
-    else if (type.is_enum())
-    {
-        ret = defaultTypeString();
+        return simpleType(strName);  // only structure name is returned.
     }
-    else if (type.is_sue())
-    {
-        ret = defaultTypeString();
-    }
-    // http://en.cppreference.com/w/cpp/language/bit_field
-    else if (type.is_bitfield())
-    {
-        ret = defaultTypeString();
-    }
-    else
+    // Unions, enums, bitfields
+    // (http://en.cppreference.com/w/cpp/language/bit_field), ...
+    // are not supported - default type.
+
+    std::string translated = renderType(ret);
+    if (!key.empty())
     {
-        ret = defaultTypeString();
+        types.translated.emplace(key, translated);
     }
-
-    return ret;
+    return simpleType(translated);
 }
 
 std::string addrType2string(ea_t addr)
@@ -525,26 +564,41 @@ std::string addrType2string(ea_t addr)
     return ret;
 }
 
+/**
+ * Is the function just a stub of a dynamically linked function?
+ * Either there is no code in function = no instructions, or only
+ * instructions are x86 "retn".
+ * Classification is cached in the model, see invalidateConfigCode().
+ */
 bool isLinkedFunction(func_t* fnc)
 {
-    // Either there is no code in function = no instructions,
-    // or only instructions have "retn" mnemonics.
-    //
-    for (ea_t addr = fnc->start_ea; addr < fnc->end_ea; ++addr)
+    auto cached = model.linkage.find(fnc->start_ea);
+    if (cached != model.linkage.end())
+    {
+        return cached->second;
+    }
+
+    bool x86 = isX86();
+    bool linked = true;
+    for (ea_t addr = fnc->start_ea;
+            addr < fnc->end_ea && addr != BADADDR;
+            addr = next_head(addr, fnc->end_ea))
     {
-        flags_t flags = get_flags(addr);
-        if (is_code(flags))
+        if (!is_code(get_flags(addr)))
         {
-            qstring mnem;
-            print_insn_mnem(&mnem, addr);
-            if (mnem != "retn")
-            {
-                return false;
-            }
+            continue;
+        }
+
+        insn_t insn;
+        if (!x86 || decode_insn(&insn, addr) <= 0 || insn.itype != NN_retn)
+        {
+            linked = false;
+            break;
         }
     }
 
-    return true;
+    model.linkage.emplace(fnc->start_ea, linked);
+    return linked;
 }
 
 void generateCallingConvention(
@@ -622,107 +676,161 @@ retdec::common::Storage generateObjectLocation(
     }
 }
 
-void generateFunctionType(
-        retdec::config::Config& config,
-        std::map<tinfo_t, std::string>& structIdSet,
-        const tinfo_t &fncType,
-        retdec::common::Function &ccFnc)
+/**
+ * Function type snapshot, see snapshotFunctionType().
+ */
+struct FunctionTypeFacts
 {
-    // Generate arguments and return from function type.
-    //
+    struct Parameter
+    {
+        std::string name;
+        retdec::common::Storage storage;
+        TypeFacts type;
+    };
+
+    /// Are the function details known? Nothing else is set if not.
+    bool present = false;
+    TypeFacts returnType;
+    retdec::common::Storage returnStorage;
+    std::vector<Parameter> parameters;
+    cm_t callingConvention = CM_CC_UNKNOWN;
+};
+
+FunctionTypeFacts snapshotFunctionType(TypeContext& types, const tinfo_t &fncType)
+{
+    FunctionTypeFacts ret;
+
     func_type_data_t fncInfo;
-    if (fncType.get_func_details(&fncInfo))
+    if (!fncType.get_func_details(&fncInfo))
     {
-        // Return info.
-        //
-        ccFnc.returnType.setLlvmIr(type2string(
-                config,
-                structIdSet,
-                fncInfo.rettype)
-        );
-        ccFnc.returnStorage = generateObjectLocation(
-                fncInfo.retloc,
-                fncInfo.rettype
-        );
-
-        // Argument info.
-        //
-        unsigned cntr = 1;
-        for (auto const& a : fncInfo)
+        // TODO: ???
+        return ret;
+    }
+    ret.present = true;
+
+    // Return info.
+    //
+    ret.returnType = snapshotType(types, fncInfo.rettype);
+    ret.returnStorage = generateObjectLocation(
+            fncInfo.retloc,
+            fncInfo.rettype
+    );
+
+    // Argument info.
+    //
+    unsigned cntr = 1;
+    for (auto const& a : fncInfo)
+    {
+        FunctionTypeFacts::Parameter arg;
+        arg.name = a.name.c_str();
+        if (arg.name.empty())
         {
-            std::string name = a.name.c_str();
-            if (name.empty())
-            {
-                name = "a" + std::to_string(cntr);
-            }
+            arg.name = "a" + std::to_string(cntr);
+        }
+        arg.storage = generateObjectLocation(a.argloc, a.type);
+        arg.type = snapshotType(types, a.type);
 
-            auto s = generateObjectLocation(a.argloc, a.type);
-            retdec::common::Object arg(name, s);
-            arg.type.setLlvmIr(type2string(config, structIdSet, a.type));
+        ret.parameters.push_back(std::move(arg));
 
-            ccFnc.parameters.push_back(arg);
+        ++cntr;
+    }
 
-            ++cntr;
-        }
+    ret.callingConvention = fncType.get_cc();
 
-        // Calling convention.
-        //
-        generateCallingConvention(fncType.get_cc(), ccFnc.callingConvention);
-        if (fncType.get_cc() == CM_CC_ELLIPSIS)
-        {
-            ccFnc.setIsVariadic(true);
-        }
+    return ret;
+}
+
+/**
+ * Generate arguments and return of the function from its type snapshot.
+ * Does not touch IDA - may be called from any thread.
+ */
+void generateFunctionType(
+        const FunctionTypeFacts& fncType,
+        retdec::common::Function &ccFnc)
+{
+    if (!fncType.present)
+    {
+        return;
     }
-    else
+
+    ccFnc.returnType.setLlvmIr(renderType(fncType.returnType));
+    ccFnc.returnStorage = fncType.returnStorage;
+
+    for (auto const& a : fncType.parameters)
     {
-        // TODO: ???
+        retdec::common::Object arg(a.name, a.storage);
+        arg.type.setLlvmIr(renderType(a.type));
+
+        ccFnc.parameters.push_back(arg);
+    }
+
+    // Calling convention.
+    //
+    generateCallingConvention(fncType.callingConvention, ccFnc.callingConvention);
+    if (fncType.callingConvention == CM_CC_ELLIPSIS)
+    {
+        ccFnc.setIsVariadic(true);
     }
 }
 
-void generateFunction(
-        retdec::config::Config& config,
-        std::map<tinfo_t, std::string>& structIdSet,
-        func_t* fnc)
+/**
+ * Snapshot of a function - IDA function, or a linked function defined by
+ * function-typed data. Taken on the main thread, converted to the config
+ * function by generateFunction() on any thread.
+ */
+struct FunctionFacts
+{
+    enum class Linkage
+    {
+        USER_DEFINED,
+        STATICALLY_LINKED,
+        DYNAMICALLY_LINKED,
+    };
+
+    ea_t start = BADADDR;
+    ea_t end = BADADDR;
+    std::string name;
+    std::string comment;
+    std::string demangledName;
+    Linkage linkage = Linkage::USER_DEFINED;
+    FunctionTypeFacts type;
+};
+
+FunctionFacts snapshotFunction(TypeContext& types, func_t* fnc)
 {
+    FunctionFacts ret;
+    ret.start = fnc->start_ea;
+    ret.end = fnc->end_ea;
+
     qstring qFncName;
     get_func_name(&qFncName, fnc->start_ea);
 
-    std::string fncName = qFncName.c_str();
-    std::replace(fncName.begin(), fncName.end(), '.', '_');
-
-    retdec::common::Function ccFnc(fncName);
-    ccFnc.setStart(fnc->start_ea);
-    ccFnc.setEnd(fnc->end_ea);
-    // TODO: return type is always set to default: ugly, make it better.
-    ccFnc.returnType.setLlvmIr(defaultTypeString());
+    ret.name = qFncName.c_str();
+    std::replace(ret.name.begin(), ret.name.end(), '.', '_');
 
     qstring qCmt;
     if (get_func_cmt(&qCmt, fnc, false) > 0)
     {
-        ccFnc.setComment(qCmt.c_str());
+        ret.comment = qCmt.c_str();
     }
 
     qstring qDemangled;
-    if (demangle_name(&qDemangled, fncName.c_str(), MNG_SHORT_FORM) > 0)
+    if (demangle_name(&qDemangled, ret.name.c_str(), MNG_SHORT_FORM) > 0)
     {
-        ccFnc.setDemangledName(qDemangled.c_str());
+        ret.demangledName = qDemangled.c_str();
     }
 
     if (fnc->flags & FUNC_STATICDEF)
     {
-        ccFnc.setIsStaticallyLinked();
+        ret.linkage = FunctionFacts::Linkage::STATICALLY_LINKED;
     }
     else if (fnc->flags & FUNC_LIB)
     {
-        ccFnc.setIsDynamicallyLinked();
+        ret.linkage = FunctionFacts::Linkage::DYNAMICALLY_LINKED;
     }
     else if (isLinkedFunction(fnc))
     {
-        ccFnc.setIsDynamicallyLinked();
-    }
-    else
-    {
-        ccFnc.setIsUserDefined();
+        ret.linkage = FunctionFacts::Linkage::DYNAMICALLY_LINKED;
     }
 
     // For IDA 6.x (don't know about IDA 7.x):
@@ -744,30 +852,307 @@ void generateFunction(
 
     if (fncType.is_func())
     {
-        generateFunctionType(config, structIdSet, fncType, ccFnc);
+        ret.type = snapshotFunctionType(types, fncType);
     }
 
-    config.functions.insert(ccFnc);
+    return ret;
 }
 
-void generateFunctions(
-        retdec::config::Config& config,
-        std::map<tinfo_t, std::string>& structIdSet)
+/**
+ * Does not touch IDA - may be called from any thread.
+ */
+retdec::common::Function generateFunction(const FunctionFacts& fnc)
 {
-    for (unsigned i = 0; i < get_func_qty(); ++i)
+    retdec::common::Function ccFnc(fnc.name);
+    ccFnc.setStart(fnc.start);
+    ccFnc.setEnd(fnc.end);
+    // TODO: return type is always set to default: ugly, make it better.
+    ccFnc.returnType.setLlvmIr(defaultTypeString());
+
+    if (!fnc.comment.empty())
     {
-        generateFunction(config, structIdSet, getn_func(i));
+        ccFnc.setComment(fnc.comment);
+    }
+    if (!fnc.demangledName.empty())
+    {
+        ccFnc.setDemangledName(fnc.demangledName);
     }
-}
-
-void generateGlobals(
-        retdec::config::Config& config,
-        std::map<tinfo_t, std::string>& structIdSet)
-{
-    qstring buff;
 
-    int segNum = get_segm_qty();
-    for (int i = 0; i < segNum; ++i)
+    switch (fnc.linkage)
+    {
+        case FunctionFacts::Linkage::STATICALLY_LINKED:
+            ccFnc.setIsStaticallyLinked();
+            break;
+        case FunctionFacts::Linkage::DYNAMICALLY_LINKED:
+            ccFnc.setIsDynamicallyLinked();
+            break;
+        case FunctionFacts::Linkage::USER_DEFINED:
+        default:
+            ccFnc.setIsUserDefined();
+            break;
+    }
+
+    generateFunctionType(fnc.type, ccFnc);
+
+    return ccFnc;
+}
+
+/**
+ * Global variable snapshot, converted by generateGlobal().
+ */
+struct GlobalFacts
+{
+    ea_t head = BADADDR;
+    std::string name;
+    TypeFacts type;
+};
+
+/**
+ * Does not touch IDA - may be called from any thread.
+ */
+retdec::common::Object generateGlobal(const GlobalFacts& g)
+{
+    auto s = retdec::common::Storage::inMemory(
+            retdec::common::Address(g.head));
+    retdec::common::Object global(g.name, s);
+    global.type.setLlvmIr(renderType(g.type));
+    return global;
+}
+
+/**
+ * Minimal number of objects converted by one thread - there is no point in
+ * starting threads for less.
+ */
+constexpr std::size_t parallelConversionMin = 512;
+
+/**
+ * Convert the snapshots using all the cores.
+ * @p convert must not touch IDA.
+ * Results are in the order of the snapshots - the merge into the model is
+ * deterministic, whatever the number of threads.
+ */
+template <typename Facts, typename Convert>
+auto convertParallel(const std::vector<Facts>& facts, Convert convert)
+{
+    using Result = decltype(convert(facts.front()));
+
+    std::size_t workers = std::thread::hardware_concurrency();
+    workers = std::max<std::size_t>(1, std::min(
+            workers,
+            facts.size() / parallelConversionMin));
+
+    // Each worker converts one contiguous chunk.
+    std::vector<std::vector<Result>> chunks(workers);
+    TraceRunId traceRun = currentTraceRun();
+    auto worker = [&](std::size_t w)
+    {
+        TraceRunScope traceScope(traceRun);
+        TRACE_SCOPE("convert");
+        std::size_t begin = facts.size() * w / workers;
+        std::size_t end = facts.size() * (w + 1) / workers;
+        chunks[w].reserve(end - begin);
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            chunks[w].push_back(convert(facts[i]));
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t w = 1; w < workers; ++w)
+    {
+        threads.emplace_back(worker, w);
+    }
+    worker(0);
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    std::vector<Result> ret;
+    ret.reserve(facts.size());
+    for (auto& c : chunks)
+    {
+        std::move(c.begin(), c.end(), std::back_inserter(ret));
+    }
+    return ret;
+}
+
+/**
+ * Remember the entry the filled config has for the function (or linked
+ * function) at @p ea before it is regenerated, see materializeChanges().
+ */
+void markStaleFunction(ea_t ea)
+{
+    if (model.filled == nullptr || model.configDirty || model.staleFunctions.count(ea))
+    {
+        return;
+    }
+
+    std::optional<retdec::common::Function> entry;
+    auto it = model.functions.find(ea);
+    if (it != model.functions.end())
+    {
+        entry = it->second;
+    }
+    else if ((it = model.linkedFunctions.find(ea)) != model.linkedFunctions.end())
+    {
+        entry = it->second;
+    }
+    model.staleFunctions.emplace(ea, std::move(entry));
+}
+
+/**
+ * Remember the entry the filled config has for the global variable at @p ea
+ * before it is regenerated, see materializeChanges().
+ */
+void markStaleGlobal(ea_t ea)
+{
+    if (model.filled == nullptr || model.configDirty || model.staleGlobals.count(ea))
+    {
+        return;
+    }
+
+    std::optional<retdec::common::Object> entry;
+    auto it = model.globals.find(ea);
+    if (it != model.globals.end())
+    {
+        entry = it->second;
+    }
+    model.staleGlobals.emplace(ea, std::move(entry));
+}
+
+void generateFunctions()
+{
+    TRACE_SCOPE("generateFunctions");
+    model.functions.clear();
+    model.configDirty = true;
+
+    // IDA is not thread-safe - take the snapshots here, and convert them
+    // in parallel.
+    std::vector<FunctionFacts> facts;
+    facts.reserve(get_func_qty());
+    for (unsigned i = 0; i < get_func_qty(); ++i)
+    {
+        facts.push_back(snapshotFunction(model.types, getn_func(i)));
+    }
+
+    auto fncs = convertParallel(facts, generateFunction);
+    for (std::size_t i = 0; i < fncs.size(); ++i)
+    {
+        model.functions.emplace_hint(
+                model.functions.end(),
+                facts[i].start,
+                std::move(fncs[i]));
+    }
+}
+
+/**
+ * (Re)generate the function starting at @p ea, or drop it from the model if
+ * there is no such function anymore.
+ */
+void updateFunction(ea_t ea)
+{
+    markStaleFunction(ea);
+    model.functions.erase(ea);
+
+    func_t* fnc = get_func(ea);
+    if (fnc != nullptr && fnc->start_ea == ea)
+    {
+        model.functions.emplace(
+                ea,
+                generateFunction(snapshotFunction(model.types, fnc)));
+    }
+}
+
+/**
+ * Snapshot of a global object - variable or linked function - at the given
+ * head, if there is any. Exactly one of @p var and @p fnc is filled.
+ * Returns \c true if there is no global object.
+ */
+bool snapshotGlobal(ea_t head, qstring& buff, GlobalFacts& var, FunctionFacts& fnc)
+{
+    flags_t f = get_full_flags(head);
+    if (f == 0)
+    {
+        return true;
+    }
+
+    // Argument 1 should not be present for data.
+    // Some object do have argument 0 (off_X), some dont (strings).
+    //
+    if (!is_data(f) || !is_head(f) || /*!is_defarg0(f) ||*/ is_defarg1(f))
+    {
+        return true;
+    }
+
+    if (!has_any_name(f)) // usually alignment.
+    {
+        return true;
+    }
+
+    if (get_name(&buff, head) <= 0)
+    {
+        return true;
+    }
+
+    // Get type.
+    //
+    tinfo_t getType;
+    get_tinfo(&getType, head);
+
+    if (!getType.empty() && getType.present() && getType.is_func())
+    {
+        if (model.functions.count(head))
+        {
+            return true;
+        }
+
+        fnc.start = head;
+        fnc.end = head;
+        fnc.name = buff.c_str();
+        std::replace(fnc.name.begin(), fnc.name.end(), '.', '_');
+        fnc.linkage = FunctionFacts::Linkage::DYNAMICALLY_LINKED;
+        fnc.type = snapshotFunctionType(model.types, getType);
+
+        qstring qDemangled;
+        if (demangle_name(&qDemangled, fnc.name.c_str(), MNG_SHORT_FORM) > 0)
+        {
+            fnc.demangledName = qDemangled.c_str();
+        }
+
+        return false;
+    }
+
+    // Continue creating global variable.
+    //
+    var.head = head;
+    var.name = buff.c_str();
+    if (!getType.empty() && getType.present())
+    {
+        var.type = snapshotType(model.types, getType);
+    }
+    else
+    {
+        var.type = simpleType(addrType2string(head));
+    }
+
+    return false;
+}
+
+void generateGlobals()
+{
+    TRACE_SCOPE("generateGlobals");
+    qstring buff;
+
+    model.globals.clear();
+    model.linkedFunctions.clear();
+    model.configDirty = true;
+
+    std::vector<GlobalFacts> vars;
+    std::vector<FunctionFacts> fncs;
+
+    int segNum = get_segm_qty();
+    for (int i = 0; i < segNum; ++i)
     {
         segment_t* seg = getnseg(i);
         if (seg == nullptr)
@@ -783,95 +1168,433 @@ void generateGlobals(
         ea_t head = seg->start_ea - 1;
         while ( (head = next_head(head, seg->end_ea)) != BADADDR)
         {
-            flags_t f = get_full_flags(head);
-            if (f == 0)
+            GlobalFacts var;
+            FunctionFacts fnc;
+            if (snapshotGlobal(head, buff, var, fnc))
             {
                 continue;
             }
-
-            // Argument 1 should not be present for data.
-            // Some object do have argument 0 (off_X), some dont (strings).
-            //
-            if (!is_data(f) || !is_head(f) || /*!is_defarg0(f) ||*/ is_defarg1(f))
+            if (var.head != BADADDR)
             {
-                continue;
+                vars.push_back(std::move(var));
             }
-
-            if (!has_any_name(f)) // usually alignment.
+            else
             {
-                continue;
+                fncs.push_back(std::move(fnc));
             }
+        }
+    }
 
-            if (get_name(&buff, head) <= 0)
-            {
-                continue;
-            }
+    auto globals = convertParallel(vars, generateGlobal);
+    for (std::size_t i = 0; i < globals.size(); ++i)
+    {
+        model.globals.emplace(vars[i].head, std::move(globals[i]));
+    }
+    auto linked = convertParallel(fncs, generateFunction);
+    for (std::size_t i = 0; i < linked.size(); ++i)
+    {
+        model.linkedFunctions.emplace(fncs[i].start, std::move(linked[i]));
+    }
+}
 
-            auto s = retdec::common::Storage::inMemory(
-                    retdec::common::Address(head));
-            retdec::common::Object global(buff.c_str(), s);
+/**
+ * (Re)generate a global object at @p ea, or drop it from the model if there
+ * is no such object anymore.
+ */
+void updateGlobal(ea_t ea)
+{
+    qstring buff;
 
-            // Get type.
-            //
-            tinfo_t getType;
-            get_tinfo(&getType, head);
+    markStaleGlobal(ea);
+    markStaleFunction(ea);
+    model.globals.erase(ea);
+    model.linkedFunctions.erase(ea);
 
-            if (!getType.empty() && getType.present() && getType.is_func())
-            {
-                if (config.functions.getFunctionByStartAddress(head) != nullptr)
-                {
-                    continue;
-                }
+    segment_t* seg = getseg(ea);
+    if (seg == nullptr || get_visible_segm_name(&buff, seg) <= 0)
+    {
+        return;
+    }
 
-                std::string fncName = buff.c_str();
-                std::replace(fncName.begin(), fncName.end(), '.', '_');
+    GlobalFacts var;
+    FunctionFacts fnc;
+    if (snapshotGlobal(ea, buff, var, fnc))
+    {
+        return;
+    }
+    if (var.head != BADADDR)
+    {
+        model.globals.emplace(ea, generateGlobal(var));
+    }
+    else
+    {
+        model.linkedFunctions.emplace(ea, generateFunction(fnc));
+    }
+}
 
-                retdec::common::Function ccFnc(fncName);
-                ccFnc.setStart(head);
-                ccFnc.setEnd(head);
-                ccFnc.setIsDynamicallyLinked();
-                generateFunctionType(config, structIdSet, getType, ccFnc);
+/**
+ * Bring the model up to date with the IDA database.
+ */
+void updateModel()
+{
+    if (model.functionsDirty)
+    {
+        generateFunctions();
+        model.functionsDirty = false;
+        model.dirtyFunctions.clear();
+    }
+    for (ea_t ea : model.dirtyFunctions)
+    {
+        updateFunction(ea);
+    }
+    model.dirtyFunctions.clear();
 
-                qstring qDemangled;
-                if (demangle_name(&qDemangled, fncName.c_str(), MNG_SHORT_FORM) > 0)
-                {
-                    ccFnc.setDemangledName(qDemangled.c_str());
-                }
+    // Globals must go after functions - function-typed data are skipped if
+    // there is a function on the same address.
+    //
+    if (model.globalsDirty)
+    {
+        generateGlobals();
+        model.globalsDirty = false;
+        model.dirtyObjects.clear();
+    }
+    for (ea_t ea : model.dirtyObjects)
+    {
+        updateGlobal(ea);
+    }
+    model.dirtyObjects.clear();
+}
 
-                config.functions.insert(ccFnc);
-                continue;
-            }
+/**
+ * Copy the model into the config's object containers.
+ */
+void materializeModel(retdec::config::Config& config)
+{
+    TRACE_SCOPE("materializeModel");
+    config.structures.clear();
+    config.functions.clear();
+    config.globals.clear();
 
-            // Continue creating global variable.
-            //
-            if (!getType.empty() && getType.present())
-            {
-                global.type.setLlvmIr(type2string(config, structIdSet, getType));
-            }
-            else
-            {
-                global.type.setLlvmIr(addrType2string(head));
-            }
+    for (auto& p : model.types.structures)
+    {
+        config.structures.insert(retdec::common::Type(p.second));
+    }
+    for (auto& p : model.functions)
+    {
+        config.functions.insert(p.second);
+    }
+    for (auto& p : model.linkedFunctions)
+    {
+        config.functions.insert(p.second);
+    }
+    for (auto& p : model.globals)
+    {
+        config.globals.insert(p.second);
+    }
+
+    model.filledStructures = model.types.structures.size();
+    model.staleFunctions.clear();
+    model.staleGlobals.clear();
+}
+
+/**
+ * Update only the entries of the materialized config which were regenerated
+ * since, see markStaleFunction() and markStaleGlobal().
+ */
+void materializeChanges(retdec::config::Config& config)
+{
+    // All the stale entries go first - a regenerated object may take the
+    // name of another one.
+    for (auto& p : model.staleFunctions)
+    {
+        if (!p.second)
+        {
+            continue;
+        }
+        // Another function may have the same name.
+        auto it = config.functions.find(*p.second);
+        if (it != config.functions.end() && it->getStart() == p.second->getStart())
+        {
+            config.functions.erase(it);
+        }
+    }
+    for (auto& p : model.staleGlobals)
+    {
+        if (!p.second)
+        {
+            continue;
+        }
+        auto it = config.globals.find(*p.second);
+        if (it != config.globals.end()
+                && it->getStorage().getAddress() == p.second->getStorage().getAddress())
+        {
+            config.globals.erase(it);
+        }
+    }
+
+    for (auto& p : model.staleFunctions)
+    {
+        auto it = model.functions.find(p.first);
+        if (it != model.functions.end())
+        {
+            config.functions.insert(it->second);
+        }
+        it = model.linkedFunctions.find(p.first);
+        if (it != model.linkedFunctions.end())
+        {
+            config.functions.insert(it->second);
+        }
+    }
+    for (auto& p : model.staleGlobals)
+    {
+        auto it = model.globals.find(p.first);
+        if (it != model.globals.end())
+        {
+            config.globals.insert(it->second);
+        }
+    }
 
-            config.globals.insert(global);
+    if (model.filledStructures != model.types.structures.size())
+    {
+        for (auto& p : model.types.structures)
+        {
+            config.structures.insert(retdec::common::Type(p.second));
         }
+        model.filledStructures = model.types.structures.size();
     }
+
+    model.staleFunctions.clear();
+    model.staleGlobals.clear();
+}
+
+/**
+ * Regenerate the config header if it is invalidated, or if the input file or
+ * decompiler-config.json changed.
+ * Returns \c true if something went wrong.
+ */
+bool updateHeader(const std::string& inFile)
+{
+    if (!model.headerDirty
+            && model.inputFile == inFile
+            && model.configVersion == getConfigTemplate().version)
+    {
+        return false;
+    }
+
+    if (generateHeader(model.header, inFile))
+    {
+        return true;
+    }
+    model.inputFile = inFile;
+    model.headerDirty = false;
+    model.configDirty = true;
+    return false;
 }
 
 bool fillConfig(retdec::config::Config& config, const std::string& out)
 {
-    std::map<tinfo_t, std::string> structIdSet;
+    TRACE_SCOPE("fillConfig");
+    auto inFile = getInputPath();
+    if (inFile.empty())
+    {
+        WARNING_GUI("Cannot decompile - there is no input file.");
+        return true;
+    }
+    if (updateHeader(inFile))
+    {
+        return true;
+    }
+    updateModel();
 
-    config.structures.clear();
-    config.functions.clear();
-    config.globals.clear();
+    if (model.configDirty || model.filled != &config)
+    {
+        config = model.header;
+        materializeModel(config);
+        model.filled = &config;
+        model.configDirty = false;
+    }
+    else
+    {
+        materializeChanges(config);
+    }
+    config.parameters.setOutputFile(out);
 
-    if (generateHeader(config, out))
+    return false;
+}
+
+/**
+ * Add the model's entries of the functions and globals at @p eas to
+ * @p config.
+ */
+void addEntries(retdec::config::Config& config, const std::vector<ea_t>& eas)
+{
+    for (ea_t ea : eas)
+    {
+        auto it = model.functions.find(ea);
+        if (it != model.functions.end())
+        {
+            config.functions.insert(it->second);
+        }
+        else if ((it = model.linkedFunctions.find(ea)) != model.linkedFunctions.end())
+        {
+            config.functions.insert(it->second);
+        }
+
+        auto git = model.globals.find(ea);
+        if (git != model.globals.end())
+        {
+            config.globals.insert(git->second);
+        }
+    }
+}
+
+/**
+ * Names of the structures used in the serialized config entries @p text,
+ * and of the ones used by them. Structures are referenced only by their
+ * names.
+ */
+std::set<std::string> getUsedStructures(const std::string& text)
+{
+    std::set<std::string> used;
+    std::vector<const std::string*> todo = {&text};
+    while (!todo.empty())
+    {
+        const std::string* t = todo.back();
+        todo.pop_back();
+        for (auto& p : model.types.structures)
+        {
+            if (used.count(p.first) == 0 && t->find(p.first) != std::string::npos)
+            {
+                used.insert(p.first);
+                todo.push_back(&p.second);
+            }
+        }
+    }
+    return used;
+}
+
+bool fillSelectiveConfig(retdec::config::Config& config, const std::vector<ea_t>& eas)
+{
+    TRACE_SCOPE("fillSelectiveConfig");
+    auto inFile = getInputPath();
+    if (inFile.empty() || updateHeader(inFile))
     {
         return true;
     }
-    generateFunctions(config, structIdSet);
-    generateGlobals(config, structIdSet);
+    updateModel();
+
+    retdec::config::Config entries;
+    addEntries(entries, eas);
+
+    config = model.header;
+    for (auto& name : getUsedStructures(entries.generateJsonString()))
+    {
+        config.structures.insert(retdec::common::Type(model.types.structures[name]));
+    }
+    config.functions = std::move(entries.functions);
+    config.globals = std::move(entries.globals);
 
     return false;
 }
+
+std::string getConfigEntriesText(func_t* f, const std::vector<ea_t>& refs)
+{
+    TRACE_SCOPE("getConfigEntriesText");
+    updateModel();
+
+    std::vector<ea_t> eas = {f->start_ea};
+    eas.insert(eas.end(), refs.begin(), refs.end());
+
+    retdec::config::Config entries;
+    addEntries(entries, eas);
+    std::string text = entries.generateJsonString();
+
+    for (auto& name : getUsedStructures(text))
+    {
+        text += '\n';
+        text += model.types.structures[name];
+    }
+
+    return text;
+}
+
+void invalidateConfig()
+{
+    model = ConfigModel();
+}
+
+void invalidateConfigTypes()
+{
+    model.types = TypeContext();
+    model.functionsDirty = true;
+    model.globalsDirty = true;
+}
+
+void invalidateConfigHeader()
+{
+    model.headerDirty = true;
+}
+
+void invalidateConfigFunction(ea_t ea)
+{
+    model.dirtyFunctions.insert(ea);
+}
+
+void invalidateConfigFunctions()
+{
+    model.functionsDirty = true;
+}
+
+/**
+ * Drop the cached linkage of the function starting at @p start, and
+ * regenerate the function if it was classified.
+ */
+void invalidateLinkage(ea_t start)
+{
+    if (model.linkage.erase(start))
+    {
+        model.dirtyFunctions.insert(start);
+    }
+}
+
+void invalidateConfigCode(ea_t start, ea_t end)
+{
+    // Function containing the start, and functions starting in the range.
+    if (func_t* fnc = get_func(start))
+    {
+        invalidateLinkage(fnc->start_ea);
+    }
+    auto it = model.linkage.lower_bound(start);
+    while (it != model.linkage.end() && it->first < end)
+    {
+        ea_t ea = it->first;
+        ++it;
+        invalidateLinkage(ea);
+    }
+}
+
+void invalidateConfigObject(ea_t ea)
+{
+    model.dirtyObjects.insert(ea);
+}
+
+void invalidateConfigObjects(ea_t start, ea_t end)
+{
+    for (auto it = model.globals.lower_bound(start);
+            it != model.globals.end() && it->first < end;
+            ++it)
+    {
+        model.dirtyObjects.insert(it->first);
+    }
+    for (auto it = model.linkedFunctions.lower_bound(start);
+            it != model.linkedFunctions.end() && it->first < end;
+            ++it)
+    {
+        model.dirtyObjects.insert(it->first);
+    }
+}
+
+void invalidateConfigGlobals()
+{
+    model.globalsDirty = true;
+}
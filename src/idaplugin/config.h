@@ -2,10 +2,72 @@
 #define RETDEC_CONFIG_H
 
 #include <retdec/config/config.h>
+#include <retdec/utils/filesystem.h>
+
+#include "utils.h"
+
+/**
+ * Path to the decompiler-config.json.
+ * @param baseDir If not null, set to the directory relative paths in the
+ *                config are relative to.
+ */
+fs::path getDecompilerConfigPath(std::string* baseDir = nullptr);
 
 /**
+ * Contents of the decompiler-config.json, empty if there is none.
+ * The file is read (and parsed for fillConfig()) only once, and re-read only
+ * when it changes.
+ */
+const std::string& getDecompilerConfigText();
+
+/**
+ * Fill the config of the whole program - for full decompilations.
  * Returns \c true if something went wrong.
+ *
+ * The config is filled from a persistent model of the IDA database. Only the
+ * objects invalidated since the last call are regenerated and updated in the
+ * config, and the config header is regenerated only if the input file or
+ * decompiler-config.json changes.
  */
 bool fillConfig(retdec::config::Config& config, const std::string& out = "");
 
+/**
+ * Fill the config header and the entries of the functions and globals at
+ * @p eas (the decompiled functions and the objects they reference), with the
+ * definitions of the structures they use - for selective decompilations.
+ * Returns \c true if something went wrong.
+ */
+bool fillSelectiveConfig(retdec::config::Config& config, const std::vector<ea_t>& eas);
+
+/**
+ * Config entries of the function @p f and of the objects at @p refs
+ * (callees, globals), with the definitions of the structures they use,
+ * serialized. The decompilation of @p f depends on all of them - used in its
+ * cache key. Brings the model up to date first.
+ */
+std::string getConfigEntriesText(func_t* f, const std::vector<ea_t>& refs);
+
+// Config model invalidation - called from IDB change notifications.
+//
+
+/// Drop the whole model, everything is regenerated on the next fill.
+void invalidateConfig();
+/// Local types changed, all the types must be translated again.
+void invalidateConfigTypes();
+/// Regenerate the config header (e.g. after rebase).
+void invalidateConfigHeader();
+/// Regenerate the function starting at the given address.
+void invalidateConfigFunction(ea_t ea);
+/// Regenerate all the functions.
+void invalidateConfigFunctions();
+/// Code in the given range changed (instructions created or destroyed,
+/// function bounds moved).
+void invalidateConfigCode(ea_t start, ea_t end);
+/// Regenerate the global object at the given address.
+void invalidateConfigObject(ea_t ea);
+/// Regenerate all the global objects in the given range.
+void invalidateConfigObjects(ea_t start, ea_t end);
+/// Regenerate all the global objects.
+void invalidateConfigGlobals();
+
 #endif
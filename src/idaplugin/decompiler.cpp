@@ -0,0 +1,595 @@
+#include <algorithm>
+#include <chrono>
+
+#include <retdec/retdec/retdec.h>
+
+#include "decompiler.h"
+#include "trace.h"
+#include "workerpool.h"
+
+/**
+ * RetDec (LLVM) keeps global state - only one decompilation may run at a time.
+ */
+static std::mutex decompilationMutex;
+
+bool runDecompilation(
+        retdec::config::Config& config,
+        std::string* output,
+        std::string* error)
+{
+    // Workers are isolated from IDA and from each other - no lock.
+    auto& pool = getWorkerPool();
+    if (pool.isRunning())
+    {
+        TRACE_SCOPE("retdec::decompile");
+        return pool.decompile(config, output, error);
+    }
+
+    auto waitStart = traceNow();
+    std::lock_guard<std::mutex> lock(decompilationMutex);
+    traceInterval("decompilation lock", waitStart, traceNow());
+
+    try
+    {
+        TRACE_SCOPE("retdec::decompile");
+        auto rc = retdec::decompile(config, output);
+        if (rc != 0)
+        {
+            throw std::runtime_error("decompilation error code = " + std::to_string(rc));
+        }
+    }
+    catch (const std::runtime_error& e)
+    {
+        if (error)
+        {
+            *error = std::string("Decompilation exception: ") + e.what();
+        }
+        return true;
+    }
+    catch (...)
+    {
+        if (error)
+        {
+            *error = "Decompilation exception: unknown";
+        }
+        return true;
+    }
+
+    return false;
+}
+
+//
+//==============================================================================
+// DecompilationResult
+//==============================================================================
+//
+
+/**
+ * Delivers a finished job to the main thread.
+ * Allocated by the worker, deleted by IDA after execution (MFF_NOWAIT).
+ */
+struct DecompilationResult : public exec_request_t
+{
+    Decompiler& decompiler;
+    std::shared_ptr<DecompilationJob> job;
+
+    DecompilationResult(Decompiler& d, std::shared_ptr<DecompilationJob> j)
+            : decompiler(d)
+            , job(j)
+    {
+    }
+
+    virtual int idaapi execute(void) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(decompiler.m_mutex);
+            decompiler.m_requests.erase(this);
+        }
+
+        TraceRunScope traceScope(job->traceRun);
+        traceInterval("delivery", job->deliveredAt, traceNow());
+
+        if (!job->cancelled && job->onDone)
+        {
+            job->onDone(*job);
+        }
+        return 0;
+    }
+};
+
+//
+//==============================================================================
+// Decompiler
+//==============================================================================
+//
+
+Decompiler::Decompiler()
+{
+    m_dispatchers.emplace_back(&Decompiler::dispatcherLoop, this);
+}
+
+Decompiler::~Decompiler()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    cancelAll();
+    m_cond.notify_all();
+
+    // RetDec cannot be interrupted, this waits for the running decompilations.
+    for (auto& t : m_dispatchers)
+    {
+        t.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& p : m_requests)
+    {
+        if (p.second >= 0)
+        {
+            cancel_exec_request(p.second);
+        }
+    }
+    m_requests.clear();
+}
+
+void Decompiler::setConcurrency(std::size_t count)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_concurrency = std::max<std::size_t>(1, count);
+        while (m_dispatchers.size() < m_concurrency)
+        {
+            m_dispatchers.emplace_back(&Decompiler::dispatcherLoop, this);
+        }
+    }
+    m_cond.notify_all();
+}
+
+std::shared_ptr<DecompilationJob> Decompiler::submit(
+        ea_t ea,
+        retdec::config::Config&& config,
+        DecompilationJob::Callback onDone)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto job = findJob(ea);
+        if (job && job->prefetch)
+        {
+            job->prefetch = false;
+            job->onDone = onDone;
+            job->traceRun = currentTraceRun();
+
+            auto it = std::find(m_prefetchQueue.begin(), m_prefetchQueue.end(), job);
+            if (it != m_prefetchQueue.end())
+            {
+                m_prefetchQueue.erase(it);
+                m_queue.push_back(job);
+                // It may start even if the prefetch job could not.
+                m_cond.notify_one();
+            }
+            return job;
+        }
+    }
+
+    cancel(ea);
+
+    auto job = std::make_shared<DecompilationJob>();
+    job->ea = ea;
+    job->config = std::move(config);
+    job->onDone = onDone;
+    job->traceRun = currentTraceRun();
+    job->queuedAt = traceNow();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(job);
+    }
+    m_cond.notify_one();
+
+    return job;
+}
+
+std::shared_ptr<DecompilationJob> Decompiler::submitBatch(
+        const std::vector<ea_t>& eas,
+        retdec::config::Config&& config,
+        DecompilationJob::Callback onDone)
+{
+    for (ea_t ea : eas)
+    {
+        cancel(ea);
+    }
+
+    auto job = std::make_shared<DecompilationJob>();
+    job->ea = eas.front();
+    job->batch.assign(eas.begin() + 1, eas.end());
+    job->config = std::move(config);
+    job->onDone = onDone;
+    job->traceRun = currentTraceRun();
+    job->queuedAt = traceNow();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(job);
+    }
+    m_cond.notify_one();
+
+    return job;
+}
+
+std::shared_ptr<DecompilationJob> Decompiler::prefetch(
+        ea_t ea,
+        retdec::config::Config&& config,
+        DecompilationJob::Callback onDone)
+{
+    auto job = std::make_shared<DecompilationJob>();
+    job->ea = ea;
+    job->config = std::move(config);
+    job->onDone = onDone;
+    job->prefetch = true;
+    job->traceRun = currentTraceRun();
+    job->queuedAt = traceNow();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (findJob(ea))
+        {
+            return nullptr;
+        }
+        m_prefetchQueue.push_back(job);
+    }
+    m_cond.notify_one();
+
+    return job;
+}
+
+void Decompiler::cancelPrefetch()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto& j : m_prefetchQueue)
+    {
+        j->cancelled = true;
+    }
+    m_prefetchQueue.clear();
+}
+
+std::shared_ptr<DecompilationJob> Decompiler::findJob(ea_t ea) const
+{
+    for (auto* q : {&m_queue, &m_prefetchQueue})
+    {
+        for (auto& j : *q)
+        {
+            if (j->decompiles(ea))
+            {
+                return j;
+            }
+        }
+    }
+    for (auto& j : m_running)
+    {
+        if (j->decompiles(ea) && !j->cancelled)
+        {
+            return j;
+        }
+    }
+    for (auto& p : m_requests)
+    {
+        if (p.first->job->decompiles(ea) && !p.first->job->cancelled)
+        {
+            return p.first->job;
+        }
+    }
+    return nullptr;
+}
+
+void Decompiler::cancel(ea_t ea)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto* q : {&m_queue, &m_prefetchQueue})
+    {
+        for (auto it = q->begin(); it != q->end(); )
+        {
+            if ((*it)->decompiles(ea))
+            {
+                (*it)->cancelled = true;
+                it = q->erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    for (auto& j : m_running)
+    {
+        if (j->decompiles(ea))
+        {
+            j->cancelled = true;
+        }
+    }
+    for (auto& p : m_requests)
+    {
+        if (p.first->job->decompiles(ea))
+        {
+            p.first->job->cancelled = true;
+        }
+    }
+}
+
+void Decompiler::cancelAll()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    for (auto* q : {&m_queue, &m_prefetchQueue})
+    {
+        for (auto& j : *q)
+        {
+            j->cancelled = true;
+        }
+        q->clear();
+    }
+    for (auto& j : m_running)
+    {
+        j->cancelled = true;
+    }
+    for (auto& p : m_requests)
+    {
+        p.first->job->cancelled = true;
+    }
+}
+
+bool Decompiler::isPending(ea_t ea) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return findJob(ea) != nullptr;
+}
+
+std::vector<ea_t> Decompiler::pendingWith(ea_t ea) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto job = findJob(ea);
+    if (job == nullptr)
+    {
+        return {};
+    }
+
+    std::vector<ea_t> ret{job->ea};
+    ret.insert(ret.end(), job->batch.begin(), job->batch.end());
+    return ret;
+}
+
+bool Decompiler::isBusy() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_queue.empty()
+            || !m_prefetchQueue.empty()
+            || !m_running.empty()
+            || !m_requests.empty();
+}
+
+bool Decompiler::canStart() const
+{
+    if (m_running.size() >= m_concurrency)
+    {
+        return false;
+    }
+    if (!m_queue.empty())
+    {
+        return true;
+    }
+    // Keep a dispatcher free for the jobs the user asks for.
+    return !m_prefetchQueue.empty()
+            && (m_concurrency == 1 || m_running.size() + 1 < m_concurrency);
+}
+
+void Decompiler::dispatcherLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<DecompilationJob> job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cond.wait(lock, [this] { return m_stop || canStart(); });
+            if (m_stop)
+            {
+                return;
+            }
+            auto& q = m_queue.empty() ? m_prefetchQueue : m_queue;
+            job = q.front();
+            q.pop_front();
+            m_running.push_back(job);
+        }
+
+        if (!job->cancelled)
+        {
+            TraceRunScope traceScope(job->traceRun);
+            traceInterval("queued", job->queuedAt, traceNow());
+            runDecompilation(job->config, &job->output, &job->error);
+            traceCounter("output bytes", job->output.size());
+        }
+
+        if (!job->cancelled)
+        {
+            deliver(job);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_running.erase(std::find(m_running.begin(), m_running.end(), job));
+        }
+        // A prefetch job may wait for this dispatcher to be free.
+        m_cond.notify_all();
+    }
+}
+
+void Decompiler::deliver(std::shared_ptr<DecompilationJob> job)
+{
+    job->deliveredAt = traceNow();
+    auto* req = new DecompilationResult(*this, job);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_stop)
+        {
+            delete req;
+            return;
+        }
+        m_requests[req] = -1;
+    }
+
+    int id = execute_sync(*req, MFF_WRITE | MFF_NOWAIT);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_requests.find(req);
+    if (it != m_requests.end())
+    {
+        it->second = id;
+    }
+}
+
+//
+//==============================================================================
+// Sharded decompilation
+//==============================================================================
+//
+
+/**
+ * Report the shard's result to the output window.
+ */
+void reportShard(const Shard& shard, std::size_t i, std::size_t n)
+{
+    std::stringstream ss;
+    ss << "Shard " << i + 1 << "/" << n
+       << " [" << std::hex << shard.start << ", " << shard.end << ")"
+       << std::dec << " (" << shard.functions << " functions): ";
+    if (shard.status == Shard::Status::DONE)
+    {
+        INFO_MSG(ss.str() << "done in " << shard.seconds << " s\n");
+    }
+    else
+    {
+        WARNING_MSG(ss.str() << shard.error << "\n");
+    }
+}
+
+bool decompileShards(
+        const retdec::config::Config& config,
+        std::vector<Shard>& shards,
+        std::size_t workers)
+{
+    std::mutex mutex;
+    std::size_t next = 0;
+    std::atomic<bool> cancelled{false};
+    TraceRunId traceRun = currentTraceRun();
+
+    // Workers only read the shared config and write their own shards,
+    // they do not touch IDA.
+    auto worker = [&]()
+    {
+        TraceRunScope traceScope(traceRun);
+        while (true)
+        {
+            Shard* shard = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (cancelled || next >= shards.size())
+                {
+                    return;
+                }
+                shard = &shards[next++];
+                shard->status = Shard::Status::RUNNING;
+            }
+
+            retdec::config::Config cfg = config;
+            cfg.parameters.setOutputFormat("c");
+            retdec::common::AddressRange r(shard->start, shard->end);
+            cfg.parameters.selectedRanges.insert(r);
+            cfg.parameters.setIsSelectedDecodeOnly(true);
+
+            std::string output;
+            std::string error;
+            auto start = std::chrono::steady_clock::now();
+            bool failed = runDecompilation(cfg, &output, &error);
+            std::chrono::duration<double> elapsed =
+                    std::chrono::steady_clock::now() - start;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            shard->output = std::move(output);
+            shard->error = std::move(error);
+            shard->seconds = elapsed.count();
+            shard->status = failed ? Shard::Status::FAILED : Shard::Status::DONE;
+        }
+    };
+
+    workers = std::max<std::size_t>(1, std::min(workers, shards.size()));
+    std::vector<std::thread> threads;
+    for (std::size_t i = 0; i < workers; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+
+    show_wait_box("Decompiling...");
+
+    std::vector<bool> reported(shards.size(), false);
+    while (true)
+    {
+        std::size_t done = 0;
+        std::size_t running = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (std::size_t i = 0; i < shards.size(); ++i)
+            {
+                auto& s = shards[i];
+                if (s.status == Shard::Status::RUNNING)
+                {
+                    ++running;
+                }
+                else if (s.status != Shard::Status::QUEUED)
+                {
+                    ++done;
+                    if (!reported[i])
+                    {
+                        reportShard(s, i, shards.size());
+                        reported[i] = true;
+                    }
+                }
+            }
+        }
+
+        if (done == shards.size() || (cancelled && running == 0))
+        {
+            break;
+        }
+
+        if (!cancelled && user_cancelled())
+        {
+            // RetDec cannot be interrupted, running shards are finished.
+            cancelled = true;
+        }
+
+        replace_wait_box(
+                "%sDecompiling shards: %zu/%zu done, %zu running",
+                cancelled ? "Cancelling... " : "",
+                done, shards.size(), running);
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+
+    hide_wait_box();
+
+    bool failed = std::any_of(shards.begin(), shards.end(),
+            [](const Shard& s) { return s.status != Shard::Status::DONE; });
+    if (cancelled && failed)
+    {
+        INFO_MSG("Full decompilation cancelled.\n");
+    }
+    return failed;
+}
@@ -0,0 +1,179 @@
+#ifndef RETDEC_DECOMPILER_H
+#define RETDEC_DECOMPILER_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <retdec/config/config.h>
+
+#include "shards.h"
+#include "trace.h"
+#include "utils.h"
+
+struct DecompilationResult;
+
+/**
+ * Run RetDec on the given config.
+ * Runs in the worker pool if it is running (see WorkerPool), in parallel
+ * with other calls. Otherwise, in-process decompilations are serialized -
+ * RetDec (LLVM) is not reentrant.
+ * Safe to call from any thread, it does not touch IDA.
+ * @param config Config to decompile.
+ * @param output If not null, the decompiler output is stored here.
+ * @param error  If not null, error message is stored here on failure.
+ * @return \c true if something went wrong.
+ */
+bool runDecompilation(
+        retdec::config::Config& config,
+        std::string* output = nullptr,
+        std::string* error = nullptr);
+
+/**
+ * Decompile the given shards using @p workers worker threads.
+ * @param config Filled config of the whole program - each shard decompiles
+ *               a copy of it.
+ * Blocks until all the shards finish. Shows a wait box with the progress
+ * and reports each finished shard to the output window. If the user cancels
+ * the wait box, queued shards are not decompiled (they stay QUEUED).
+ * Must be called from the main thread.
+ * @return \c true if some shard was not decompiled.
+ */
+bool decompileShards(
+        const retdec::config::Config& config,
+        std::vector<Shard>& shards,
+        std::size_t workers);
+
+/**
+ * One background decompilation.
+ *
+ * Created on the main thread with a snapshot of the config, decompiled on a
+ * dispatcher thread, and delivered back to the main thread via execute_sync().
+ */
+struct DecompilationJob
+{
+    /// Called on the main thread when the job finishes (not if cancelled).
+    using Callback = std::function<void(DecompilationJob&)>;
+
+    /// Start of the decompiled function.
+    ea_t ea = BADADDR;
+    /// Starts of the other functions decompiled by the same job, see
+    /// Decompiler::submitBatch().
+    std::vector<ea_t> batch;
+    /// Config snapshot, owned by the job.
+    retdec::config::Config config;
+    /// Decompiler output.
+    std::string output;
+    /// Error message, empty on success.
+    std::string error;
+    /// Cancelled jobs are neither decompiled nor delivered.
+    std::atomic<bool> cancelled{false};
+    /// Speculative (low priority) decompilation.
+    bool prefetch = false;
+
+    /// Trace run the job belongs to, and its timestamps, see trace.h.
+    TraceRunId traceRun = 0;
+    std::int64_t queuedAt = 0;
+    std::int64_t deliveredAt = 0;
+
+    Callback onDone;
+
+    /// Is the function starting at @p fnc decompiled by this job?
+    bool decompiles(ea_t fnc) const
+    {
+        return ea == fnc || std::find(batch.begin(), batch.end(), fnc) != batch.end();
+    }
+};
+
+/**
+ * Background decompilation engine.
+ * Jobs are decompiled by dispatcher threads - as many jobs run in parallel
+ * as there are decompilation workers (see setConcurrency()), one if the
+ * decompilations run in-process. Prefetch jobs are decompiled only when
+ * there are no other jobs, and they never take the last free dispatcher.
+ * All the public methods must be called from the main thread.
+ */
+class Decompiler
+{
+public:
+    Decompiler();
+    ~Decompiler();
+
+    /// Run up to @p count jobs in parallel - the number of decompilation
+    /// workers (see WorkerPool), 1 for in-process decompilations.
+    void setConcurrency(std::size_t count);
+
+    /// Queue decompilation of the function starting at @p ea.
+    /// A pending job for the same function is cancelled - except for
+    /// a prefetch job, which is taken over (prioritized, and @p onDone is
+    /// called instead of its callback).
+    std::shared_ptr<DecompilationJob> submit(
+            ea_t ea,
+            retdec::config::Config&& config,
+            DecompilationJob::Callback onDone);
+    /// Queue decompilation of the functions starting at @p eas in one job
+    /// (one RetDec run). The job's ea is the first function, pending jobs
+    /// for any of the functions are cancelled. The job is pending for all
+    /// the functions, and cancelling any of them cancels it.
+    std::shared_ptr<DecompilationJob> submitBatch(
+            const std::vector<ea_t>& eas,
+            retdec::config::Config&& config,
+            DecompilationJob::Callback onDone);
+    /// Queue speculative decompilation of the function starting at @p ea.
+    /// Returns \c nullptr if there already is a job for the function.
+    std::shared_ptr<DecompilationJob> prefetch(
+            ea_t ea,
+            retdec::config::Config&& config,
+            DecompilationJob::Callback onDone);
+    /// Cancel all the queued prefetch jobs.
+    void cancelPrefetch();
+
+    /// Cancel decompilation of the function starting at @p ea.
+    /// RetDec cannot be interrupted - if the job is already running, its
+    /// result is just thrown away.
+    void cancel(ea_t ea);
+    /// Cancel all the queued and running jobs.
+    void cancelAll();
+    /// Is there a queued or running job for the function starting at @p ea?
+    bool isPending(ea_t ea) const;
+    /// Functions decompiled by the pending job for the function starting at
+    /// @p ea - more than one for batch jobs, none if there is no such job.
+    std::vector<ea_t> pendingWith(ea_t ea) const;
+    /// Is there any queued or running job?
+    bool isBusy() const;
+
+private:
+    void dispatcherLoop();
+    /// Can a dispatcher start a job? m_mutex must be locked.
+    bool canStart() const;
+    void deliver(std::shared_ptr<DecompilationJob> job);
+    /// Queued, running or undelivered job for @p ea. m_mutex must be locked.
+    std::shared_ptr<DecompilationJob> findJob(ea_t ea) const;
+
+private:
+    friend struct DecompilationResult;
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<std::shared_ptr<DecompilationJob>> m_queue;
+    std::deque<std::shared_ptr<DecompilationJob>> m_prefetchQueue;
+    std::vector<std::shared_ptr<DecompilationJob>> m_running;
+    /// Maximum number of running jobs, see setConcurrency().
+    std::size_t m_concurrency = 1;
+    /// Results waiting for delivery on the main thread, with their
+    /// execute_sync() request ids (-1 if not known yet).
+    std::map<DecompilationResult*, int> m_requests;
+    bool m_stop = false;
+    /// At least m_concurrency threads - the surplus ones are idle.
+    std::vector<std::thread> m_dispatchers;
+};
+
+#endif
@@ -1,196 +1,385 @@
+#include <algorithm>
 #include <sstream>
 
 #include "function.h"
+#include "trace.h"
 
 Function::Function() {}
 
-Function::Function(func_t* f, const std::vector<Token>& tokens) : m_p_func_t(f)
+Function::Function(func_t* f, const std::vector<Token>& tokens)
+        : m_start(f ? f->start_ea : BADADDR)
+        , m_end(f ? f->end_ea : BADADDR)
 {
-    std::size_t y = YX::starting_y;
-    std::size_t x = YX::starting_x;
+    TRACE_SCOPE("Function");
+    if (tokens.empty())
+    {
+        return;
+    }
+
+    std::size_t textSize = 0;
     for (auto& t : tokens)
     {
-        m_tokens[YX(y, x)] = t;
+        textSize += t.value.size();
+    }
+    m_tokens.reserve(tokens.size());
+    m_text.reserve(textSize);
+
+    m_lines.push_back(0);
+    for (std::size_t i = 0; i < tokens.size(); ++i)
+    {
+        auto& t = tokens[i];
+
+        TokenEntry e;
+        e.ea = t.ea;
+        e.offset = uint32_t(m_text.size());
+        e.length = uint32_t(t.value.size());
+        e.kind = t.kind;
+        m_tokens.push_back(e);
+        m_text += t.value;
+
+        if (t.kind == Token::Kind::NEW_LINE && i + 1 < tokens.size())
+        {
+            m_lines.push_back(uint32_t(i + 1));
+        }
+    }
+    m_lines.push_back(uint32_t(m_tokens.size()));
+    m_lines.shrink_to_fit();
+
+    indexAddresses();
+}
 
-        if (m_ea2yx.count(t.ea) == 0)
+void Function::indexAddresses()
+{
+    // Tokens without addresses are in neither of the indexes.
+    m_lineEaStarts.reserve(m_lines.size());
+    for (std::size_t l = 0; l < lineCount(); ++l)
+    {
+        m_lineEaStarts.push_back(uint32_t(m_lineEas.size()));
+        std::size_t first = m_lineEas.size();
+        for (std::size_t i = m_lines[l]; i < m_lines[l + 1]; ++i)
         {
-            m_ea2yx[t.ea] = YX(y, x);
+            if (m_tokens[i].ea != BADADDR)
+            {
+                m_lineEas.push_back(m_tokens[i].ea);
+            }
         }
+        std::sort(m_lineEas.begin() + first, m_lineEas.end());
+        m_lineEas.erase(
+                std::unique(m_lineEas.begin() + first, m_lineEas.end()),
+                m_lineEas.end());
+    }
+    m_lineEaStarts.push_back(uint32_t(m_lineEas.size()));
+    m_lineEas.shrink_to_fit();
 
-        if (t.kind == Token::Kind::NEW_LINE)
+    // Lines are visited in order - the stable sort keeps the first line of
+    // each address first.
+    m_eaIntervals.reserve(m_lineEas.size());
+    for (std::size_t l = 0; l < lineCount(); ++l)
+    {
+        for (std::size_t j = m_lineEaStarts[l]; j < m_lineEaStarts[l + 1]; ++j)
         {
-            ++y;
-            x = YX::starting_x;
+            EaInterval in;
+            in.start = m_lineEas[j];
+            in.line = uint32_t(l);
+            m_eaIntervals.push_back(in);
         }
-        else
+    }
+    std::stable_sort(m_eaIntervals.begin(), m_eaIntervals.end(),
+            [](const auto& a, const auto& b) { return a.start < b.start; });
+    m_eaIntervals.erase(
+            std::unique(m_eaIntervals.begin(), m_eaIntervals.end(),
+                    [](const auto& a, const auto& b) { return a.start == b.start; }),
+            m_eaIntervals.end());
+    m_eaIntervals.shrink_to_fit();
+
+    for (auto& in : m_eaIntervals)
+    {
+        std::size_t i = m_lines[in.line];
+        while (m_tokens[i].ea != in.start)
         {
-            x += t.value.size();
+            ++i;
         }
+        in.token = uint32_t(i);
     }
 }
 
+Function Function::placeholder(func_t* f, const std::string& text)
+{
+    ea_t ea = f ? f->start_ea : BADADDR;
+
+    std::vector<Token> tokens;
+    std::istringstream ss(text);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        tokens.emplace_back(Token(Token::Kind::COMMENT, ea, "// " + line));
+        tokens.emplace_back(Token(Token::Kind::NEW_LINE, ea, "\n"));
+    }
+
+    Function ret(f, tokens);
+    ret.m_placeholder = true;
+    return ret;
+}
+
+bool Function::isPlaceholder() const
+{
+    return m_placeholder;
+}
+
 func_t* Function::get_func_t() const
 {
-    return m_p_func_t;
+    // Do not keep func_t pointers around, IDA may invalidate them.
+    return m_start != BADADDR ? get_func(m_start) : nullptr;
 }
 
 std::string Function::getName() const
 {
-    VERIFY(nullptr != m_p_func_t);
-    if (nullptr == m_p_func_t)
+    VERIFY(BADADDR != m_start);
+    if (BADADDR == m_start)
         return "";
 
     qstring qFncName;
-    get_func_name(&qFncName, m_p_func_t->start_ea);
+    get_func_name(&qFncName, m_start);
     return qFncName.c_str();
 }
 
 ea_t Function::getStart() const
 {
-    VERIFY(nullptr != m_p_func_t);
-    if (nullptr == m_p_func_t)
+    return m_start;
+}
+
+ea_t Function::getEnd() const
+{
+    return m_end;
+}
+
+std::size_t Function::lineCount() const
+{
+    return m_lines.empty() ? 0 : m_lines.size() - 1;
+}
+
+std::size_t Function::lineIndex(std::size_t y) const
+{
+    if (y < YX::starting_y || y - YX::starting_y >= lineCount())
     {
-        return BADADDR;
+        return npos;
     }
+    return y - YX::starting_y;
+}
 
-    return m_p_func_t->start_ea;
+std::size_t Function::lineOfToken(std::size_t i) const
+{
+    auto it = std::upper_bound(m_lines.begin(), m_lines.end(), uint32_t(i));
+    return std::distance(m_lines.begin(), it) - 1;
 }
 
-ea_t Function::getEnd() const
+std::size_t Function::tokenIndex(YX yx) const
 {
-    VERIFY(nullptr != m_p_func_t);
-    if (nullptr == m_p_func_t)
+    if (m_tokens.empty())
+    {
+        return npos;
+    }
+    if (yx <= min_yx())
+    {
+        return 0;
+    }
+    if (yx >= max_yx())
     {
-        return BADADDR;
+        return m_tokens.size() - 1;
     }
 
-    return m_p_func_t->end_ea;
+    // Every line between the first and the last one has at least one token
+    // starting at X == starting_x, so the YX is always on its own line.
+    std::size_t line = lineIndex(yx.y);
+    auto first = m_tokens.begin() + m_lines[line];
+    auto last = m_tokens.begin() + m_lines[line + 1];
+    std::size_t offset = first->offset + (yx.x - YX::starting_x);
+    auto it = std::upper_bound(first, last, offset,
+            [](std::size_t off, const TokenEntry& e) { return off < e.offset; });
+    --it;
+    return std::distance(m_tokens.begin(), it);
+}
+
+YX Function::tokenYx(std::size_t i, std::size_t line) const
+{
+    auto& lineStart = m_tokens[m_lines[line]];
+    return YX(
+            YX::starting_y + line,
+            YX::starting_x + m_tokens[i].offset - lineStart.offset);
+}
+
+YX Function::tokenYx(std::size_t i) const
+{
+    return tokenYx(i, lineOfToken(i));
 }
 
-const Token* Function::getToken(YX yx) const
+Token Function::makeToken(std::size_t i) const
 {
-    auto it = m_tokens.find(adjust_yx(yx));
-    return it == m_tokens.end() ? nullptr : &it->second;
+    auto& e = m_tokens[i];
+    return Token(e.kind, e.ea, m_text.substr(e.offset, e.length));
 }
 
-const std::map<YX, Token>& Function::getTokens() const
+std::optional<Token> Function::getToken(YX yx) const
 {
-    return m_tokens;
+    std::size_t i = tokenIndex(yx);
+    if (i == npos)
+    {
+        return std::nullopt;
+    }
+    return makeToken(i);
+}
+
+std::vector<Token> Function::getTokens() const
+{
+    std::vector<Token> ret;
+    ret.reserve(m_tokens.size());
+    for (std::size_t i = 0; i < m_tokens.size(); ++i)
+    {
+        ret.push_back(makeToken(i));
+    }
+    return ret;
+}
+
+std::vector<Token> Function::getTokens(Token::Kind kind) const
+{
+    std::vector<Token> ret;
+    for (std::size_t i = 0; i < m_tokens.size(); ++i)
+    {
+        if (m_tokens[i].kind == kind)
+        {
+            ret.push_back(makeToken(i));
+        }
+    }
+    return ret;
 }
 
 YX Function::min_yx() const
 {
-    return m_tokens.empty() ? YX::starting_yx : m_tokens.begin()->first;
+    return YX::starting_yx;
 }
 
 YX Function::max_yx() const
 {
-    return m_tokens.empty() ? YX::starting_yx : m_tokens.rbegin()->first;
+    return m_tokens.empty()
+            ? YX::starting_yx
+            : tokenYx(m_tokens.size() - 1, lineCount() - 1);
 }
 
 YX Function::prev_yx(YX yx) const
 {
-    auto it = m_tokens.find(adjust_yx(yx));
-    if (it == m_tokens.end() || it == m_tokens.begin())
+    std::size_t i = tokenIndex(yx);
+    if (i == npos || i == 0)
     {
         return yx;
     }
-    --it;
-    return it->first;
+    return tokenYx(i - 1);
 }
 
 YX Function::next_yx(YX yx) const
 {
-    auto it = m_tokens.find(adjust_yx(yx));
-    auto nit = it;
-    ++nit;
-    if (it == m_tokens.end() || nit == m_tokens.end())
+    std::size_t i = tokenIndex(yx);
+    if (i == npos || i + 1 == m_tokens.size())
     {
         return yx;
     }
-    return nit->first;
+    return tokenYx(i + 1);
 }
 
 YX Function::adjust_yx(YX yx) const
 {
-    if (m_tokens.empty() || m_tokens.count(yx))
+    std::size_t i = tokenIndex(yx);
+    return i == npos ? yx : tokenYx(i);
+}
+
+void Function::appendColored(std::string& out, std::size_t first, std::size_t last) const
+{
+    for (std::size_t i = first; i < last && m_tokens[i].kind != Token::Kind::NEW_LINE; ++i)
     {
-        return yx;
+        auto& e = m_tokens[i];
+        auto& color = Token::getColorTag(e.kind);
+        out += SCOLOR_ON;
+        out += color;
+        out.append(m_text, e.offset, e.length);
+        out += SCOLOR_OFF;
+        out += color;
     }
-    if (yx <= min_yx())
+}
+
+std::string Function::line_yx(YX yx) const
+{
+    std::size_t i = tokenIndex(yx);
+    std::size_t line = lineIndex(yx.y);
+    if (i == npos || line == npos || lineOfToken(i) != line)
     {
-        return min_yx();
+        return std::string();
     }
-    if (yx >= max_yx())
+
+    if (i == m_lines[line])
     {
-        return max_yx();
+        return std::string(colored_line(yx.y));
     }
 
-    auto it = m_tokens.upper_bound(yx);
-    --it;
-    return it->first;
+    std::string ret;
+    appendColored(ret, i, m_lines[line + 1]);
+    return ret;
 }
 
-std::string Function::line_yx(YX yx) const
+std::string_view Function::colored_line(std::size_t y) const
 {
-    std::string line;
+    std::size_t line = lineIndex(y);
+    if (line == npos)
+    {
+        return std::string_view();
+    }
+
+    if (m_coloredLines.empty())
+    {
+        m_coloredLines.resize(lineCount());
+    }
 
-    auto it = m_tokens.find(adjust_yx(yx));
-    while (it != m_tokens.end()
-            && it->first.y == yx.y
-            && it->second.kind != Token::Kind::NEW_LINE)
+    auto& cl = m_coloredLines[line];
+    if (cl.offset == uint32_t(-1))
     {
-        line += std::string(SCOLOR_ON)
-                + it->second.getColorTag()
-                + it->second.value
-                + SCOLOR_OFF
-                + it->second.getColorTag();
-        ++it;
+        cl.offset = uint32_t(m_coloredText.size());
+        appendColored(m_coloredText, m_lines[line], m_lines[line + 1]);
+        cl.length = uint32_t(m_coloredText.size() - cl.offset);
     }
 
-    return line;
+    return std::string_view(m_coloredText).substr(cl.offset, cl.length);
 }
 
 ea_t Function::yx_2_ea(YX yx) const
 {
-    auto it = m_tokens.find(adjust_yx(yx));
-    if (it == m_tokens.end())
-    {
-        return BADADDR;
-    }
-    return it->second.ea;
+    std::size_t i = tokenIndex(yx);
+    return i == npos ? BADADDR : m_tokens[i].ea;
 }
 
-std::set<ea_t> Function::yx_2_eas(YX yx) const
+Function::LineEas Function::yx_2_eas(YX yx) const
 {
-    std::set<ea_t> ret;
-    auto it = m_tokens.find(YX(yx.y, 0));
-    while (it != m_tokens.end() && it->first.y == yx.y)
+    std::size_t line = lineIndex(yx.y);
+    if (line == npos)
     {
-        ret.insert(it->second.ea);
-        ++it;
+        return LineEas();
     }
-    return ret;
+    return LineEas(
+            m_lineEas.data() + m_lineEaStarts[line],
+            m_lineEas.data() + m_lineEaStarts[line + 1]);
 }
 
 YX Function::ea_2_yx(ea_t ea) const
 {
-    if (m_ea2yx.empty())
+    // Addresses past the last token are still the function's epilogue.
+    if (m_eaIntervals.empty()
+            || ea < m_eaIntervals.front().start
+            || (m_eaIntervals.back().start < ea && !ea_inside(ea)))
     {
         return YX::starting_yx;
     }
-    if (ea < m_ea2yx.begin()->first || m_ea2yx.rbegin()->first < ea)
-    {
-        return YX::starting_yx;
-    }
-    if (ea == m_ea2yx.rbegin()->first)
-    {
-        return max_yx();
-    }
 
-    auto it = m_ea2yx.upper_bound(ea);
+    auto it = std::upper_bound(m_eaIntervals.begin(), m_eaIntervals.end(), ea,
+            [](ea_t a, const EaInterval& in) { return a < in.start; });
     --it;
-    return it->second;
+    return tokenYx(it->token, it->line);
 }
 
 bool Function::ea_inside(ea_t ea) const
@@ -198,32 +387,156 @@ bool Function::ea_inside(ea_t ea) const
     return getStart() <= ea && ea < getEnd();
 }
 
-std::vector<std::pair<std::string, ea_t>> Function::toLines() const
+std::map<std::string, std::vector<std::size_t>> Function::lines_with(Token::Kind kind) const
 {
-    std::vector<std::pair<std::string, ea_t>> lines;
-
-    ea_t addr = BADADDR;
-    std::string line;
-    for (auto& p : m_tokens)
+    std::map<std::string, std::vector<std::size_t>> ret;
+    for (std::size_t l = 0; l < lineCount(); ++l)
     {
-        if (addr == BADADDR)
+        for (std::size_t i = m_lines[l]; i < m_lines[l + 1]; ++i)
         {
-            addr = p.second.ea;
+            auto& e = m_tokens[i];
+            if (e.kind != kind)
+            {
+                continue;
+            }
+            auto& lines = ret[m_text.substr(e.offset, e.length)];
+            if (lines.empty() || lines.back() != l)
+            {
+                lines.push_back(l);
+            }
         }
+    }
+    return ret;
+}
+
+std::size_t Function::renameOnLine(
+        std::size_t line,
+        Token::Kind kind,
+        const std::string& oldVal,
+        const std::string& newVal)
+{
+    std::size_t first = m_lines[line];
+    std::size_t last = m_lines[line + 1];
 
-        auto& t = p.second;
-        if (t.kind == Token::Kind::NEW_LINE)
+    auto matches = [&](const TokenEntry& e)
+    {
+        return e.kind == kind
+                && e.length == oldVal.size()
+                && m_text.compare(e.offset, e.length, oldVal) == 0;
+    };
+    if (std::none_of(m_tokens.begin() + first, m_tokens.begin() + last, matches))
+    {
+        return 0;
+    }
+
+    // The line must stay in one piece - it is written anew at the end of
+    // the text, so the other lines need not be moved.
+    std::size_t n = 0;
+    std::string text;
+    uint32_t base = uint32_t(m_text.size());
+    m_garbage += m_tokens[last - 1].offset + m_tokens[last - 1].length
+            - m_tokens[first].offset;
+    for (std::size_t i = first; i < last; ++i)
+    {
+        auto& e = m_tokens[i];
+        uint32_t offset = base + uint32_t(text.size());
+        if (matches(e))
         {
-            lines.emplace_back(std::make_pair(line, addr));
-            line.clear();
-            addr = BADADDR;
+            text += newVal;
+            e.length = uint32_t(newVal.size());
+            ++n;
         }
         else
         {
-            line += t.value;
+            text.append(m_text, e.offset, e.length);
+        }
+        e.offset = offset;
+    }
+    m_text += text;
+
+    if (!m_coloredLines.empty())
+    {
+        m_coloredLines[line] = ColoredLine();
+    }
+
+    return n;
+}
+
+void Function::compact()
+{
+    std::string text;
+    text.reserve(m_text.size() - m_garbage);
+    for (auto& e : m_tokens)
+    {
+        uint32_t offset = uint32_t(text.size());
+        text.append(m_text, e.offset, e.length);
+        e.offset = offset;
+    }
+    m_text = std::move(text);
+    m_garbage = 0;
+
+    // Rendered lines have garbage of their own.
+    m_coloredText.clear();
+    m_coloredLines.clear();
+}
+
+std::size_t Function::rename(
+        Token::Kind kind,
+        const std::string& oldVal,
+        const std::string& newVal,
+        const std::vector<std::size_t>& lines)
+{
+    std::size_t n = 0;
+    for (std::size_t l : lines)
+    {
+        if (l < lineCount())
+        {
+            n += renameOnLine(l, kind, oldVal, newVal);
         }
     }
 
+    if (m_garbage > m_text.size() / 2)
+    {
+        compact();
+    }
+    return n;
+}
+
+std::size_t Function::rename(
+        Token::Kind kind,
+        const std::string& oldVal,
+        const std::string& newVal)
+{
+    std::vector<std::size_t> lines(lineCount());
+    for (std::size_t l = 0; l < lines.size(); ++l)
+    {
+        lines[l] = l;
+    }
+    return rename(kind, oldVal, newVal, lines);
+}
+
+std::vector<std::pair<std::string, ea_t>> Function::toLines() const
+{
+    std::vector<std::pair<std::string, ea_t>> lines;
+    lines.reserve(lineCount());
+
+    for (std::size_t l = 0; l < lineCount(); ++l)
+    {
+        std::size_t first = m_lines[l];
+        std::size_t last = m_lines[l + 1];
+
+        // The last line may not be terminated.
+        if (m_tokens[last - 1].kind != Token::Kind::NEW_LINE)
+        {
+            break;
+        }
+
+        std::size_t offset = m_tokens[first].offset;
+        lines.emplace_back(std::make_pair(
+                m_text.substr(offset, m_tokens[last - 1].offset - offset),
+                m_tokens[first].ea));
+    }
+
     return lines;
 }
 
@@ -234,6 +547,19 @@ std::string Function::toString() const
     return ss.str();
 }
 
+std::size_t Function::memorySize() const
+{
+    return sizeof(*this)
+            + m_tokens.capacity() * sizeof(TokenEntry)
+            + m_lines.capacity() * sizeof(uint32_t)
+            + m_text.capacity()
+            + m_eaIntervals.capacity() * sizeof(EaInterval)
+            + m_lineEas.capacity() * sizeof(ea_t)
+            + m_lineEaStarts.capacity() * sizeof(uint32_t)
+            + m_coloredText.capacity()
+            + m_coloredLines.capacity() * sizeof(ColoredLine);
+}
+
 std::ostream& operator<<(std::ostream& os, const Function& f)
 {
     os << f.getName() << "<" << std::hex << f.getStart() << "," << f.getEnd() << ")";
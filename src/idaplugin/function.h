@@ -1,9 +1,12 @@
 #ifndef RETDEC_FUNCTION_H
 #define RETDEC_FUNCTION_H
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <map>
-#include <set>
+#include <optional>
+#include <string_view>
 #include <vector>
 
 #include "token.h"
@@ -13,21 +16,65 @@
 /**
  * Decompiled function - i.e. its source code.
  * The object is XY-aware and EA-aware.
+ *
+ * Tokens are stored in a flat layout - one contiguous array of fixed-size
+ * token records, whose values are ranges in a single text buffer, and an
+ * array of line starts. Tokens of a line are stored in one piece of the
+ * text buffer, so the token's X is its offset from the start of the line.
+ * YX lookups are an index into the line array and a binary search in the
+ * line.
+ *
+ * Renames patch the tokens in place - lines with renamed tokens are written
+ * anew at the end of the text buffer, the rest of the function is not
+ * touched.
+ *
+ * Addresses are indexed both ways when the function is created - address
+ * intervals sorted by their start, and sorted addresses of each line. Both
+ * lookups are binary searches without allocations. Renames change neither
+ * the addresses nor the lines, so the index is never rebuilt.
  */
 class Function
 {
+public:
+    /// Sorted addresses of one line - a view into the function, valid while
+    /// the function exists.
+    class LineEas
+    {
+    public:
+        LineEas() = default;
+        LineEas(const ea_t* first, const ea_t* last) : m_first(first), m_last(last) {}
+
+        const ea_t* begin() const { return m_first; }
+        const ea_t* end() const { return m_last; }
+        std::size_t size() const { return m_last - m_first; }
+        bool empty() const { return m_first == m_last; }
+        bool contains(ea_t ea) const { return std::binary_search(m_first, m_last, ea); }
+
+    private:
+        const ea_t* m_first = nullptr;
+        const ea_t* m_last = nullptr;
+    };
+
 public:
     Function();
     Function(func_t* f, const std::vector<Token>& tokens);
 
+    /// Function shown in place of a function which is being decompiled,
+    /// or whose decompilation failed. The given text is shown as a comment.
+    static Function placeholder(func_t* f, const std::string& text);
+    /// Is this just a placeholder for a function without decompilation?
+    bool isPlaceholder() const;
+
     func_t* get_func_t() const;
     std::string getName() const;
     ea_t getStart() const;
     ea_t getEnd() const;
     /// Token at YX.
-    const Token* getToken(YX yx) const;
+    std::optional<Token> getToken(YX yx) const;
     /// All the tokens.
-    const std::map<YX, Token>& getTokens() const;
+    std::vector<Token> getTokens() const;
+    /// All the tokens of the given kind.
+    std::vector<Token> getTokens(Token::Kind kind) const;
 
     /// YX of the first token.
     YX min_yx() const;
@@ -42,26 +89,127 @@ public:
     /// Entire colored line containing the given YX.
     /// I.e. concatenation of all the tokens with y == yx.y
     std::string line_yx(YX yx) const;
+    /// Entire colored line with the given Y.
+    /// Lines are rendered on the first use and cached, the view is valid
+    /// until the next call.
+    std::string_view colored_line(std::size_t y) const;
     /// Address of the given YX.
     ea_t yx_2_ea(YX yx) const;
     /// Addresses of all the XYs with y == yx.y
-    std::set<ea_t> yx_2_eas(YX yx) const;
-    /// [The first] XY with the given address.
+    LineEas yx_2_eas(YX yx) const;
+    /// [The first] XY with the given address, or with the closest lower
+    /// address in the function.
     YX ea_2_yx(ea_t ea) const;
     /// Is address inside this function?
     bool ea_inside(ea_t ea) const;
 
+    /// Lines (indexes from 0) containing tokens of the given kind, by the
+    /// token values.
+    std::map<std::string, std::vector<std::size_t>> lines_with(Token::Kind kind) const;
+    /// Replace values of the tokens of the given kind on the given lines
+    /// (indexes from 0). Returns the number of replaced tokens.
+    std::size_t rename(
+            Token::Kind kind,
+            const std::string& oldVal,
+            const std::string& newVal,
+            const std::vector<std::size_t>& lines);
+    /// Replace values of the tokens of the given kind on all the lines.
+    std::size_t rename(
+            Token::Kind kind,
+            const std::string& oldVal,
+            const std::string& newVal);
+
     /// Lines with associated addresses.
     std::vector<std::pair<std::string, ea_t>> toLines() const;
     std::string toString() const;
+    /// Approximate memory taken by the object, in bytes.
+    std::size_t memorySize() const;
     friend std::ostream& operator<<(std::ostream& os, const Function& f);
 
 private:
-    func_t* m_p_func_t = nullptr;
-    std::map<YX, Token> m_tokens;
-    /// Multiple YXs can be associated with the same address.
-    /// This stores the first such XY.
-    std::map<ea_t, YX> m_ea2yx;
+    /// Token record - its value is m_text[offset, offset + length).
+    struct TokenEntry
+    {
+        ea_t ea = BADADDR;
+        uint32_t offset = 0;
+        uint32_t length = 0;
+        Token::Kind kind = Token::Kind::NEW_LINE;
+    };
+
+    static const std::size_t npos = std::size_t(-1);
+
+    /// Number of lines.
+    std::size_t lineCount() const;
+    /// Index of the line with the given Y, or npos.
+    std::size_t lineIndex(std::size_t y) const;
+    /// Index of the line containing the given token.
+    std::size_t lineOfToken(std::size_t i) const;
+    /// Index of the token containing the given YX (see adjust_yx()),
+    /// or npos if there are no tokens.
+    std::size_t tokenIndex(YX yx) const;
+    /// YX of the given token on the given line.
+    YX tokenYx(std::size_t i, std::size_t line) const;
+    /// YX of the given token.
+    YX tokenYx(std::size_t i) const;
+    /// Token object for the given token record.
+    Token makeToken(std::size_t i) const;
+    /// Append colored tokens [first, last) to the given string.
+    void appendColored(std::string& out, std::size_t first, std::size_t last) const;
+    /// Rename the tokens on the given line, see rename().
+    std::size_t renameOnLine(
+            std::size_t line,
+            Token::Kind kind,
+            const std::string& oldVal,
+            const std::string& newVal);
+    /// Drop the text of the lines rewritten by renames.
+    void compact();
+    /// Build the address index from the tokens.
+    void indexAddresses();
+
+private:
+    ea_t m_start = BADADDR;
+    ea_t m_end = BADADDR;
+    bool m_placeholder = false;
+    /// All the tokens in the YX order.
+    std::vector<TokenEntry> m_tokens;
+    /// Index of the first token of each line + the number of tokens.
+    std::vector<uint32_t> m_lines;
+    /// Values of all the tokens, each line in one piece.
+    std::string m_text;
+    /// Bytes of m_text no longer used by any token (old text of renamed
+    /// lines).
+    std::size_t m_garbage = 0;
+
+    /// Address interval [start, start of the next interval) - addresses
+    /// without tokens belong to the closest lower address with tokens.
+    /// Multiple YXs can be associated with the same address, the interval
+    /// refers to the first of them. Tokens are stored instead of XYs, which
+    /// are shifted by renames.
+    struct EaInterval
+    {
+        ea_t start = BADADDR;
+        /// The first token with the address.
+        uint32_t token = 0;
+        /// Line of the token.
+        uint32_t line = 0;
+    };
+    /// Intervals sorted by the start address.
+    std::vector<EaInterval> m_eaIntervals;
+    /// Sorted unique addresses of each line, one after another.
+    std::vector<ea_t> m_lineEas;
+    /// Index of the first address of each line in m_lineEas + the number of
+    /// addresses.
+    std::vector<uint32_t> m_lineEaStarts;
+
+    /// Colored line - range in m_coloredText.
+    struct ColoredLine
+    {
+        uint32_t offset = uint32_t(-1);
+        uint32_t length = 0;
+    };
+    /// Colored lines rendered so far. Lines are invalidated by renames.
+    mutable std::string m_coloredText;
+    mutable std::vector<ColoredLine> m_coloredLines;
 };
 
 #endif
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <iterator>
+#include <sstream>
+
+#include "functioncache.h"
+
+Function* FunctionCache::get(ea_t ea)
+{
+    auto it = m_entries.find(ea);
+    if (it == m_entries.end())
+    {
+        ++m_misses;
+        return nullptr;
+    }
+    ++m_hits;
+
+    auto& e = it->second;
+    m_lru.splice(m_lru.begin(), m_lru, e.lru);
+
+    // Functions grow when they are displayed (rendered lines).
+    std::size_t size = e.fnc.memorySize();
+    m_bytes = m_bytes - e.size + size;
+    e.size = size;
+
+    return &e.fnc;
+}
+
+Function* FunctionCache::peek(ea_t ea) const
+{
+    auto it = m_entries.find(ea);
+    return it != m_entries.end() ? const_cast<Function*>(&it->second.fnc) : nullptr;
+}
+
+bool FunctionCache::contains(ea_t ea) const
+{
+    return m_entries.count(ea) != 0;
+}
+
+Function* FunctionCache::put(ea_t ea, Function&& fnc)
+{
+    auto it = m_entries.find(ea);
+    if (it == m_entries.end())
+    {
+        it = m_entries.emplace(ea, Entry()).first;
+        m_lru.push_front(ea);
+        it->second.lru = m_lru.begin();
+    }
+    else
+    {
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+    }
+
+    auto& e = it->second;
+    unindex(ea, e.fnc);
+    e.fnc = std::move(fnc);
+    index(ea, e.fnc);
+    std::size_t size = e.fnc.memorySize();
+    m_bytes = m_bytes - e.size + size;
+    e.size = size;
+
+    trim(ea);
+    return &e.fnc;
+}
+
+std::vector<ea_t> FunctionCache::addresses() const
+{
+    std::vector<ea_t> ret;
+    ret.reserve(m_entries.size());
+    for (auto& p : m_entries)
+    {
+        ret.push_back(p.first);
+    }
+    return ret;
+}
+
+std::size_t FunctionCache::rename(
+        Token::Kind kind,
+        const std::string& oldVal,
+        const std::string& newVal)
+{
+    std::size_t n = 0;
+    if (oldVal == newVal)
+    {
+        return n;
+    }
+
+    if (!isIndexed(kind))
+    {
+        for (auto& p : m_entries)
+        {
+            if (std::size_t r = p.second.fnc.rename(kind, oldVal, newVal))
+            {
+                n += r;
+                resize(p.first);
+            }
+        }
+        return n;
+    }
+
+    auto it = m_identifiers.find({kind, oldVal});
+    if (it == m_identifiers.end())
+    {
+        return n;
+    }
+    auto fncs = std::move(it->second);
+    m_identifiers.erase(it);
+
+    auto& renamed = m_identifiers[{kind, newVal}];
+    for (auto& p : fncs)
+    {
+        auto eit = m_entries.find(p.first);
+        if (eit == m_entries.end())
+        {
+            continue;
+        }
+        n += eit->second.fnc.rename(kind, oldVal, newVal, p.second);
+        resize(p.first);
+
+        // The function may have contained the new name already.
+        auto& lines = renamed[p.first];
+        std::vector<std::size_t> merged;
+        std::set_union(
+                lines.begin(), lines.end(),
+                p.second.begin(), p.second.end(),
+                std::back_inserter(merged));
+        lines = std::move(merged);
+    }
+    if (renamed.empty())
+    {
+        m_identifiers.erase({kind, newVal});
+    }
+
+    trim(BADADDR);
+    return n;
+}
+
+bool FunctionCache::isIndexed(Token::Kind kind)
+{
+    // Only global objects are renamed across functions.
+    return kind == Token::Kind::ID_FNC || kind == Token::Kind::ID_GVAR;
+}
+
+void FunctionCache::index(ea_t ea, const Function& fnc)
+{
+    for (auto kind : {Token::Kind::ID_FNC, Token::Kind::ID_GVAR})
+    {
+        for (auto& p : fnc.lines_with(kind))
+        {
+            m_identifiers[{kind, p.first}][ea] = std::move(p.second);
+        }
+    }
+}
+
+void FunctionCache::unindex(ea_t ea, const Function& fnc)
+{
+    for (auto kind : {Token::Kind::ID_FNC, Token::Kind::ID_GVAR})
+    {
+        for (auto& p : fnc.lines_with(kind))
+        {
+            auto it = m_identifiers.find({kind, p.first});
+            if (it == m_identifiers.end())
+            {
+                continue;
+            }
+            it->second.erase(ea);
+            if (it->second.empty())
+            {
+                m_identifiers.erase(it);
+            }
+        }
+    }
+}
+
+void FunctionCache::resize(ea_t ea)
+{
+    auto& e = m_entries.at(ea);
+    std::size_t size = e.fnc.memorySize();
+    m_bytes = m_bytes - e.size + size;
+    e.size = size;
+}
+
+void FunctionCache::pin(ea_t ea)
+{
+    m_pinned = ea;
+}
+
+void FunctionCache::hold(ea_t ea)
+{
+    ++m_held[ea];
+}
+
+void FunctionCache::release(ea_t ea)
+{
+    auto it = m_held.find(ea);
+    if (it == m_held.end())
+    {
+        return;
+    }
+    if (--it->second == 0)
+    {
+        m_held.erase(it);
+        trim(BADADDR);
+    }
+}
+
+void FunctionCache::setBudget(std::size_t bytes)
+{
+    m_budget = bytes;
+    trim(BADADDR);
+}
+
+void FunctionCache::trim(ea_t keep)
+{
+    if (m_budget == 0)
+    {
+        return;
+    }
+
+    auto it = m_lru.end();
+    while (m_bytes > m_budget && it != m_lru.begin())
+    {
+        --it;
+        ea_t ea = *it;
+        auto eit = m_entries.find(ea);
+        // Placeholders are small, and their functions are being decompiled -
+        // they could not be reloaded from the persistent cache.
+        if (ea == m_pinned
+                || ea == keep
+                || m_held.count(ea)
+                || eit->second.fnc.isPlaceholder())
+        {
+            continue;
+        }
+
+        m_bytes -= eit->second.size;
+        unindex(ea, eit->second.fnc);
+        m_entries.erase(eit);
+        it = m_lru.erase(it);
+        ++m_evictions;
+    }
+}
+
+std::size_t FunctionCache::size() const
+{
+    return m_entries.size();
+}
+
+std::size_t FunctionCache::bytes() const
+{
+    return m_bytes;
+}
+
+std::size_t FunctionCache::hits() const
+{
+    return m_hits;
+}
+
+std::size_t FunctionCache::misses() const
+{
+    return m_misses;
+}
+
+std::size_t FunctionCache::evictions() const
+{
+    return m_evictions;
+}
+
+std::string FunctionCache::statistics() const
+{
+    std::stringstream ss;
+    ss << size() << " functions, "
+       << bytes() / 1024 << " kB"
+       << " (hits: " << hits()
+       << ", misses: " << misses()
+       << ", evictions: " << evictions() << ")";
+    return ss.str();
+}
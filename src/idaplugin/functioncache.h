@@ -0,0 +1,115 @@
+#ifndef RETDEC_FUNCTIONCACHE_H
+#define RETDEC_FUNCTIONCACHE_H
+
+#include <list>
+#include <string>
+#include <map>
+#include <vector>
+
+#include "function.h"
+#include "utils.h"
+
+/**
+ * Decompiled functions resident in memory, by their start addresses.
+ *
+ * The cache has a byte budget. When it is exceeded, the least recently used
+ * functions are evicted - except for the pinned (displayed) one and the held
+ * ones (displayed in pinned viewers). Evicted
+ * functions are not lost, their outputs are in the persistent decompilation
+ * cache (see cache.h) and they are reloaded from there on demand.
+ *
+ * Replacing a function keeps the object's address, so pointers to it stay
+ * valid until the function is evicted. Holders of long-lived pointers
+ * (places) must check them with peek() before use.
+ *
+ * Identifiers of global objects (functions and global variables) are indexed
+ * - a rename patches only the functions and lines which contain the renamed
+ * identifier.
+ *
+ * Must be used from the main thread only.
+ */
+class FunctionCache
+{
+public:
+    /// Function starting at @p ea, or \c nullptr.
+    /// Counts a hit/miss and marks the function as recently used.
+    Function* get(ea_t ea);
+    /// Function starting at @p ea, or \c nullptr. No side effects.
+    Function* peek(ea_t ea) const;
+    bool contains(ea_t ea) const;
+
+    /// Insert the function, or replace the existing one in place.
+    /// May evict other functions.
+    Function* put(ea_t ea, Function&& fnc);
+    /// Start addresses of all the resident functions.
+    std::vector<ea_t> addresses() const;
+    /// Replace values of the tokens of the given kind in all the resident
+    /// functions, see Function::rename(). Returns the number of replaced
+    /// tokens.
+    std::size_t rename(
+            Token::Kind kind,
+            const std::string& oldVal,
+            const std::string& newVal);
+
+    /// The function starting at @p ea is never evicted (BADADDR = none).
+    void pin(ea_t ea);
+    /// Do not evict the function starting at @p ea until it is released.
+    /// Holds are counted - a function may be held several times.
+    void hold(ea_t ea);
+    void release(ea_t ea);
+    /// Set the budget in bytes (0 = unlimited). May evict functions.
+    void setBudget(std::size_t bytes);
+
+    /// Number of resident functions.
+    std::size_t size() const;
+    /// Memory taken by the resident functions.
+    std::size_t bytes() const;
+    std::size_t hits() const;
+    std::size_t misses() const;
+    std::size_t evictions() const;
+    std::string statistics() const;
+
+private:
+    /// Evict the least recently used functions until the budget is met.
+    /// The pinned and held functions, placeholders and @p keep are never
+    /// evicted.
+    void trim(ea_t keep);
+
+    /// Are identifiers of the given kind indexed?
+    static bool isIndexed(Token::Kind kind);
+    /// Add identifiers of the function to the index.
+    void index(ea_t ea, const Function& fnc);
+    /// Remove identifiers of the function from the index.
+    void unindex(ea_t ea, const Function& fnc);
+    /// Recompute the entry's size after a change of its function.
+    void resize(ea_t ea);
+
+private:
+    struct Entry
+    {
+        Function fnc;
+        /// Size accounted in m_bytes.
+        std::size_t size = 0;
+        /// Position in m_lru.
+        std::list<ea_t>::iterator lru;
+    };
+
+    std::map<ea_t, Entry> m_entries;
+    /// Indexed identifiers -> functions and their lines with the identifier.
+    std::map<
+            std::pair<Token::Kind, std::string>,
+            std::map<ea_t, std::vector<std::size_t>>> m_identifiers;
+    /// Most recently used first.
+    std::list<ea_t> m_lru;
+    ea_t m_pinned = BADADDR;
+    /// Held functions and their hold counts.
+    std::map<ea_t, unsigned> m_held;
+
+    std::size_t m_budget = 0;
+    std::size_t m_bytes = 0;
+    std::size_t m_hits = 0;
+    std::size_t m_misses = 0;
+    std::size_t m_evictions = 0;
+};
+
+#endif
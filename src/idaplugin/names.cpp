@@ -0,0 +1,196 @@
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+#include "names.h"
+
+namespace {
+
+using NameMap = std::unordered_map<std::string, std::set<ea_t>>;
+
+/**
+ * Name index - see names.h.
+ */
+struct NameIndex
+{
+    bool built = false;
+    /// All the addresses with the name - the lowest one is looked up.
+    /// Exact IDA names of functions.
+    NameMap functions;
+    /// Other names of functions (forms used in the decompiled code,
+    /// demangled names) - looked up only if there is no exact match.
+    NameMap functionAliases;
+    /// Names of global data items.
+    NameMap globals;
+    /// Names indexed for each address, so that they can be removed.
+    std::unordered_map<ea_t, std::vector<std::string>> names;
+    /// Addresses whose names changed since the last lookup.
+    std::set<ea_t> dirty;
+};
+
+NameIndex nameIndex;
+
+/**
+ * Index the name under the given address.
+ * More addresses may have the same name (e.g. demangled overloads), all of
+ * them are kept, so that another one is found when one of them is removed.
+ */
+void addName(NameMap& names, const std::string& name, ea_t ea)
+{
+    if (name.empty())
+    {
+        return;
+    }
+    if (names[name].insert(ea).second)
+    {
+        nameIndex.names[ea].push_back(name);
+    }
+}
+
+/**
+ * The lowest address with the name, or \c BADADDR.
+ */
+ea_t findName(const NameMap& names, const std::string& name)
+{
+    auto it = names.find(name);
+    return it != names.end() ? *it->second.begin() : BADADDR;
+}
+
+/**
+ * Index all the names of the item at the given address.
+ * Addresses which are neither function starts nor named data (e.g. deleted
+ * functions, code labels) are not indexed.
+ */
+void addNames(ea_t ea)
+{
+    qstring buff;
+    func_t* f = get_func(ea);
+    if (f && f->start_ea == ea)
+    {
+        if (get_func_name(&buff, ea) <= 0)
+        {
+            return;
+        }
+        std::string name = buff.c_str();
+        addName(nameIndex.functions, name, ea);
+
+        // Name used in the config, see generateFunction().
+        std::string configName = name;
+        std::replace(configName.begin(), configName.end(), '.', '_');
+        if (configName != name)
+        {
+            addName(nameIndex.functionAliases, configName, ea);
+        }
+
+        qstring qDemangled;
+        if (demangle_name(&qDemangled, configName.c_str(), MNG_SHORT_FORM) > 0
+                && name != qDemangled.c_str())
+        {
+            addName(nameIndex.functionAliases, qDemangled.c_str(), ea);
+        }
+        return;
+    }
+
+    flags_t flags = get_flags(ea);
+    if (is_data(flags) && has_name(flags) && get_name(&buff, ea) > 0)
+    {
+        addName(nameIndex.globals, buff.c_str(), ea);
+    }
+}
+
+/**
+ * Remove all the names indexed under the given address.
+ */
+void removeNames(ea_t ea)
+{
+    auto it = nameIndex.names.find(ea);
+    if (it == nameIndex.names.end())
+    {
+        return;
+    }
+
+    for (auto& name : it->second)
+    {
+        for (auto* names : {
+                &nameIndex.functions,
+                &nameIndex.functionAliases,
+                &nameIndex.globals})
+        {
+            auto nit = names->find(name);
+            if (nit == names->end())
+            {
+                continue;
+            }
+            nit->second.erase(ea);
+            if (nit->second.empty())
+            {
+                names->erase(nit);
+            }
+        }
+    }
+    nameIndex.names.erase(it);
+}
+
+/**
+ * Build the index, or re-index the changed addresses.
+ */
+void updateNameIndex()
+{
+    if (!nameIndex.built)
+    {
+        nameIndex = NameIndex();
+
+        for (std::size_t i = 0; i < get_func_qty(); ++i)
+        {
+            addNames(getn_func(i)->start_ea);
+        }
+        // Named items (without dummy names).
+        for (std::size_t i = 0; i < get_nlist_size(); ++i)
+        {
+            ea_t ea = get_nlist_ea(i);
+            if (nameIndex.names.count(ea) == 0)
+            {
+                addNames(ea);
+            }
+        }
+
+        nameIndex.built = true;
+        return;
+    }
+
+    for (ea_t ea : nameIndex.dirty)
+    {
+        removeNames(ea);
+        addNames(ea);
+    }
+    nameIndex.dirty.clear();
+}
+
+} // anonymous namespace
+
+ea_t findFunctionByName(const std::string& name)
+{
+    updateNameIndex();
+    ea_t ea = findName(nameIndex.functions, name);
+    return ea != BADADDR ? ea : findName(nameIndex.functionAliases, name);
+}
+
+ea_t findGlobalByName(const std::string& name)
+{
+    updateNameIndex();
+    return findName(nameIndex.globals, name);
+}
+
+void invalidateNameIndex()
+{
+    nameIndex = NameIndex();
+}
+
+void invalidateNameIndex(ea_t ea)
+{
+    if (nameIndex.built)
+    {
+        nameIndex.dirty.insert(ea);
+    }
+}
@@ -0,0 +1,31 @@
+#ifndef RETDEC_NAMES_H
+#define RETDEC_NAMES_H
+
+#include <string>
+
+#include "utils.h"
+
+/**
+ * Name to address index.
+ *
+ * Maps names of functions (IDA names, their forms used in the decompiled
+ * code, and demangled names) and named global data items to their addresses.
+ * Built on the first lookup, and kept up to date by IDB change
+ * notifications - changed addresses are re-indexed on the next lookup.
+ * Exact IDA names of functions take precedence over the other forms. If
+ * more addresses have the same name, the lowest one is found.
+ *
+ * Must be used from the main thread only.
+ */
+
+/// Start of the function with the given name, or \c BADADDR.
+ea_t findFunctionByName(const std::string& name);
+/// Address of the named global (non-function) item, or \c BADADDR.
+ea_t findGlobalByName(const std::string& name);
+
+/// Drop the whole index, it is rebuilt on the next lookup.
+void invalidateNameIndex();
+/// Names at the given address changed (rename, function added/deleted).
+void invalidateNameIndex(ea_t ea);
+
+#endif
@@ -35,13 +35,13 @@ void idaapi retdec_place_t::copyfrom(const place_t* from)
     }
 
     lnnum = p->lnnum;
-    m_pFunction = p->m_pFunction;
+    m_fncStart = p->m_fncStart;
     _yx = p->_yx;
 }
 
 place_t* idaapi retdec_place_t::makeplace(void* ud, uval_t y, int lnnum) const
 {
-    auto* p = new retdec_place_t(m_pFunction, YX(y, 0));
+    auto* p = new retdec_place_t(m_fncStart, YX(y, 0));
     VERIFY(nullptr != p);
     if (nullptr == p)
     {
@@ -66,19 +66,19 @@ int idaapi retdec_place_t::compare2(const place_t* t2, void *ud) const
         return 0;
     }
 
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    VERIFY(BADADDR != m_fncStart);
+    if (BADADDR == m_fncStart)
     {
         return 0;
     }
 
-    VERIFY(nullptr != p->m_pFunction);
-    if (nullptr == p->m_pFunction)
+    VERIFY(BADADDR != p->m_fncStart);
+    if (BADADDR == p->m_fncStart)
     {
         return 0;
     }
 
-    if (m_pFunction == p->m_pFunction)
+    if (m_fncStart == p->m_fncStart)
     {
         if (yx() < p->yx())
             return -1;
@@ -89,7 +89,7 @@ int idaapi retdec_place_t::compare2(const place_t* t2, void *ud) const
     }
     // I'm not sure if this can happen (i.e. places from different functions
     // are compared), but better safe than sorry.
-    else if (m_pFunction->getStart() < p->m_pFunction->getStart())
+    else if (m_fncStart < p->m_fncStart)
     {
         return -1;
     }
@@ -111,14 +111,15 @@ void idaapi retdec_place_t::adjust(void* ud)
 
 bool idaapi retdec_place_t::prev(void* ud)
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return false;
     }
 
-    auto pyx = m_pFunction->prev_yx(yx());
-    if (yx() <= m_pFunction->min_yx() || pyx == yx())
+    auto pyx = fnc->prev_yx(yx());
+    if (yx() <= fnc->min_yx() || pyx == yx())
     {
         return false;
     }
@@ -129,14 +130,15 @@ bool idaapi retdec_place_t::prev(void* ud)
 
 bool idaapi retdec_place_t::next(void* ud)
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return false;
     }
 
-    auto nyx = m_pFunction->next_yx(yx());
-    if (yx() >= m_pFunction->max_yx() || nyx == yx())
+    auto nyx = fnc->next_yx(yx());
+    if (yx() >= fnc->max_yx() || nyx == yx())
     {
         return false;
     }
@@ -147,24 +149,26 @@ bool idaapi retdec_place_t::next(void* ud)
 
 bool idaapi retdec_place_t::beginning(void* ud) const
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return false;
     }
 
-    return yx() == m_pFunction->min_yx();
+    return yx() == fnc->min_yx();
 }
 
 bool idaapi retdec_place_t::ending(void* ud) const
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return false;
     }
 
-    return yx() == m_pFunction->max_yx();
+    return yx() == fnc->max_yx();
 }
 
 int idaapi retdec_place_t::generate(qstrvec_t* out,
@@ -174,8 +178,9 @@ int idaapi retdec_place_t::generate(qstrvec_t* out,
                                     void* ud,
                                     int maxsize) const
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return 0;
     }
@@ -192,8 +197,8 @@ int idaapi retdec_place_t::generate(qstrvec_t* out,
 
     *out_deflnnum = 0;
 
-    std::string str = m_pFunction->line_yx(yx());
-    out->push_back(str.c_str());
+    auto line = fnc->colored_line(y());
+    out->push_back(qstring(line.data(), line.size()));
 
     return 1;
 }
@@ -209,13 +214,13 @@ void idaapi retdec_place_t::serialize(bytevec_t* out) const
 {
     place_t__serialize(this, out);
 #if IDA_SDK_VERSION > 720
-    out->pack_ea(m_pFunction->getStart());
+    out->pack_ea(m_fncStart);
     out->pack_ea(y());
     out->pack_ea(x());
 #else
     uchar packed[10] = { 0 };
 
-    size_t len = ::pack_ea(packed, packed + sizeof(packed), m_pFunction->getStart()) - packed;
+    size_t len = ::pack_ea(packed, packed + sizeof(packed), m_fncStart) - packed;
     out->append(packed, len);
 
     memset(packed, 0, sizeof(packed));
@@ -234,8 +239,12 @@ bool idaapi retdec_place_t::deserialize(const uchar** pptr,const uchar* end)
     {
         return false;
     }
+    // Do not decompile here - IDA deserializes all the places from the
+    // location history when IDB is opened. The function is resolved when the
+    // place is used, see getFunction().
     auto fa = unpack_ea(pptr, end);
-    m_pFunction = RetDec::selectiveDecompilation(fa, false);
+    func_t* f = get_func(fa);
+    m_fncStart = f ? f->start_ea : BADADDR;
     auto y = unpack_ea(pptr, end);
     auto x = unpack_ea(pptr, end);
     _yx = YX(y, x);
@@ -254,13 +263,14 @@ const char* idaapi retdec_place_t::name() const
 
 ea_t idaapi retdec_place_t::toea() const
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
         return BADADDR;
     }
 
-    return m_pFunction->yx_2_ea(yx());
+    return fnc->yx_2_ea(yx());
 }
 
 bool idaapi retdec_place_t::rebase(const segm_move_infos_t&)
@@ -282,7 +292,12 @@ void idaapi retdec_place_t::leave(uint32) const
 
 int retdec_place_t::ID = -1;
 
-retdec_place_t::retdec_place_t(Function* fnc, YX yx) : m_pFunction(fnc), _yx(yx)
+retdec_place_t::retdec_place_t(Function* fnc, YX yx) :
+        retdec_place_t(fnc ? fnc->getStart() : BADADDR, yx)
+{
+}
+
+retdec_place_t::retdec_place_t(ea_t fncStart, YX yx) : m_fncStart(fncStart), _yx(yx)
 {
     lnnum = 0;
 }
@@ -336,20 +351,41 @@ std::size_t retdec_place_t::x() const
     return yx().x;
 }
 
-const Token* retdec_place_t::token() const
+std::optional<Token> retdec_place_t::token() const
 {
-    VERIFY(nullptr != m_pFunction);
-    if (nullptr == m_pFunction)
+    auto* fnc = getFunction();
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
     {
-        return false;
+        return std::nullopt;
     }
 
-    return m_pFunction->getToken(yx());
+    return fnc->getToken(yx());
 }
 
+/**
+ * The function is looked up in the function cache. If it is not there (it was
+ * evicted, or the place was restored from IDB), it is reloaded from the
+ * persistent decompilation cache, or a placeholder is returned and it is
+ * decompiled in the background.
+ */
 Function* retdec_place_t::getFunction() const
 {
-    return m_pFunction;
+    if (m_fncStart == BADADDR)
+    {
+        return nullptr;
+    }
+
+    if (auto* fnc = RetDec::fnc2fnc.peek(m_fncStart))
+    {
+        return fnc;
+    }
+    return RetDec::lazyDecompilation(m_fncStart);
+}
+
+ea_t retdec_place_t::getFunctionStart() const
+{
+    return m_fncStart;
 }
 
 std::string retdec_place_t::toString() const
@@ -403,33 +439,20 @@ bool idaapi place_converter(lochist_entry_t* dst, const lochist_entry_t& src, TW
             return false;
         }
 
-        if (p_curFnc->ea_inside(idaEa))
+        // Called while the user moves around the synced disassembly - it must
+        // not block, the viewer stays where it is if there is no function.
+        Function* fnc = RetDec::syncedDecompilation(idaEa, p_curFnc);
+        if (fnc == nullptr)
         {
-            retdec_place_t p(p_curFnc, p_curFnc->ea_2_yx(idaEa));
-            dst->set_place(p);
-            // Set both x and y, see renderer_info_t comment in demo.cpp.
-            dst->renderer_info().pos.cy = p.y();
-            dst->renderer_info().pos.cx = p.x();
-        }
-        else
-        {
-            Function* fnc =  RetDec::selectiveDecompilation(idaEa, false);
-            VERIFY(nullptr != fnc);
-            if (fnc)
-            {
-                retdec_place_t cur(fnc, fnc->ea_2_yx(idaEa));
-                dst->set_place(cur);
-
-                // Set both x and y, see renderer_info_t comment in demo.cpp.
-                dst->renderer_info().pos.cy = cur.y();
-                dst->renderer_info().pos.cx = cur.x();
-            }
-            else
-            {
-                return false;
-            }
+            return false;
         }
 
+        retdec_place_t p(fnc, fnc->ea_2_yx(idaEa));
+        dst->set_place(p);
+        // Set both x and y, see renderer_info_t comment in demo.cpp.
+        dst->renderer_info().pos.cy = p.y();
+        dst->renderer_info().pos.cx = p.x();
+
         return true;
     }
     // retdec_place_t -> idaplace_t
@@ -185,13 +185,16 @@ public:
     static int ID;
 
     retdec_place_t(Function* fnc, YX yx);
+    retdec_place_t(ea_t fncStart, YX yx);
     static void registerPlace(const plugin_t& PLUGIN);
 
     YX yx() const;
     std::size_t y() const;
     std::size_t x() const;
-    const Token* token() const;
+    std::optional<Token> token() const;
     Function* getFunction() const;
+    /// Start address of the place's function.
+    ea_t getFunctionStart() const;
 
     std::string toString() const;
     friend std::ostream& operator<<(std::ostream& os, const retdec_place_t& p);
@@ -199,7 +202,10 @@ public:
 private:
     inline static const char* _name = "retdec_place_t";
 
-    Function* m_pFunction = nullptr;
+    /// Functions may be evicted from the function cache while places still
+    /// exist (e.g. in the navigation history), so places refer to them by
+    /// their start addresses and resolve them on each use.
+    ea_t m_fncStart = BADADDR;
     YX _yx;
 };
 
@@ -0,0 +1,367 @@
+#include <fstream>
+#include <sstream>
+
+#include <retdec/utils/filesystem.h>
+
+#include "profile.h"
+#include "retdec.h"
+
+static BinaryProfile profile;
+/// Is the profile up to date?
+static bool profileValid = false;
+/// Was the user asked to locate the input file since the invalidation?
+static bool inputAsked = false;
+/// Was the profile message shown to the user since the invalidation?
+static bool messageShown = false;
+
+/**
+ * Record why the input cannot be decompiled (or a warning about it) into the
+ * profile @c p. Formatted like WARNING_GUI().
+ */
+#define INPUT_MESSAGE(body)                                                    \
+    {                                                                          \
+        std::stringstream ss;                                                  \
+        ss << std::showbase << body;                                           \
+        p.message = ss.str();                                                  \
+    }
+
+/**
+ * Find the input file - at its original path, or next to the IDB if it was
+ * moved. Never asks the user, see askInputPath().
+ */
+std::string findInputPath()
+{
+    char buff[MAXSTR] = { 0 };
+
+    get_root_filename(buff, sizeof(buff));
+    std::string inName = buff;
+
+    get_input_file_path(buff, sizeof(buff));
+    std::string inPath = buff;
+
+    std::string idb = get_path(PATH_TYPE_IDB);
+    std::string id0 = get_path(PATH_TYPE_ID0);
+    std::string workDir;
+    if (!idb.empty())
+    {
+        fs::path fsIdb(idb);
+        workDir = fsIdb.parent_path().string();
+    }
+    else if (!id0.empty())
+    {
+        fs::path fsId0(id0);
+        workDir = fsId0.parent_path().string();
+    }
+    if (workDir.empty())
+    {
+        return std::string();
+    }
+
+    if (!fs::exists(inPath))
+    {
+        fs::path fsWork(workDir);
+        fsWork.append(inName);
+        inPath = fsWork.string();
+
+        if (!fs::exists(inPath))
+        {
+            return std::string();
+        }
+    }
+
+    return inPath;
+}
+
+/**
+ * Ask the user to locate the input file.
+ */
+std::string askInputPath()
+{
+    char *tmp = ask_file(                ///< Returns: file name
+            false,                       ///< bool for_saving
+            nullptr,                     ///< const char *default_answer
+            "%s",                        ///< const char *format
+            "Input binary to decompile");
+
+    if (tmp == nullptr)
+    {
+        return std::string();
+    }
+    if (!fs::exists(std::string(tmp)))
+    {
+        return std::string();
+    }
+
+    return tmp;
+}
+
+/**
+ * Is the input file relocatable?
+ */
+bool readRelocatable(const std::string& inFile)
+{
+    if (inf.filetype == f_COFF && inf.start_ea == BADADDR)
+    {
+        return true;
+    }
+    else if (inf.filetype == f_ELF)
+    {
+        if (inFile.empty())
+        {
+            return false;
+        }
+
+        std::ifstream infile(inFile, std::ios::binary);
+        if (infile.good())
+        {
+            std::size_t e_type_offset = 0x10;
+            infile.seekg(e_type_offset, std::ios::beg);
+
+            // relocatable -- constant 0x1 at <0x10-0x11>
+            // little endian -- 0x01 0x00
+            // big endian -- 0x00 0x01
+            char b1 = 0;
+            char b2 = 0;
+            if (infile.get(b1))
+            {
+                if (infile.get(b2))
+                {
+                    if (std::size_t(b1) + std::size_t(b2) == 1)
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    // f_BIN || f_PE || f_HEX || other
+    return false;
+}
+
+/**
+ * Perform startup check that determines, if plugin can decompile IDA's input file.
+ * @return True if plugin can decompile IDA's input, false otherwise.
+ */
+bool canDecompileInput(BinaryProfile& p)
+{
+    std::string procName = inf.procname;
+    auto fileType = inf.filetype;
+
+    // 32-bit binary -> is_32bit() == 1 && is_64bit() == 0.
+    // 64-bit binary -> is_32bit() == 1 && is_64bit() == 1.
+    // Allow 64-bit x86 and arm.
+    if (inf.is_64bit())
+    {
+        if (!p.x86 && procName != "ARM")
+        {
+            INPUT_MESSAGE(RetDec::pluginName << " version " << RetDec::pluginVersion
+                    << " cannot decompile 64-bit for PROCNAME = " << procName
+            );
+            return false;
+        }
+    }
+    else if (!inf.is_32bit())
+    {
+        INPUT_MESSAGE(RetDec::pluginName << " version " << RetDec::pluginVersion
+                << " cannot decompile PROCNAME = " << procName
+        );
+        return false;
+    }
+
+    if (!(fileType == f_BIN
+        || fileType == f_PE
+        || fileType == f_ELF
+        || fileType == f_COFF
+        || fileType == f_MACHO
+        || fileType == f_HEX))
+    {
+        if (fileType == f_LOADER)
+        {
+            INPUT_MESSAGE("Custom IDA loader plugin was used.\n"
+                    "Decompilation will be attempted, but:\n"
+                    "1. RetDec idaplugin can not check if the input can be "
+                    "decompiled. Decompilation may fail.\n"
+                    "2. If the custom loader behaves differently than the RetDec "
+                    "loader, decompilation may fail or produce nonsensical result."
+            );
+        }
+        else
+        {
+            INPUT_MESSAGE(RetDec::pluginName
+                    << " version " << RetDec::pluginVersion
+                    << " cannot decompile this input file (file type = "
+                    << fileType << ").\n"
+            );
+            return false;
+        }
+    }
+
+    // Check Intel HEX.
+    //
+    if (fileType == f_HEX)
+    {
+        if (procName == "mipsr" || procName == "mipsb")
+        {
+            p.arch = "mips";
+            p.endian = "big";
+        }
+        else if (procName == "mipsrl"
+                || procName == "mipsl"
+                || procName == "psp")
+        {
+            p.arch = "mips";
+            p.endian = "little";
+        }
+        else
+        {
+            INPUT_MESSAGE("Intel HEX input file can be decompiled only for one of "
+                    "these {mipsr, mipsb, mipsrl, mipsl, psp} processors, "
+                    "not \"" << procName << "\".\n");
+            return false;
+        }
+    }
+
+    // Check BIN (RAW).
+    //
+    if (fileType == f_BIN)
+    {
+        if (inf.is_64bit())
+            p.bitSize = 64;
+        else if (inf.is_32bit())
+            p.bitSize = 32;
+        else
+        {
+            INPUT_MESSAGE("Can decompile only 32/64 bit f_BIN.\n");
+            return false;
+        }
+        p.isRaw = true;
+
+        // Section VMA.
+        //
+        p.rawSectionVma = inf.min_ea;
+
+        // Entry point.
+        //
+        if (inf.start_ea != BADADDR)
+        {
+            p.rawEntryPoint = inf.start_ea;
+        }
+        else
+        {
+            p.rawEntryPoint = p.rawSectionVma;
+        }
+
+        // Architecture + endian.
+        //
+        if (procName == "mipsr" || procName == "mipsb")
+        {
+            p.arch = "mips";
+            p.endian = "big";
+        }
+        else if (procName == "mipsrl" || procName == "mipsl" || procName == "psp")
+        {
+            p.arch = "mips";
+            p.endian = "little";
+        }
+        else if (procName == "ARM")
+        {
+            p.arch = "arm";
+            p.endian = "little";
+        }
+        else if (procName == "ARMB")
+        {
+            p.arch = "arm";
+            p.endian = "big";
+        }
+        else if (procName == "PPCL")
+        {
+            p.arch = "powerpc";
+            p.endian = "little";
+        }
+        else if (procName == "PPC")
+        {
+            p.arch = "powerpc";
+            p.endian = "big";
+        }
+        else if (p.x86)
+        {
+            p.arch = inf.is_64bit() ? "x86-64" : "x86";
+            p.endian = "little";
+        }
+        else
+        {
+            INPUT_MESSAGE("Binary input file can be decompiled only for one of these "
+                    "{mipsr, mipsb, mipsrl, mipsl, psp, ARM, ARMB, PPCL, PPC, 80386p, "
+                    "80386r, 80486p, 80486r, 80586p, 80586r, 80686p, p2, p3, p4} "
+                    "processors, not \"" << procName << "\".\n");
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Compute the profile of the input file at the given path (may be empty).
+ */
+BinaryProfile computeProfile(const std::string& inputPath)
+{
+    BinaryProfile p;
+    p.inputPath = inputPath;
+    retrieve_input_file_md5(p.md5);
+    p.relocatable = readRelocatable(p.inputPath);
+    p.x86 = isX86();
+    p.decompilable = canDecompileInput(p);
+    return p;
+}
+
+const BinaryProfile& getBinaryProfile()
+{
+    if (!profileValid)
+    {
+        profile = computeProfile(findInputPath());
+        profileValid = true;
+    }
+    return profile;
+}
+
+bool locateInputFile()
+{
+    if (!getBinaryProfile().inputPath.empty())
+    {
+        return false;
+    }
+    if (inputAsked)
+    {
+        return true;
+    }
+
+    inputAsked = true;
+    std::string inputPath = askInputPath();
+    if (inputPath.empty())
+    {
+        return true;
+    }
+
+    profile = computeProfile(inputPath);
+    return false;
+}
+
+bool warnUndecompilableInput()
+{
+    auto& p = getBinaryProfile();
+    if (!p.message.empty() && (!p.decompilable || !messageShown))
+    {
+        WARNING_GUI(p.message);
+        messageShown = true;
+    }
+    return !p.decompilable;
+}
+
+void invalidateBinaryProfile()
+{
+    profileValid = false;
+    inputAsked = false;
+    messageShown = false;
+}
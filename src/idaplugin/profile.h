@@ -0,0 +1,76 @@
+#ifndef RETDEC_PROFILE_H
+#define RETDEC_PROFILE_H
+
+#include <string>
+
+#include <retdec/common/address.h>
+
+#include "utils.h"
+
+/**
+ * Facts about the input binary the decompilations depend on.
+ *
+ * Computing them is not free - the input file is looked up on disk and
+ * ELF headers are read - so they are computed once per database and
+ * refreshed only when the database is closed, rebased, or a loader finishes.
+ *
+ * Must be used from the main thread only.
+ */
+struct BinaryProfile
+{
+    /// Full path to the input file, empty if it was not found.
+    std::string inputPath;
+    /// MD5 of the input file as recorded by IDA.
+    uchar md5[16] = { 0 };
+
+    /// Is the input a relocatable object?
+    bool relocatable = false;
+    /// Is the processor some x86 flavour?
+    bool x86 = false;
+
+    /// Can the input be decompiled?
+    bool decompilable = false;
+    /// Why the input cannot be decompiled, or a warning about it.
+    std::string message;
+
+    // Config header - see generateHeader().
+    std::string arch;
+    std::string endian;
+    unsigned bitSize = 0;
+    retdec::common::Address rawSectionVma;
+    retdec::common::Address rawEntryPoint;
+    bool isRaw = false;
+};
+
+/**
+ * Profile of the input binary of the current database.
+ * Never asks the user - if the input file is not found, the input path is
+ * empty until locateInputFile() finds it. The profile is kept, even without
+ * the input file, until it is invalidated.
+ */
+const BinaryProfile& getBinaryProfile();
+
+/**
+ * Ask the user to locate the input file if it was not found.
+ * The user is asked at most once until the profile is invalidated.
+ * Call it only from actions started by the user, never from syncing,
+ * prefetching or rendering.
+ * Returns \c true if there is no input file.
+ */
+bool locateInputFile();
+
+/**
+ * Show the profile message (why the input cannot be decompiled, or a warning
+ * about it) to the user. A warning is shown only once until the profile is
+ * invalidated, the reason why the input cannot be decompiled every time.
+ * Call it only from actions started by the user, like locateInputFile().
+ * Returns \c true if the input cannot be decompiled.
+ */
+bool warnUndecompilableInput();
+
+/**
+ * Drop the profile, it is computed on the next use.
+ */
+void invalidateBinaryProfile();
+
+#endif
@@ -1,11 +1,23 @@
-#include <retdec/retdec/retdec.h>
+#include <algorithm>
+#include <fstream>
+#include <thread>
+
 #include <retdec/utils/binary_path.h>
 
+#include "batch.h"
+#include "cache.h"
 #include "function.h"
 #include "config.h"
+#include "decompiler.h"
+#include "names.h"
 #include "place.h"
+#include "profile.h"
 #include "retdec.h"
+#include "settings.h"
+#include "shards.h"
+#include "trace.h"
 #include "ui.h"
+#include "workerpool.h"
 
 RetDec *g_pRetDec = nullptr;
 
@@ -21,6 +33,18 @@ ssize_t idaapi retdec_ui_hook_callback(void *user_data, int code, va_list va)
     return 0;
 }
 
+ssize_t idaapi retdec_idb_hook_callback(void *user_data, int code, va_list va)
+{
+    RetDec *prd = static_cast<RetDec*>(user_data);
+    VERIFY(nullptr != prd);
+    if (nullptr != prd)
+    {
+        return RetDec::on_idb_event(prd, code, va);
+    }
+
+    return 0;
+}
+
 int idaapi init(void)
 {
     if (nullptr == g_pRetDec)
@@ -71,7 +95,7 @@ plugin_t PLUGIN =
     RetDec::pluginHotkey.data()     // the preferred plugin hotkey
 };
 
-std::map<func_t*, Function> RetDec::fnc2fnc;
+FunctionCache RetDec::fnc2fnc;
 retdec::config::Config RetDec::config;
 
 RetDec::RetDec()
@@ -89,6 +113,10 @@ RetDec::RetDec()
         return;
     }
 
+    settings.load();
+    fnc2fnc.setBudget(std::size_t(settings.cacheBudgetMb) * 1024 * 1024);
+    startWorkers();
+
     if (!register_action(fullDecompilation_ah_desc)
         || !attach_action_to_menu(
                 "File/Produce file/Create DIF file",
@@ -98,6 +126,25 @@ RetDec::RetDec()
         ERROR_MSG("Failed to register: " << fullDecompilation_ah_t::actionName);
     }
 
+    if (!register_action(options_ah_desc)
+        || !attach_action_to_menu(
+                "Options/General...",
+                options_ah_t::actionName,
+                SETMENU_APP))
+    {
+        ERROR_MSG("Failed to register: " << options_ah_t::actionName);
+    }
+
+    if (!register_action(exportTrace_ah_desc)
+        || !attach_action_to_menu(
+                "File/Produce file/Create DIF file",
+                exportTrace_ah_t::actionName,
+                SETMENU_APP))
+    {
+        ERROR_MSG("Failed to register: " << exportTrace_ah_t::actionName);
+    }
+
+    register_action(batchDecompilation_ah_desc);
     register_action(jump2asm_ah_desc);
     register_action(copy2asm_ah_desc);
     register_action(funcComment_ah_desc);
@@ -105,10 +152,13 @@ RetDec::RetDec()
     register_action(openCalls_ah_desc);
     register_action(openXrefs_ah_desc);
     register_action(changeFuncType_ah_desc);
+    register_action(cancelDecompilation_ah_desc);
+    register_action(pinViewer_ah_desc);
 
     retdec_place_t::registerPlace(PLUGIN);
 
     hook_to_notification_point(HT_UI, retdec_ui_hook_callback, this);
+    hook_to_notification_point(HT_IDB, retdec_idb_hook_callback, this);
 
     INFO_MSG(pluginName << " version " << pluginVersion << " loaded OK\n");
     INFO_MSG("Mod, build for IDA 7.2 -> 7.4 by HTC - VinCSS (a member of Vingroup)\n");
@@ -116,8 +166,15 @@ RetDec::RetDec()
 
 RetDec::~RetDec()
 {
+    unhook_from_notification_point(HT_IDB, retdec_idb_hook_callback, this);
     unhook_from_notification_point(HT_UI, retdec_ui_hook_callback, this);
 
+    decompiler.cancelAll();
+    // Kills the running decompilations - the decompiler does not wait for them.
+    getWorkerPool().stop();
+
+    unregister_action(pinViewer_ah_desc.name);
+    unregister_action(cancelDecompilation_ah_desc.name);
     unregister_action(changeFuncType_ah_desc.name);
     unregister_action(openXrefs_ah_desc.name);
     unregister_action(openCalls_ah_desc.name);
@@ -125,41 +182,46 @@ RetDec::~RetDec()
     unregister_action(funcComment_ah_desc.name);
     unregister_action(copy2asm_ah_desc.name);
     unregister_action(jump2asm_ah_desc.name);
+    unregister_action(batchDecompilation_ah_desc.name);
 
+    unregister_action(exportTrace_ah_desc.name);
+    unregister_action(options_ah_desc.name);
     unregister_action(fullDecompilation_ah_desc.name);
 }
 
-bool runDecompilation(retdec::config::Config& config, std::string* output = nullptr)
+/**
+ * Returns \c true (and warns the user) if selective decompilations are not
+ * possible.
+ */
+bool cannotDecompileSelectively()
 {
-    try
+    if (locateInputFile())
     {
-        auto rc = retdec::decompile(config, output);
-        if (rc != 0)
-        {
-            throw std::runtime_error("decompilation error code = " + std::to_string(rc));
-        }
+        WARNING_GUI("Cannot decompile - there is no input file.");
+        return true;
     }
-    catch (const std::runtime_error& e)
+    if (warnUndecompilableInput())
     {
-        WARNING_GUI("Decompilation exception: " << e.what() << std::endl);
         return true;
     }
-    catch (...)
+    if (isRelocatable() && inf.min_ea != 0)
     {
-        WARNING_GUI("Decompilation exception: unknown" << std::endl);
+        WARNING_GUI("RetDec plugin can selectively decompile only "
+                    "relocatable objects loaded at 0x0.\n"
+                    "Rebase the program to 0x0 or use full decompilation.");
         return true;
     }
-
     return false;
 }
 
-Function* RetDec::selectiveDecompilation(ea_t ea, bool redecompile, bool regressionTests)
+/**
+ * Function to decompile at the given address.
+ * Returns \c nullptr (and warns the user) if there is nothing to decompile.
+ */
+func_t* getFunctionToDecompile(ea_t ea)
 {
-    if (isRelocatable() && inf.min_ea != 0)
+    if (cannotDecompileSelectively())
     {
-        WARNING_GUI("RetDec plugin can selectively decompile only "
-                    "relocatable objects loaded at 0x0.\n"
-                    "Rebase the program to 0x0 or use full decompilation.");
         return nullptr;
     }
 
@@ -170,42 +232,154 @@ Function* RetDec::selectiveDecompilation(ea_t ea, bool redecompile, bool regress
         return nullptr;
     }
 
+    return f;
+}
+
+/**
+ * Returns \c true if selective decompilations are not possible. The same as
+ * cannotDecompileSelectively(), but silent and it never asks the user to
+ * locate the input file - for decompilations the user did not ask for
+ * (lazy, synced, prefetch).
+ */
+bool cannotDecompileInBackground()
+{
+    auto& profile = getBinaryProfile();
+    return profile.inputPath.empty()
+            || !profile.decompilable
+            || (profile.relocatable && inf.min_ea != 0);
+}
+
+/**
+ * Function to decompile at the given address, if decompilation is possible.
+ * The same as getFunctionToDecompile(), but silent, see
+ * cannotDecompileInBackground().
+ */
+func_t* findFunctionToDecompile(ea_t ea)
+{
+    if (cannotDecompileInBackground())
+    {
+        return nullptr;
+    }
+    return get_func(ea);
+}
+
+/**
+ * Name of a trace run working on the function at the given address.
+ */
+std::string traceRunName(const std::string& what, ea_t ea)
+{
+    qstring qFncName;
+    get_func_name(&qFncName, ea);
+    return what + " " + qFncName.c_str();
+}
+
+/**
+ * Create a config for the selective decompilation of the given functions.
+ * It has only the config entries the functions need, not the whole program.
+ * @param refs Objects referenced from the functions, see getCacheKey().
+ * Returns \c true if something went wrong.
+ */
+bool createSelectiveConfig(
+        const std::vector<func_t*>& fncs,
+        const std::vector<ea_t>& refs,
+        retdec::config::Config& cfg)
+{
+    std::vector<ea_t> eas = refs;
+    for (func_t* f : fncs)
+    {
+        eas.push_back(f->start_ea);
+    }
+    if (fillSelectiveConfig(cfg, eas))
+    {
+        return true;
+    }
+
+    cfg.parameters.setOutputFormat("json");
+    for (func_t* f : fncs)
+    {
+        retdec::common::AddressRange r(f->start_ea, f->end_ea);
+        cfg.parameters.selectedRanges.insert(r);
+    }
+    cfg.parameters.setIsSelectedDecodeOnly(true);
+
+    return false;
+}
+
+/**
+ * Function from the persistent decompilation cache.
+ * Returns \c nullptr if it is not cached.
+ */
+Function* loadCachedFunction(func_t* f, const std::string& key)
+{
+    std::string output;
+    if (!loadCachedOutput(f, key, output))
+    {
+        return nullptr;
+    }
+
+    auto ts = parseTokens(output, f->start_ea);
+    if (ts.empty())
+    {
+        return nullptr;
+    }
+    return RetDec::fnc2fnc.put(f->start_ea, Function(f, ts));
+}
+
+Function* RetDec::selectiveDecompilation(ea_t ea, bool redecompile, bool regressionTests)
+{
+    func_t* f = getFunctionToDecompile(ea);
+    if (f == nullptr)
+    {
+        return nullptr;
+    }
+
     if (!redecompile)
     {
-        auto it = fnc2fnc.find(f);
-        if (it != fnc2fnc.end())
+        // Placeholder of a running decompilation is good enough, it gets
+        // replaced in place when the decompilation finishes.
+        auto* fnc = fnc2fnc.get(f->start_ea);
+        if (fnc
+                && (!fnc->isPlaceholder()
+                || (g_pRetDec && g_pRetDec->decompiler.isPending(f->start_ea))))
+        {
+            return fnc;
+        }
+    }
+
+    TraceRun traceRun(traceRunName("selective decompilation", f->start_ea));
+    std::vector<ea_t> refs;
+    auto key = getCacheKey(f, &refs);
+    if (!redecompile && !regressionTests)
+    {
+        if (auto* fnc = loadCachedFunction(f, key))
         {
-            return &it->second;
+            return fnc;
         }
     }
 
-    if (fillConfig(config))
+    retdec::config::Config cfg;
+    if (createSelectiveConfig({f}, refs, cfg))
     {
         return nullptr;
     }
 
-    std::set<ea_t> selectedFncs;
     std::string output;
     std::string* out = &output;
 
-    config.parameters.setOutputFormat("json");
-    retdec::common::AddressRange r(f->start_ea, f->end_ea);
-    config.parameters.selectedRanges.insert(r);
-    selectedFncs.insert(f->start_ea);
-    config.parameters.setIsSelectedDecodeOnly(true);
-
     if (regressionTests)
     {
-        config.parameters.setIsVerboseOutput(true);
-        config.parameters.setOutputFormat("plain");
-        config.parameters.setOutputFile(config.parameters.getInputFile() + ".c");
+        cfg.parameters.setIsVerboseOutput(true);
+        cfg.parameters.setOutputFormat("plain");
+        cfg.parameters.setOutputFile(cfg.parameters.getInputFile() + ".c");
         out = nullptr;
     }
 
+    std::string error;
     show_wait_box("Decompiling...");
-    if (runDecompilation(config, out))
+    if (runDecompilation(cfg, out, &error))
     {
         hide_wait_box();
+        WARNING_GUI(error << std::endl);
         return nullptr;
     }
     hide_wait_box();
@@ -220,238 +394,1237 @@ Function* RetDec::selectiveDecompilation(ea_t ea, bool redecompile, bool regress
     {
         return nullptr;
     }
-    return &(fnc2fnc[f] = Function(f, ts));
+    storeCachedOutput(f, key, output);
+    return fnc2fnc.put(f->start_ea, Function(f, ts));
 }
 
 Function* RetDec::selectiveDecompilationAndDisplay(ea_t ea, bool redecompile)
 {
-    auto* f = selectiveDecompilation(ea, redecompile);
-    if (f)
+    func_t* f = getFunctionToDecompile(ea);
+    if (f == nullptr)
     {
-        displayFunction(f, ea);
+        return nullptr;
     }
-    return f;
-}
-
-void RetDec::displayFunction(Function* f, ea_t ea)
-{
-    m_pFunction = f;
-
-    retdec_place_t min(m_pFunction, m_pFunction->min_yx());
-    retdec_place_t max(m_pFunction, m_pFunction->max_yx());
-    retdec_place_t cur(m_pFunction, m_pFunction->ea_2_yx(ea));
 
-    TWidget* widget = find_widget(RetDec::pluginName.c_str());
-    if (widget != nullptr)
+    if (!redecompile)
     {
-        set_custom_viewer_range(custViewer, &min, &max);
-        jumpto(custViewer, &cur, cur.x(), cur.y());
-        bool take_focus = true;
-        activate_widget(custViewer, take_focus);
-        return;
+        auto* fnc = fnc2fnc.get(f->start_ea);
+        if (fnc && (!fnc->isPlaceholder() || decompiler.isPending(f->start_ea)))
+        {
+            displayFunction(fnc, ea);
+            return fnc;
+        }
     }
 
-    // Without setting both x and y in render info, the current line gets
-    // displayed as the first line in the viewer. Which is not nice because we
-    // don't see the context before it. It is better if it is somewhere in the
-    // middle of the viewer.
-    renderer_info_t rinfo;
-    rinfo.rtype = TCCRT_FLAT;
-    rinfo.pos.cx = cur.x();
-    rinfo.pos.cy = cur.y();
-
-    custViewer = create_custom_viewer(RetDec::pluginName.c_str(),   // title
-                                      &min,                         // minplace
-                                      &max,                         // maxplace
-                                      &cur,                         // curplace
-                                      &rinfo,                       // rinfo
-                                      this,                         // ud
-                                      &ui_handlers,                 // handlers
-                                      this,                         // cvhandlers_ud
-                                      nullptr);                     // parent widget
-    set_view_renderer_type(custViewer, TCCRT_FLAT);
-
-    codeViewer = create_code_viewer(custViewer);
-    set_code_viewer_is_source(codeViewer);
+    TraceRun traceRun(traceRunName("selective decompilation", f->start_ea));
+    std::vector<ea_t> refs;
+    auto key = getCacheKey(f, &refs);
+    if (!redecompile)
+    {
+        if (auto* fnc = loadCachedFunction(f, key))
+        {
+            decompiler.cancel(f->start_ea);
+            displayFunction(fnc, ea);
+            return fnc;
+        }
+    }
 
-#if IDA_SDK_VERSION <= 720
-    ui_notification_t ui_code = ui_display_widget;
-    ui_notification_t delta = (ui_notification_t) 117;
-#else
-    ui_notification_t ui_code = ui_obsolete_display_widget;
-    ui_notification_t delta = ui_display_widget - ui_obsolete_display_widget;
-#endif
+    // Show placeholder right away, decompile in the background.
+    auto* fnc = backgroundDecompilation(f, ea, key, refs);
+    if (fnc == nullptr)
+    {
+        return nullptr;
+    }
+    displayFunction(fnc, ea);
 
-    ida_version_t ida_ver = getIDAVersion();
-    if (ida_ver <= ida_72)
-        callui(ui_code, codeViewer, WOPN_TAB);
-    else
-        callui((ui_notification_t) (ui_code + delta), codeViewer, WOPN_DP_RIGHT, "IDA View-A");
-    return;
+    return fnc;
 }
 
-bool RetDec::fullDecompilation()
+Function* RetDec::lazyDecompilation(ea_t ea)
 {
-    std::string defaultOut = getInputPath() + ".c";
-
-    char *tmp = ask_file(                // Returns: file name
-            true,                        // bool for_saving
-            defaultOut.data(),           // const char *default_answer
-            "%s",                        // const char *format
-            "Save decompiled file");
-    if (tmp == nullptr) // canceled
+    // Restored places are resolved while IDA renders them - no warnings.
+    func_t* f = findFunctionToDecompile(ea);
+    if (f == nullptr)
     {
-        return false;
+        return nullptr;
     }
-    std::string out = tmp;
-
-    INFO_MSG("Selected file: " << out << "\n");
 
-    if (fillConfig(config, out))
+    if (auto* fnc = fnc2fnc.get(f->start_ea))
     {
-        return false;
+        return fnc;
     }
-    config.parameters.setOutputFormat("c");
 
-    show_wait_box("Decompiling...");
-    runDecompilation(config);
-    hide_wait_box();
+    TraceRun traceRun(traceRunName("lazy decompilation", f->start_ea), true);
+    std::vector<ea_t> refs;
+    auto key = getCacheKey(f, &refs);
+    if (auto* fnc = loadCachedFunction(f, key))
+    {
+        return fnc;
+    }
 
-    return true;
+    if (g_pRetDec == nullptr)
+    {
+        return nullptr;
+    }
+    return g_pRetDec->backgroundDecompilation(f, f->start_ea, key, refs);
 }
 
-bool idaapi RetDec::run(size_t arg)
+Function* RetDec::syncedDecompilation(ea_t ea, Function* current)
 {
-    if (!auto_is_ok())
+    if (g_pRetDec == nullptr)
     {
-        INFO_MSG("RetDec plugin cannot run because the initial autoanalysis has not been finished.\n");
-        return false;
+        return nullptr;
     }
+    auto& plg = *g_pRetDec;
 
-    // ordinary selective decompilation
-    //
-    if (arg == 0)
+    if (current && current->ea_inside(ea))
     {
-        auto* cv = get_current_viewer();
-        bool redecompile = cv == custViewer || cv == codeViewer;
-        return selectiveDecompilationAndDisplay(get_screen_ea(), redecompile);
+        plg.m_syncEa = BADADDR;
+        return current;
     }
-    // ordinary full decompilation
-    //
-    else if (arg == 1)
+    if (settings.syncPolicy == Settings::SYNC_OFF)
     {
-        return fullDecompilation();
+        return nullptr;
     }
-    // regression tests selective decompilation
-    // function to decompile is marked by "<retdec_select>" string in comment
-    //
-    else if (arg == 2)
-    {
-        for (unsigned i = 0; i < get_func_qty(); ++i)
-        {
-            qstring qCmt;
-            func_t *fnc = getn_func(i);
-            if (get_func_cmt(&qCmt, fnc, false) <= 0)
-            {
-                continue;
-            }
 
-            std::string cmt = qCmt.c_str();;
-            if (cmt.find("<retdec_select>") != std::string::npos)
-            {
-                auto r = selectiveDecompilation(fnc->start_ea,
-                                                false, // redecompile
-                                                true); // regressionTests
-                return r;
-            }
-        }
-        return true;
+    // No warnings - the user is just moving around the disassembly.
+    func_t* f = findFunctionToDecompile(ea);
+    if (f == nullptr)
+    {
+        plg.m_syncEa = BADADDR;
+        return nullptr;
     }
-    // regression tests full decompilation
-    //
-    else if (arg == 3)
+
+    // Placeholder of a running decompilation gets replaced when the
+    // decompilation finishes - keep the viewer where it is until then.
+    auto* fnc = fnc2fnc.get(f->start_ea);
+    if (fnc && !(fnc->isPlaceholder() && plg.decompiler.isPending(f->start_ea)))
     {
-        return fullDecompilation();
+        plg.m_syncEa = BADADDR;
+        return fnc;
     }
-    else
+    plg.m_syncEa = ea;
+    if (fnc)
     {
-        WARNING_GUI(pluginName << " version " << pluginVersion << " cannot handle argument '" << arg << "'.\n");
-        return false;
+        return nullptr;
     }
 
-    return true;
-}
+    // The function is already being decompiled, or it was not in the
+    // persistent cache (or its config failed) a moment ago - nothing to do
+    // until the disassembly moves to another function.
+    if (plg.m_syncJob == f->start_ea || plg.m_syncProbe == f->start_ea)
+    {
+        return nullptr;
+    }
+    plg.m_syncProbe = f->start_ea;
 
-void RetDec::modifyFunctions(Token::Kind k, const std::string& oldVal, const std::string& newVal)
-{
-    for (auto& p : fnc2fnc)
+    std::vector<ea_t> refs;
+    auto key = getCacheKey(f, &refs);
+    if (auto* cached = loadCachedFunction(f, key))
     {
-        modifyFunction(p.first, k, oldVal, newVal);
+        plg.m_syncEa = BADADDR;
+        return cached;
     }
-}
 
-void RetDec::modifyFunction(func_t* f, Token::Kind k, const std::string& oldVal, const std::string& newVal)
-{
-    auto fIt = fnc2fnc.find(f);
-    if (fIt == fnc2fnc.end())
+    if (settings.syncPolicy != Settings::SYNC_EAGER)
     {
-        return;
+        return nullptr;
     }
-    Function& F = fIt->second;
 
-    std::vector<Token> newTokens;
+    // Only the function the disassembly is in is worth decompiling, not all
+    // the functions it went through.
+    if (plg.m_syncJob != BADADDR)
+    {
+        plg.decompiler.cancel(plg.m_syncJob);
+        plg.m_syncJob = BADADDR;
+    }
 
-    for (auto& t : F.getTokens())
+    TraceRun traceRun(traceRunName("synced decompilation", f->start_ea), true);
+    retdec::config::Config cfg;
+    if (createSelectiveConfig({f}, refs, cfg))
     {
-        if (t.second.kind == k && t.second.value == oldVal)
-        {
-            newTokens.emplace_back(Token(k, t.second.ea, newVal));
-        }
-        else
-        {
-            newTokens.emplace_back(t.second);
-        }
+        return nullptr;
     }
 
-    fIt->second = Function(f, newTokens);
+    // No placeholder, the viewer keeps displaying the current function.
+    plg.decompiler.submit(
+            f->start_ea,
+            std::move(cfg),
+            [&plg, ea, key](DecompilationJob& job)
+            {
+                plg.selectiveDecompilationDone(job, ea, key);
+            });
+    plg.m_syncJob = f->start_ea;
+
+    return nullptr;
 }
 
-ea_t RetDec::getFunctionEa(const std::string& name)
+Function* RetDec::backgroundDecompilation(
+        func_t* f,
+        ea_t ea,
+        const std::string& key,
+        const std::vector<ea_t>& refs)
 {
-    // Use config.
-    auto* f = config.functions.getFunctionByName(name);
-    if (f && f->getStart().isDefined())
+    retdec::config::Config cfg;
+    if (createSelectiveConfig({f}, refs, cfg))
     {
-        return f->getStart();
+        return nullptr;
     }
 
-    // Use IDA.
-    for (unsigned i = 0; i < get_func_qty(); ++i)
+    // The job replaces the synced one, which must not be cancelled anymore.
+    if (m_syncJob == f->start_ea)
     {
-        func_t* f = getn_func(i);
-        qstring qFncName;
-        get_func_name(&qFncName, f->start_ea);
-        if (qFncName.c_str() == name)
-        {
-            return f->start_ea;
-        }
+        m_syncJob = BADADDR;
     }
 
-    return BADADDR;
-}
+    qstring qFncName;
+    get_func_name(&qFncName, f->start_ea);
 
-func_t* RetDec::getIdaFunction(const std::string& name)
-{
-    auto ea = getFunctionEa(name);
-    return ea != BADADDR ? get_func(ea) : nullptr;
+    auto* fnc = fnc2fnc.put(f->start_ea, Function::placeholder(
+            f,
+            std::string("Decompiling ") + qFncName.c_str() + "..."));
+    refreshPinnedViewers(f->start_ea);
+
+    decompiler.submit(
+            f->start_ea,
+            std::move(cfg),
+            [this, ea, key](DecompilationJob& job)
+            {
+                selectiveDecompilationDone(job, ea, key);
+            });
+
+    return fnc;
 }
 
-ea_t RetDec::getGlobalVarEa(const std::string& name)
+bool RetDec::batchDecompilation(const std::vector<func_t*>& fncs, bool redecompile)
 {
-    auto* g = config.globals.getObjectByName(name);
-    if (g && g->getStorage().getAddress())
+    if (g_pRetDec == nullptr || fncs.empty() || cannotDecompileSelectively())
     {
-        return g->getStorage().getAddress();
+        return true;
     }
-    return BADADDR;
+    auto& plg = *g_pRetDec;
+
+    TraceRun traceRun("batch decompilation of " + std::to_string(fncs.size()) + " functions");
+
+    // Only the functions which are not decompiled yet.
+    std::vector<func_t*> batch;
+    std::map<ea_t, std::string> keys;
+    std::vector<ea_t> refs;
+    for (func_t* f : fncs)
+    {
+        if (keys.count(f->start_ea))
+        {
+            continue;
+        }
+        if (!redecompile)
+        {
+            auto* fnc = fnc2fnc.get(f->start_ea);
+            if (fnc && !fnc->isPlaceholder())
+            {
+                continue;
+            }
+        }
+
+        std::vector<ea_t> fncRefs;
+        auto key = getCacheKey(f, &fncRefs);
+        if (!redecompile && loadCachedFunction(f, key))
+        {
+            continue;
+        }
+        keys[f->start_ea] = key;
+        batch.push_back(f);
+        refs.insert(refs.end(), fncRefs.begin(), fncRefs.end());
+    }
+    if (batch.empty())
+    {
+        return false;
+    }
+
+    retdec::config::Config cfg;
+    if (createSelectiveConfig(batch, refs, cfg))
+    {
+        return true;
+    }
+
+    // Placeholders until the whole batch is decompiled in the background.
+    std::vector<ea_t> eas;
+    for (func_t* f : batch)
+    {
+        qstring qFncName;
+        get_func_name(&qFncName, f->start_ea);
+        fnc2fnc.put(f->start_ea, Function::placeholder(
+                f,
+                std::string("Decompiling ") + qFncName.c_str()
+                + " in a batch of " + std::to_string(batch.size()) + " functions..."));
+        plg.refreshPinnedViewers(f->start_ea);
+        eas.push_back(f->start_ea);
+    }
+
+    plg.decompiler.submitBatch(
+            eas,
+            std::move(cfg),
+            [&plg, keys](DecompilationJob& job)
+            {
+                plg.batchDecompilationDone(job, keys);
+            });
+
+    return false;
+}
+
+void RetDec::batchDecompilationDone(
+        DecompilationJob& job,
+        const std::map<ea_t, std::string>& keys)
+{
+    if (job.decompiles(m_syncJob))
+    {
+        m_syncJob = BADADDR;
+    }
+    if (job.decompiles(m_syncProbe))
+    {
+        m_syncProbe = BADADDR;
+    }
+
+    // Functions deleted in the meantime are skipped.
+    std::vector<func_t*> batch;
+    for (auto& p : keys)
+    {
+        func_t* f = get_func(p.first);
+        if (f && f->start_ea == p.first)
+        {
+            batch.push_back(f);
+        }
+    }
+
+    std::map<ea_t, std::vector<Token>> outputs;
+    if (job.error.empty())
+    {
+        outputs = splitBatchTokens(parseTokens(job.output, BADADDR), batch);
+    }
+    else
+    {
+        WARNING_MSG(job.error << std::endl);
+    }
+
+    std::size_t failed = 0;
+    for (func_t* f : batch)
+    {
+        Function* fnc = nullptr;
+        auto it = outputs.find(f->start_ea);
+        if (it == outputs.end())
+        {
+            qstring qFncName;
+            get_func_name(&qFncName, f->start_ea);
+            WARNING_MSG("Batch decompilation: no output for " << qFncName.c_str() << "\n");
+            fnc = fnc2fnc.put(f->start_ea, Function::placeholder(f, "Decompilation failed.\n" + job.error));
+            ++failed;
+        }
+        else
+        {
+            storeCachedOutput(f, keys.at(f->start_ea), serializeTokens(it->second));
+            fnc = fnc2fnc.put(f->start_ea, Function(f, it->second));
+        }
+
+        refreshPinnedViewers(f->start_ea);
+        if (custViewer == nullptr)
+        {
+            continue;
+        }
+        if (m_pFunction == fnc)
+        {
+            ea_t ea = get_screen_ea();
+            displayFunction(fnc, fnc->ea_inside(ea) ? ea : fnc->getStart());
+        }
+        else if (m_syncEa != BADADDR && fnc->ea_inside(m_syncEa))
+        {
+            ea_t syncEa = m_syncEa;
+            m_syncEa = BADADDR;
+            displayFunction(fnc, syncEa, false);
+        }
+    }
+
+    INFO_MSG("Batch decompilation: " << batch.size() - failed << "/"
+            << batch.size() << " functions decompiled in one pass\n");
+}
+
+void RetDec::selectiveDecompilationDone(
+        DecompilationJob& job,
+        ea_t ea,
+        const std::string& key)
+{
+    if (m_syncJob == job.ea)
+    {
+        m_syncJob = BADADDR;
+    }
+    // The output may be in the persistent cache now.
+    if (m_syncProbe == job.ea)
+    {
+        m_syncProbe = BADADDR;
+    }
+
+    func_t* f = get_func(job.ea);
+    if (f == nullptr || f->start_ea != job.ea)
+    {
+        // Function was deleted in the meantime.
+        return;
+    }
+
+    Function* fnc = nullptr;
+    if (!job.error.empty())
+    {
+        WARNING_MSG(job.error << std::endl);
+        fnc = fnc2fnc.put(f->start_ea, Function::placeholder(f, "Decompilation failed.\n" + job.error));
+    }
+    else
+    {
+        auto ts = parseTokens(job.output, f->start_ea);
+        if (ts.empty())
+        {
+            fnc = fnc2fnc.put(f->start_ea, Function::placeholder(f, "Decompilation failed."));
+        }
+        else
+        {
+            storeCachedOutput(f, key, job.output);
+            fnc = fnc2fnc.put(f->start_ea, Function(f, ts));
+        }
+    }
+
+    refreshPinnedViewers(f->start_ea);
+
+    // Update the viewer only if it is still waiting for this function,
+    // or if the synced disassembly is still in it.
+    if (custViewer == nullptr)
+    {
+        return;
+    }
+    if (m_pFunction == fnc)
+    {
+        displayFunction(fnc, ea);
+    }
+    else if (m_syncEa != BADADDR && fnc->ea_inside(m_syncEa))
+    {
+        ea_t syncEa = m_syncEa;
+        m_syncEa = BADADDR;
+        displayFunction(fnc, syncEa, false);
+    }
+}
+
+void RetDec::cancelDecompilation(Function* fnc)
+{
+    if (fnc == nullptr || fnc->get_func_t() == nullptr)
+    {
+        return;
+    }
+
+    // All the functions of a batch are cancelled with it.
+    auto eas = decompiler.pendingWith(fnc->getStart());
+    if (eas.empty())
+    {
+        return;
+    }
+    decompiler.cancel(fnc->getStart());
+
+    for (ea_t ea : eas)
+    {
+        if (m_syncJob == ea)
+        {
+            m_syncJob = BADADDR;
+        }
+
+        func_t* f = get_func(ea);
+        auto* cached = fnc2fnc.peek(ea);
+        if (f == nullptr || f->start_ea != ea || !cached || !cached->isPlaceholder())
+        {
+            continue;
+        }
+
+        bool displayed = m_pFunction == cached;
+        cached = fnc2fnc.put(ea, Function::placeholder(f, "Decompilation cancelled."));
+        if (displayed)
+        {
+            displayFunction(cached, ea);
+        }
+        refreshPinnedViewers(ea);
+    }
+}
+
+/**
+ * Create a viewer (custom viewer wrapped in a code viewer) displaying @p fnc
+ * at @p cur, and display it docked to the widget @p dest.
+ * Returns the custom viewer, @p codeViewer is set to the code viewer.
+ */
+TWidget* createViewer(
+        RetDec* plg,
+        const std::string& title,
+        Function* fnc,
+        const retdec_place_t& cur,
+        int dock,
+        const char* dest,
+        TWidget*& codeViewer)
+{
+    retdec_place_t min(fnc, fnc->min_yx());
+    retdec_place_t max(fnc, fnc->max_yx());
+
+    // Without setting both x and y in render info, the current line gets
+    // displayed as the first line in the viewer. Which is not nice because we
+    // don't see the context before it. It is better if it is somewhere in the
+    // middle of the viewer.
+    renderer_info_t rinfo;
+    rinfo.rtype = TCCRT_FLAT;
+    rinfo.pos.cx = cur.x();
+    rinfo.pos.cy = cur.y();
+
+    auto* custViewer = create_custom_viewer(title.c_str(),      // title
+                                            &min,               // minplace
+                                            &max,               // maxplace
+                                            &cur,               // curplace
+                                            &rinfo,             // rinfo
+                                            plg,                // ud
+                                            &ui_handlers,       // handlers
+                                            plg,                // cvhandlers_ud
+                                            nullptr);           // parent widget
+    set_view_renderer_type(custViewer, TCCRT_FLAT);
+
+    codeViewer = create_code_viewer(custViewer);
+    set_code_viewer_is_source(codeViewer);
+
+#if IDA_SDK_VERSION <= 720
+    ui_notification_t ui_code = ui_display_widget;
+    ui_notification_t delta = (ui_notification_t) 117;
+#else
+    ui_notification_t ui_code = ui_obsolete_display_widget;
+    ui_notification_t delta = ui_display_widget - ui_obsolete_display_widget;
+#endif
+
+    ida_version_t ida_ver = getIDAVersion();
+    if (ida_ver <= ida_72)
+        callui(ui_code, codeViewer, WOPN_TAB);
+    else
+        callui((ui_notification_t) (ui_code + delta), codeViewer, dock, dest);
+
+    return custViewer;
+}
+
+void RetDec::displayFunction(Function* f, ea_t ea, bool activate)
+{
+    m_pFunction = f;
+    fnc2fnc.pin(f->getStart());
+
+    retdec_place_t min(m_pFunction, m_pFunction->min_yx());
+    retdec_place_t max(m_pFunction, m_pFunction->max_yx());
+    retdec_place_t cur(m_pFunction, m_pFunction->ea_2_yx(ea));
+    // The function may be the same object with new contents (redecompiled),
+    // so the viewer's location need not change.
+    updateSyncedEas(m_pFunction, cur.yx());
+
+    TWidget* widget = find_widget(RetDec::pluginName.c_str());
+    if (widget != nullptr)
+    {
+        set_custom_viewer_range(custViewer, &min, &max);
+        jumpto(custViewer, &cur, cur.x(), cur.y());
+        if (activate)
+        {
+            bool take_focus = true;
+            activate_widget(custViewer, take_focus);
+        }
+        prefetch(f);
+        return;
+    }
+
+    custViewer = createViewer(
+            this,
+            RetDec::pluginName,
+            m_pFunction,
+            cur,
+            WOPN_DP_RIGHT,
+            "IDA View-A",
+            codeViewer);
+    prefetch(f);
+    return;
+}
+
+void RetDec::pinViewer(Function* f, YX yx)
+{
+    for (auto& p : pinnedViewers)
+    {
+        if (p.second.fnc == f->getStart())
+        {
+            bool take_focus = true;
+            activate_widget(p.first, take_focus);
+            return;
+        }
+    }
+
+    // Titles must be unique, the function name may not be.
+    std::string title = pluginName + ": " + f->getName();
+    for (unsigned i = 2; find_widget(title.c_str()) != nullptr; ++i)
+    {
+        title = pluginName + ": " + f->getName() + " (" + std::to_string(i) + ")";
+    }
+
+    fnc2fnc.hold(f->getStart());
+
+    // The main viewer may be closed already.
+    bool main = find_widget(pluginName.c_str()) != nullptr;
+    PinnedViewer pv;
+    pv.fnc = f->getStart();
+    auto* cv = createViewer(
+            this,
+            title,
+            f,
+            retdec_place_t(f, yx),
+            main ? WOPN_DP_TAB : WOPN_DP_RIGHT,
+            main ? pluginName.c_str() : "IDA View-A",
+            pv.codeViewer);
+    pinnedViewers[cv] = pv;
+}
+
+void RetDec::refreshPinnedViewers(ea_t ea)
+{
+    auto* fnc = fnc2fnc.peek(ea);
+    if (fnc == nullptr)
+    {
+        return;
+    }
+
+    for (auto& p : pinnedViewers)
+    {
+        if (p.second.fnc != ea)
+        {
+            continue;
+        }
+        retdec_place_t min(fnc, fnc->min_yx());
+        retdec_place_t max(fnc, fnc->max_yx());
+        set_custom_viewer_range(p.first, &min, &max);
+        refresh_custom_viewer(p.first);
+    }
+}
+
+bool RetDec::isCustViewer(TWidget* w) const
+{
+    return w != nullptr && (w == custViewer || pinnedViewers.count(w));
+}
+
+bool RetDec::isViewer(TWidget* w) const
+{
+    if (w == nullptr)
+    {
+        return false;
+    }
+    if (w == custViewer || w == codeViewer)
+    {
+        return true;
+    }
+    return std::any_of(pinnedViewers.begin(), pinnedViewers.end(),
+            [w](const auto& p) { return p.first == w || p.second.codeViewer == w; });
+}
+
+std::map<TWidget*, RetDec::PinnedViewer>::iterator RetDec::findPinnedViewer(TWidget* w)
+{
+    auto it = pinnedViewers.find(w);
+    if (it != pinnedViewers.end())
+    {
+        return it;
+    }
+    return std::find_if(pinnedViewers.begin(), pinnedViewers.end(),
+            [w](const auto& p) { return p.second.codeViewer == w; });
+}
+
+void RetDec::updateSyncedEas(const Function* f, YX yx)
+{
+    // Assign keeps the capacity - no allocations once the vector is large
+    // enough for the longest line.
+    auto eas = f->yx_2_eas(yx);
+    syncedEas.assign(eas.begin(), eas.end());
+}
+
+/**
+ * Candidates for prefetching - functions called from the given function,
+ * in the order of appearance, and then the functions around it.
+ */
+std::vector<func_t*> getPrefetchCandidates(RetDec& plg, Function* fnc)
+{
+    std::vector<func_t*> ret;
+    std::set<ea_t> seen = {fnc->getStart()};
+
+    for (auto& t : fnc->getTokens(Token::Kind::ID_FNC))
+    {
+        func_t* f = plg.getIdaFunction(t.value);
+        if (f && seen.insert(f->start_ea).second)
+        {
+            ret.push_back(f);
+        }
+    }
+
+    int n = get_func_num(fnc->getStart());
+    int qty = int(get_func_qty());
+    int depth = int(RetDec::settings.prefetchDepth);
+    for (int d = 1; n >= 0 && d <= depth; ++d)
+    {
+        for (int i : {n + d, n - d})
+        {
+            func_t* f = (i >= 0 && i < qty) ? getn_func(i) : nullptr;
+            if (f && seen.insert(f->start_ea).second)
+            {
+                ret.push_back(f);
+            }
+        }
+    }
+
+    return ret;
+}
+
+/**
+ * At most this many times the prefetch depth candidates are examined
+ * (hashed) on each display, see RetDec::prefetch().
+ */
+static const unsigned prefetchExaminedFactor = 2;
+
+bool RetDec::prefetchBudgetExceeded() const
+{
+    return m_prefetchedBytes >= std::size_t(settings.prefetchBudgetMb) * 1024 * 1024;
+}
+
+void RetDec::prefetch(Function* fnc)
+{
+    decompiler.cancelPrefetch();
+
+    if (fnc == nullptr || fnc->isPlaceholder())
+    {
+        return;
+    }
+
+    // Displayed - no longer speculative. Evicted - no longer in memory.
+    for (auto pit = m_prefetched.begin(); pit != m_prefetched.end();)
+    {
+        if (pit->first == fnc->getStart() || !fnc2fnc.contains(pit->first))
+        {
+            m_prefetchedBytes -= pit->second;
+            pit = m_prefetched.erase(pit);
+        }
+        else
+        {
+            ++pit;
+        }
+    }
+
+    if (settings.prefetchDepth == 0 || cannotDecompileInBackground())
+    {
+        return;
+    }
+
+    // Candidates are hashed (and looked up in the persistent cache) on the
+    // main thread while the function is being displayed - only a few of
+    // them, however many functions it calls.
+    TraceRun traceRun(traceRunName("prefetch", fnc->getStart()), true);
+    unsigned queued = 0;
+    unsigned examined = 0;
+    for (func_t* f : getPrefetchCandidates(*this, fnc))
+    {
+        if (queued >= settings.prefetchDepth
+                || examined >= prefetchExaminedFactor * settings.prefetchDepth
+                || prefetchBudgetExceeded())
+        {
+            break;
+        }
+        if (fnc2fnc.contains(f->start_ea) || decompiler.isPending(f->start_ea))
+        {
+            continue;
+        }
+        ++examined;
+
+        // Cached functions are loaded quickly on demand.
+        std::string output;
+        std::vector<ea_t> refs;
+        auto key = getCacheKey(f, &refs);
+        if (loadCachedOutput(f, key, output))
+        {
+            continue;
+        }
+
+        retdec::config::Config cfg;
+        if (createSelectiveConfig({f}, refs, cfg))
+        {
+            return;
+        }
+
+        auto job = decompiler.prefetch(
+                f->start_ea,
+                std::move(cfg),
+                [this, key](DecompilationJob& job)
+                {
+                    prefetchDone(job, key);
+                });
+        if (job)
+        {
+            ++queued;
+        }
+    }
+}
+
+void RetDec::prefetchDone(DecompilationJob& job, const std::string& key)
+{
+    func_t* f = get_func(job.ea);
+    if (f == nullptr || f->start_ea != job.ea || !job.error.empty())
+    {
+        return;
+    }
+
+    auto ts = parseTokens(job.output, f->start_ea);
+    if (ts.empty())
+    {
+        return;
+    }
+    storeCachedOutput(f, key, job.output);
+
+    // Over the budget, it stays only in the persistent cache.
+    if (fnc2fnc.contains(f->start_ea) || prefetchBudgetExceeded())
+    {
+        return;
+    }
+    auto* fnc = fnc2fnc.put(f->start_ea, Function(f, ts));
+
+    std::size_t size = fnc->memorySize();
+    m_prefetched[f->start_ea] = size;
+    m_prefetchedBytes += size;
+}
+
+void RetDec::startWorkers()
+{
+    auto& pool = getWorkerPool();
+    pool.stop();
+    // In-process decompilations are serialized.
+    decompiler.setConcurrency(1);
+    if (settings.workerProcesses == 0)
+    {
+        return;
+    }
+
+    std::string path = getWorkerPath();
+    std::error_code ec;
+    if (!fs::exists(path, ec))
+    {
+        INFO_MSG("Decompilation worker " << path << " not found, "
+                "decompiling in the IDA process\n");
+        return;
+    }
+
+    if (pool.start(
+            path,
+            settings.workerProcesses,
+            settings.workerMemoryMb,
+            settings.workerTimeoutSeconds))
+    {
+        WARNING_MSG("Unable to start decompilation workers " << path
+                << ", decompiling in the IDA process\n");
+        return;
+    }
+    if (pool.size() < settings.workerProcesses)
+    {
+        WARNING_MSG("Only " << pool.size() << " of " << settings.workerProcesses
+                << " decompilation workers started\n");
+    }
+    decompiler.setConcurrency(pool.size());
+}
+
+/**
+ * Ask the user for the full decompilation settings.
+ * Returns \c false if cancelled.
+ */
+bool askFullDecompilationSettings()
+{
+    std::size_t cpus = std::max(1u, std::thread::hardware_concurrency());
+    if (RetDec::fullDecompilationWorkers == 0)
+    {
+        RetDec::fullDecompilationWorkers = cpus;
+    }
+    if (RetDec::fullDecompilationShards == 0)
+    {
+        RetDec::fullDecompilationShards = 4 * RetDec::fullDecompilationWorkers;
+    }
+
+    static const char form[] =
+            "Full decompilation\n"
+            "\n"
+            "<#Decompile the whole program at once.#~W~hole program:R>\n"
+            "<#Decompile address-range shards concurrently "
+            "and merge their outputs into one file.#~S~harded:R>>\n"
+            "\n"
+            "<~N~umber of shards:D:8:8::>\n"
+            "<Worker ~t~hreads  :D:8:8::>\n";
+
+    ushort mode = RetDec::fullDecompilationSharded ? 1 : 0;
+    sval_t shards = RetDec::fullDecompilationShards;
+    sval_t workers = RetDec::fullDecompilationWorkers;
+    if (ask_form(form, &mode, &shards, &workers) != 1)
+    {
+        return false;
+    }
+
+    RetDec::fullDecompilationSharded = mode == 1;
+    RetDec::fullDecompilationShards = std::max<sval_t>(1, shards);
+    RetDec::fullDecompilationWorkers = std::max<sval_t>(1, workers);
+    return true;
+}
+
+/**
+ * Decompile the program in address-range shards and merge the outputs
+ * into the given file.
+ */
+void shardedFullDecompilation(const std::string& out)
+{
+    TraceRun traceRun("sharded full decompilation");
+    if (fillConfig(RetDec::config))
+    {
+        return;
+    }
+
+    auto shards = createShards(RetDec::fullDecompilationShards);
+    if (shards.empty())
+    {
+        WARNING_GUI("There are no functions to decompile.\n");
+        return;
+    }
+
+    INFO_MSG("Decompiling " << shards.size() << " shards using "
+            << RetDec::fullDecompilationWorkers << " workers\n");
+
+    bool failed = decompileShards(
+            RetDec::config,
+            shards,
+            RetDec::fullDecompilationWorkers);
+
+    bool cancelled = std::any_of(shards.begin(), shards.end(),
+            [](const Shard& s) { return s.status == Shard::Status::QUEUED; });
+    if (cancelled)
+    {
+        return;
+    }
+
+    std::ofstream outFile(out, std::ios::binary);
+    outFile << mergeShards(shards);
+    if (!outFile)
+    {
+        WARNING_GUI("Unable to write the decompiled file: " << out << "\n");
+        return;
+    }
+
+    if (failed)
+    {
+        WARNING_GUI("Decompilation of some shards failed, "
+                    "see the output window for details.\n");
+    }
+}
+
+bool RetDec::fullDecompilation(bool regressionTests)
+{
+    if (locateInputFile())
+    {
+        WARNING_GUI("Cannot decompile - there is no input file.");
+        return false;
+    }
+    if (warnUndecompilableInput())
+    {
+        return false;
+    }
+
+    std::string defaultOut = getInputPath() + ".c";
+
+    char *tmp = ask_file(                // Returns: file name
+            true,                        // bool for_saving
+            defaultOut.data(),           // const char *default_answer
+            "%s",                        // const char *format
+            "Save decompiled file");
+    if (tmp == nullptr) // canceled
+    {
+        return false;
+    }
+    std::string out = tmp;
+
+    INFO_MSG("Selected file: " << out << "\n");
+
+    if (!regressionTests)
+    {
+        if (!askFullDecompilationSettings())
+        {
+            return false;
+        }
+        if (fullDecompilationSharded)
+        {
+            shardedFullDecompilation(out);
+            return true;
+        }
+    }
+
+    TraceRun traceRun("full decompilation");
+    if (fillConfig(config, out))
+    {
+        return false;
+    }
+    retdec::config::Config cfg = config;
+    cfg.parameters.setOutputFormat("c");
+
+    std::string error;
+    show_wait_box("Decompiling...");
+    bool failed = runDecompilation(cfg, nullptr, &error);
+    hide_wait_box();
+    if (failed)
+    {
+        WARNING_GUI(error << std::endl);
+    }
+
+    return true;
+}
+
+bool idaapi RetDec::run(size_t arg)
+{
+    if (!auto_is_ok())
+    {
+        INFO_MSG("RetDec plugin cannot run because the initial autoanalysis has not been finished.\n");
+        return false;
+    }
+
+    // ordinary selective decompilation
+    //
+    if (arg == 0)
+    {
+        auto* cv = get_current_viewer();
+        bool redecompile = isViewer(cv);
+        return selectiveDecompilationAndDisplay(get_screen_ea(), redecompile);
+    }
+    // ordinary full decompilation
+    //
+    else if (arg == 1)
+    {
+        return fullDecompilation();
+    }
+    // regression tests selective decompilation
+    // function to decompile is marked by "<retdec_select>" string in comment
+    //
+    else if (arg == 2)
+    {
+        for (unsigned i = 0; i < get_func_qty(); ++i)
+        {
+            qstring qCmt;
+            func_t *fnc = getn_func(i);
+            if (get_func_cmt(&qCmt, fnc, false) <= 0)
+            {
+                continue;
+            }
+
+            std::string cmt = qCmt.c_str();;
+            if (cmt.find("<retdec_select>") != std::string::npos)
+            {
+                auto r = selectiveDecompilation(fnc->start_ea,
+                                                false, // redecompile
+                                                true); // regressionTests
+                return r;
+            }
+        }
+        return true;
+    }
+    // regression tests full decompilation
+    //
+    else if (arg == 3)
+    {
+        return fullDecompilation(true);
+    }
+    else
+    {
+        WARNING_GUI(pluginName << " version " << pluginVersion << " cannot handle argument '" << arg << "'.\n");
+        return false;
+    }
+
+    return true;
+}
+
+void RetDec::modifyFunctions(Token::Kind k, const std::string& oldVal, const std::string& newVal)
+{
+    fnc2fnc.rename(k, oldVal, newVal);
+}
+
+ea_t RetDec::getFunctionEa(const std::string& name)
+{
+    // Names in the decompiled code are the ones in the config - the index
+    // has them too, and it is up to date even if the config is not filled.
+    ea_t ea = findFunctionByName(name);
+    if (ea != BADADDR)
+    {
+        return ea;
+    }
+
+    // Linked functions defined by data (e.g. imports).
+    return findGlobalByName(name);
+}
+
+func_t* RetDec::getIdaFunction(const std::string& name)
+{
+    auto ea = getFunctionEa(name);
+    return ea != BADADDR ? get_func(ea) : nullptr;
+}
+
+ea_t RetDec::getGlobalVarEa(const std::string& name)
+{
+    return findGlobalByName(name);
+}
+
+/**
+ * IDB change hook.
+ * Keeps the persistent decompilation config in sync with the database.
+ */
+ssize_t idaapi RetDec::on_idb_event(RetDec *prd, int code, va_list va)
+{
+    switch (code)
+    {
+        case idb_event::closebase:
+        {
+            invalidateBinaryProfile();
+            invalidateConfig();
+            invalidateNameIndex();
+            break;
+        }
+
+        case idb_event::loader_finished:
+        {
+            invalidateBinaryProfile();
+            invalidateConfig();
+            break;
+        }
+
+        case idb_event::renamed:
+        {
+            ea_t ea = va_arg(va, ea_t);
+            invalidateConfigFunction(ea);
+            invalidateConfigObject(ea);
+            invalidateNameIndex(ea);
+            break;
+        }
+
+        case idb_event::func_added:
+        case idb_event::func_updated:
+        case idb_event::deleting_func:
+        {
+            func_t* pfn = va_arg(va, func_t*);
+            if (pfn != nullptr)
+            {
+                invalidateConfigFunction(pfn->start_ea);
+                invalidateConfigObject(pfn->start_ea);
+                invalidateConfigCode(pfn->start_ea, pfn->end_ea);
+                invalidateNameIndex(pfn->start_ea);
+            }
+            break;
+        }
+
+        case idb_event::set_func_start:
+        {
+            func_t* pfn = va_arg(va, func_t*);
+            ea_t newStart = va_arg(va, ea_t);
+            if (pfn != nullptr)
+            {
+                invalidateConfigFunction(pfn->start_ea);
+                invalidateConfigObject(pfn->start_ea);
+                invalidateNameIndex(pfn->start_ea);
+                // Old and new range.
+                invalidateConfigCode(
+                        std::min(pfn->start_ea, newStart),
+                        pfn->end_ea);
+            }
+            invalidateConfigFunction(newStart);
+            invalidateConfigObject(newStart);
+            invalidateNameIndex(newStart);
+            break;
+        }
+
+        case idb_event::set_func_end:
+        {
+            func_t* pfn = va_arg(va, func_t*);
+            ea_t newEnd = va_arg(va, ea_t);
+            if (pfn != nullptr)
+            {
+                invalidateConfigFunction(pfn->start_ea);
+                // Old and new range.
+                invalidateConfigCode(
+                        pfn->start_ea,
+                        std::max(pfn->end_ea, newEnd));
+            }
+            break;
+        }
+
+        case idb_event::range_cmt_changed:
+        {
+            range_kind_t kind = range_kind_t(va_arg(va, int));
+            const range_t* a = va_arg(va, const range_t*);
+            if (kind == RANGE_KIND_FUNC && a != nullptr)
+            {
+                invalidateConfigFunction(a->start_ea);
+            }
+            break;
+        }
+
+        case idb_event::ti_changed:
+        {
+            ea_t ea = va_arg(va, ea_t);
+            invalidateConfigFunction(ea);
+            invalidateConfigObject(ea);
+            break;
+        }
+
+        case idb_event::make_code:
+        {
+            const insn_t* insn = va_arg(va, const insn_t*);
+            if (insn != nullptr)
+            {
+                invalidateConfigCode(insn->ea, insn->ea + insn->size);
+            }
+            break;
+        }
+
+        case idb_event::make_data:
+        {
+            ea_t ea = va_arg(va, ea_t);
+            flags_t flags = va_arg(va, flags_t);
+            tid_t tid = va_arg(va, tid_t);
+            asize_t len = va_arg(va, asize_t);
+            (void) flags;
+            (void) tid;
+            invalidateConfigObject(ea);
+            invalidateConfigCode(ea, ea + len);
+            break;
+        }
+
+        case idb_event::destroyed_items:
+        {
+            ea_t ea1 = va_arg(va, ea_t);
+            ea_t ea2 = va_arg(va, ea_t);
+            invalidateConfigObjects(ea1, ea2);
+            invalidateConfigCode(ea1, ea2);
+            break;
+        }
+
+        case idb_event::local_types_changed:
+        {
+            invalidateConfigTypes();
+            break;
+        }
+
+        case idb_event::segm_added:
+        case idb_event::segm_deleted:
+        case idb_event::segm_name_changed:
+        case idb_event::segm_start_changed:
+        case idb_event::segm_end_changed:
+        {
+            invalidateConfigGlobals();
+            break;
+        }
+
+        case idb_event::segm_moved:
+        case idb_event::allsegs_moved:
+        {
+            invalidateBinaryProfile();
+            invalidateConfig();
+            invalidateNameIndex();
+            break;
+        }
+    }
+
+    return 0;
 }
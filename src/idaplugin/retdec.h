@@ -12,7 +12,10 @@
 #include <retdec/utils/filesystem.h>
 #include <retdec/utils/time.h>
 
+#include "decompiler.h"
 #include "function.h"
+#include "functioncache.h"
+#include "settings.h"
 #include "ui.h"
 #include "utils.h"
 
@@ -24,11 +27,16 @@
     #define WOPN_DP_RIGHT           0x00040000
 #endif
 
+#ifndef WOPN_DP_TAB
+    #define WOPN_DP_TAB             0x00400000
+#endif
+
 #ifndef PCF_MAKEPLACE_ALLOCATES
     #define PCF_MAKEPLACE_ALLOCATES 0x00000002
 #endif
 
 ssize_t idaapi retdec_ui_hook_callback(void *user_data, int notification_code, va_list va);
+ssize_t idaapi retdec_idb_hook_callback(void *user_data, int notification_code, va_list va);
 
 /**
  * Plugin's global data.
@@ -41,6 +49,7 @@ public:
 
     bool idaapi run(size_t);
     static ssize_t idaapi on_event(RetDec *prd, int code, va_list va);
+    static ssize_t idaapi on_idb_event(RetDec *prd, int code, va_list va);
 
 public:
     // Plugin information.
@@ -65,19 +74,81 @@ public:
 public:
     // Decompilation.
     //
-    static bool fullDecompilation();
+    static bool fullDecompilation(bool regressionTests = false);
     static Function* selectiveDecompilation(ea_t ea, bool redecompile, bool regressionTests = false);
+    /// Decompile the given functions in one pass (see batch.h) in the
+    /// background and put them to the cache. Placeholders are displayed
+    /// until the batch finishes. Functions which are already decompiled (in
+    /// memory or in the persistent cache) are skipped unless @p redecompile
+    /// is set. Returns \c true if the batch could not be started.
+    static bool batchDecompilation(const std::vector<func_t*>& fncs, bool redecompile);
 
+    /// Display the function at @p ea. If it is not decompiled yet (or
+    /// @p redecompile is set), a placeholder is displayed and the function is
+    /// decompiled in the background.
     Function* selectiveDecompilationAndDisplay(ea_t ea, bool redecompile);
-    void displayFunction(Function* f, ea_t ea);
+    /// Get the function at @p ea without blocking - from memory or from the
+    /// persistent cache. Otherwise a placeholder is returned and the function
+    /// is decompiled in the background. Used to resolve restored places.
+    static Function* lazyDecompilation(ea_t ea);
+    /// Function to display when the disassembly synced with the viewer
+    /// moves to @p ea, never blocking and never warning the user. Returns
+    /// @p current if @p ea is inside it, a decompiled function, or
+    /// \c nullptr to keep the viewer where it is - see Settings::SyncPolicy.
+    /// A function decompiled in the background for the sync is displayed
+    /// when it is ready, if the disassembly is still in it.
+    static Function* syncedDecompilation(ea_t ea, Function* current);
+    /// Put a placeholder of @p f to the cache and decompile @p f in the
+    /// background.
+    /// @param key  Cache key of @p f.
+    /// @param refs Objects referenced from @p f, see getCacheKey().
+    Function* backgroundDecompilation(
+            func_t* f,
+            ea_t ea,
+            const std::string& key,
+            const std::vector<ea_t>& refs);
+    void selectiveDecompilationDone(
+            DecompilationJob& job,
+            ea_t ea,
+            const std::string& key);
+    /// Split the output of a batch decompilation, see batchDecompilation().
+    /// @param keys Cache keys of the batch functions.
+    void batchDecompilationDone(
+            DecompilationJob& job,
+            const std::map<ea_t, std::string>& keys);
+    /// Cancel the background decompilation of @p fnc - the function
+    /// displayed in the main or in a pinned viewer.
+    void cancelDecompilation(Function* fnc);
+    /// @param activate Activate the viewer (take the focus).
+    void displayFunction(Function* f, ea_t ea, bool activate = true);
+    /// Display @p f at @p yx in a new viewer pinned to it, next to the main
+    /// viewer - or activate the pinned viewer which displays it already.
+    void pinViewer(Function* f, YX yx);
+    /// Update the pinned viewers of the function starting at @p ea after it
+    /// was replaced (e.g. redecompiled).
+    void refreshPinnedViewers(ea_t ea);
+    /// Remember the addresses of the line with @p yx in @p f as the ones to
+    /// highlight in synced views, see syncedEas.
+    void updateSyncedEas(const Function* f, YX yx);
+
+    /// (Re)start the decompilation worker processes according to the
+    /// settings - decompilations run in-process if there are none. The
+    /// decompiler runs as many jobs in parallel as there are workers.
+    void startWorkers();
+
+    /// Speculatively decompile functions the user is likely to display
+    /// after the given one (callees and neighbours) in the background.
+    /// Nothing more is queued or kept in memory while the prefetched
+    /// functions exceed Settings::prefetchBudgetMb.
+    void prefetch(Function* fnc);
+    void prefetchDone(DecompilationJob& job, const std::string& key);
+    bool prefetchBudgetExceeded() const;
 
+    /// Rename tokens in all the functions in memory, see
+    /// FunctionCache::rename().
     void modifyFunctions(Token::Kind k,
                          const std::string& oldVal,
                          const std::string& newVal);
-    void modifyFunction(func_t* f,
-                        Token::Kind k,
-                        const std::string& oldVal,
-                        const std::string& newVal);
 
     ea_t getFunctionEa(const std::string& name);
     func_t* getIdaFunction(const std::string& name);
@@ -86,10 +157,41 @@ public:
     /// Currently displayed function.
     Function* m_pFunction = nullptr;
 
-    /// All the decompiled functions.
-    static std::map<func_t*, Function> fnc2fnc;
+    /// Decompiled functions in memory by their start addresses.
+    static FunctionCache fnc2fnc;
+
+    /// Background decompilations.
+    Decompiler decompiler;
+
+    /// Prefetched functions which were not displayed yet, with their sizes.
+    std::map<ea_t, std::size_t> m_prefetched;
+    std::size_t m_prefetchedBytes = 0;
+
+    /// Address the synced disassembly moved to, in a function which is not
+    /// decompiled yet - displayed when it is, see syncedDecompilation().
+    ea_t m_syncEa = BADADDR;
+    /// Function decompiled in the background for the synced disassembly.
+    ea_t m_syncJob = BADADDR;
+    /// Function the synced disassembly last looked up in the persistent
+    /// cache, so that a miss is not looked up again on each move.
+    ea_t m_syncProbe = BADADDR;
 
-    /// Decompilation config.
+    /// User settings.
+    inline static Settings settings;
+
+    /// Full decompilation settings - asked for on each full decompilation,
+    /// and remembered for the session.
+    inline static bool fullDecompilationSharded = false;
+    /// Number of address-range shards (0 = default, 4 per worker).
+    inline static std::size_t fullDecompilationShards = 0;
+    /// Number of worker threads (0 = default, number of CPUs).
+    inline static std::size_t fullDecompilationWorkers = 0;
+
+    /// Config of the whole program for full decompilations.
+    /// Persistent - only the objects changed since the last full
+    /// decompilation are updated in it, see fillConfig(). Full
+    /// decompilations run on its copies. Selective decompilations do not
+    /// use it, see fillSelectiveConfig().
     static retdec::config::Config config;
 
 public:
@@ -98,6 +200,30 @@ public:
     TWidget* custViewer = nullptr;
     TWidget* codeViewer = nullptr;
 
+    /// Viewer pinned to one function - the main viewer displays the
+    /// functions the user navigates to, a pinned one stays on its function.
+    /// It has its own location history, and its function is held in the
+    /// cache, so it is never re-decompiled nor re-rendered.
+    struct PinnedViewer
+    {
+        TWidget* codeViewer = nullptr;
+        /// Start of the displayed function.
+        ea_t fnc = BADADDR;
+    };
+    /// Pinned viewers by their custom viewers.
+    std::map<TWidget*, PinnedViewer> pinnedViewers;
+
+    /// Is @p w the main or a pinned custom viewer?
+    bool isCustViewer(TWidget* w) const;
+    /// Is @p w a custom or a code viewer of the main or a pinned viewer?
+    bool isViewer(TWidget* w) const;
+    /// Pinned viewer with the custom or code viewer @p w, or the end.
+    std::map<TWidget*, PinnedViewer>::iterator findPinnedViewer(TWidget* w);
+    /// Sorted addresses of the current line of the viewer - highlighted in
+    /// the synced disassembly on every repaint. Updated only when the cursor
+    /// moves to another line.
+    std::vector<ea_t> syncedEas;
+
     fullDecompilation_ah_t fullDecompilation_ah = fullDecompilation_ah_t(*this);
     const action_desc_t fullDecompilation_ah_desc = ACTION_DESC_LITERAL(
             fullDecompilation_ah_t::actionName,
@@ -107,6 +233,42 @@ public:
             nullptr,
             -1);
 
+    options_ah_t options_ah = options_ah_t(*this);
+    const action_desc_t options_ah_desc = ACTION_DESC_LITERAL(
+            options_ah_t::actionName,
+            options_ah_t::actionLabel,
+            &options_ah,
+            options_ah_t::actionHotkey,
+            nullptr,
+            -1);
+
+    exportTrace_ah_t exportTrace_ah = exportTrace_ah_t(*this);
+    const action_desc_t exportTrace_ah_desc = ACTION_DESC_LITERAL(
+            exportTrace_ah_t::actionName,
+            exportTrace_ah_t::actionLabel,
+            &exportTrace_ah,
+            exportTrace_ah_t::actionHotkey,
+            nullptr,
+            -1);
+
+    pinViewer_ah_t pinViewer_ah = pinViewer_ah_t(*this);
+    const action_desc_t pinViewer_ah_desc = ACTION_DESC_LITERAL(
+            pinViewer_ah_t::actionName,
+            pinViewer_ah_t::actionLabel,
+            &pinViewer_ah,
+            pinViewer_ah_t::actionHotkey,
+            nullptr,
+            -1);
+
+    batchDecompilation_ah_t batchDecompilation_ah = batchDecompilation_ah_t(*this);
+    const action_desc_t batchDecompilation_ah_desc = ACTION_DESC_LITERAL(
+            batchDecompilation_ah_t::actionName,
+            batchDecompilation_ah_t::actionLabel,
+            &batchDecompilation_ah,
+            batchDecompilation_ah_t::actionHotkey,
+            nullptr,
+            -1);
+
     jump2asm_ah_t jump2asm_ah = jump2asm_ah_t(*this);
     const action_desc_t jump2asm_ah_desc = ACTION_DESC_LITERAL(
             jump2asm_ah_t::actionName,
@@ -169,6 +331,15 @@ public:
             changeFuncType_ah_t::actionHotkey,
             nullptr,
             -1);
+
+    cancelDecompilation_ah_t cancelDecompilation_ah = cancelDecompilation_ah_t(*this);
+    const action_desc_t cancelDecompilation_ah_desc = ACTION_DESC_LITERAL(
+            cancelDecompilation_ah_t::actionName,
+            cancelDecompilation_ah_t::actionLabel,
+            &cancelDecompilation_ah,
+            cancelDecompilation_ah_t::actionHotkey,
+            nullptr,
+            -1);
 };
 
 #endif
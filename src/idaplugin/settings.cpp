@@ -0,0 +1,80 @@
+#include <registry.hpp>
+
+#include "settings.h"
+
+/**
+ * Registry subkey with the settings.
+ */
+static const char* settingsKey = "RetDec";
+
+void Settings::load()
+{
+    Settings d;
+    prefetchDepth = reg_read_int("PrefetchDepth", d.prefetchDepth, settingsKey);
+    prefetchBudgetMb = reg_read_int("PrefetchBudgetMb", d.prefetchBudgetMb, settingsKey);
+    cacheBudgetMb = reg_read_int("CacheBudgetMb", d.cacheBudgetMb, settingsKey);
+    syncPolicy = std::min<unsigned>(
+            reg_read_int("SyncPolicy", d.syncPolicy, settingsKey),
+            SYNC_EAGER);
+    workerProcesses = reg_read_int("WorkerProcesses", d.workerProcesses, settingsKey);
+    workerMemoryMb = reg_read_int("WorkerMemoryMb", d.workerMemoryMb, settingsKey);
+    workerTimeoutSeconds = reg_read_int("WorkerTimeoutSeconds", d.workerTimeoutSeconds, settingsKey);
+}
+
+void Settings::save() const
+{
+    reg_write_int("PrefetchDepth", prefetchDepth, settingsKey);
+    reg_write_int("PrefetchBudgetMb", prefetchBudgetMb, settingsKey);
+    reg_write_int("CacheBudgetMb", cacheBudgetMb, settingsKey);
+    reg_write_int("SyncPolicy", syncPolicy, settingsKey);
+    reg_write_int("WorkerProcesses", workerProcesses, settingsKey);
+    reg_write_int("WorkerMemoryMb", workerMemoryMb, settingsKey);
+    reg_write_int("WorkerTimeoutSeconds", workerTimeoutSeconds, settingsKey);
+}
+
+bool Settings::ask(const std::string& cacheStatistics)
+{
+    static const char form[] =
+            "RetDec options\n"
+            "\n"
+            "Prefetching - functions called from the displayed function and\n"
+            "its neighbours are decompiled in the background.\n"
+            "<#Maximal number of queued prefetches, 0 = off.#~P~refetch depth       :D:8:8::>\n"
+            "<#Prefetching stops when the functions prefetched but not displayed yet take more memory.#Prefetch ~m~emory (MB):D:8:8::>\n"
+            "\n"
+            "Decompiled functions in memory: %A\n"
+            "<#The least recently used functions are evicted when they take more memory, 0 = unlimited.#~F~unction cache (MB)  :D:8:8::>\n"
+            "\n"
+            "When the synchronized disassembly moves to another function:\n"
+            "<#The viewer stays in the displayed function.#S~t~ay in the displayed function:R>\n"
+            "<#Only functions which are already decompiled are displayed.#~O~nly decompiled functions:R>\n"
+            "<#Other functions are decompiled in the background, and displayed when they are ready.#~D~ecompile in the background:R>>\n"
+            "\n"
+            "Decompilations run in separate processes - a crash does not take down IDA.\n"
+            "<#Number of processes decompiling in parallel, 0 = decompile in the IDA process.#~W~orker processes    :D:8:8::>\n"
+            "<#A worker using more memory is killed, 0 = unlimited.#Worker m~e~mory (MB) :D:8:8::>\n"
+            "<#A decompilation running longer is killed, 0 = unlimited.#Time ~l~imit (s)      :D:8:8::>\n";
+
+    sval_t depth = prefetchDepth;
+    sval_t budget = prefetchBudgetMb;
+    sval_t cache = cacheBudgetMb;
+    ushort sync = ushort(syncPolicy);
+    sval_t workers = workerProcesses;
+    sval_t workerMemory = workerMemoryMb;
+    sval_t timeout = workerTimeoutSeconds;
+    if (ask_form(form, &depth, &budget, cacheStatistics.c_str(), &cache, &sync,
+            &workers, &workerMemory, &timeout) != 1)
+    {
+        return false;
+    }
+
+    prefetchDepth = std::max<sval_t>(0, depth);
+    prefetchBudgetMb = std::max<sval_t>(0, budget);
+    cacheBudgetMb = std::max<sval_t>(0, cache);
+    syncPolicy = std::min<unsigned>(sync, SYNC_EAGER);
+    workerProcesses = std::max<sval_t>(0, workers);
+    workerMemoryMb = std::max<sval_t>(0, workerMemory);
+    workerTimeoutSeconds = std::max<sval_t>(0, timeout);
+    save();
+    return true;
+}
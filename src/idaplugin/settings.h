@@ -0,0 +1,54 @@
+#ifndef RETDEC_SETTINGS_H
+#define RETDEC_SETTINGS_H
+
+#include "utils.h"
+
+/**
+ * User settings of the plugin.
+ * Persisted in the IDA registry, edited in the options form.
+ */
+struct Settings
+{
+    /// What the viewer does when the disassembly synced with it moves to
+    /// another function.
+    enum SyncPolicy : unsigned
+    {
+        /// Stay in the displayed function.
+        SYNC_OFF = 0,
+        /// Display the function only if it is already decompiled (in memory
+        /// or in the persistent cache).
+        SYNC_LAZY = 1,
+        /// Otherwise decompile it in the background, and display it when it
+        /// is ready.
+        SYNC_EAGER = 2,
+    };
+
+    /// Maximal number of speculative decompilations queued after a function
+    /// is displayed. 0 disables the prefetching.
+    unsigned prefetchDepth = 4;
+    /// Memory budget (MB) of prefetched functions which were not displayed
+    /// yet - nothing is prefetched while it is exceeded.
+    unsigned prefetchBudgetMb = 64;
+    /// Memory budget (MB) of decompiled functions kept in memory - the least
+    /// recently used ones are evicted when it is exceeded. 0 = unlimited.
+    unsigned cacheBudgetMb = 512;
+    /// See SyncPolicy.
+    unsigned syncPolicy = SYNC_EAGER;
+    /// Number of decompilation worker processes. 0 = decompile in the IDA
+    /// process.
+    unsigned workerProcesses = 2;
+    /// Memory limit (MB) of each worker process. 0 = unlimited.
+    unsigned workerMemoryMb = 4096;
+    /// Time limit (seconds) of each decompilation in a worker. 0 = unlimited.
+    unsigned workerTimeoutSeconds = 600;
+
+    /// Load the settings from the registry.
+    void load();
+    /// Save the settings to the registry.
+    void save() const;
+    /// Edit the settings in a form. Returns \c true if changed.
+    /// @param cacheStatistics Function cache statistics shown in the form.
+    bool ask(const std::string& cacheStatistics);
+};
+
+#endif
@@ -0,0 +1,367 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+
+#include "shards.h"
+#include "trace.h"
+
+//
+//==============================================================================
+// Sharding
+//==============================================================================
+//
+
+std::vector<Shard> createShards(std::size_t count)
+{
+    TRACE_SCOPE("createShards");
+    std::vector<Shard> shards;
+
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < get_func_qty(); ++i)
+    {
+        total += getn_func(i)->size();
+    }
+    if (total == 0 || count == 0)
+    {
+        return shards;
+    }
+    std::size_t target = (total + count - 1) / count;
+
+    // Functions are sorted by their start addresses.
+    Shard shard;
+    std::size_t size = 0;
+    for (std::size_t i = 0; i < get_func_qty(); ++i)
+    {
+        func_t* f = getn_func(i);
+        if (shard.functions == 0)
+        {
+            shard.start = f->start_ea;
+        }
+        shard.end = f->end_ea;
+        ++shard.functions;
+        size += f->size();
+
+        if (size >= target && shards.size() + 1 < count)
+        {
+            shards.push_back(shard);
+            shard = Shard();
+            size = 0;
+        }
+    }
+    if (shard.functions)
+    {
+        shards.push_back(shard);
+    }
+
+    return shards;
+}
+
+//
+//==============================================================================
+// Merging
+//==============================================================================
+//
+
+bool isSectionHeader(const std::string& line, std::string* title)
+{
+    if (line.size() <= 10
+            || line.compare(0, 6, "// ---") != 0
+            || line.compare(line.size() - 3, 3, "---") != 0)
+    {
+        return false;
+    }
+
+    if (title)
+    {
+        auto b = line.find_first_not_of("/- ");
+        auto e = line.find_last_not_of("- ");
+        *title = b == std::string::npos ? "" : line.substr(b, e - b + 1);
+    }
+    return true;
+}
+
+bool isBlank(const std::string& line)
+{
+    return line.find_first_not_of(" \t\r") == std::string::npos;
+}
+
+namespace {
+
+/**
+ * Output section - e.g. "// ------- Function Prototypes -------".
+ */
+struct Section
+{
+    std::string header;
+    /// Top-level items (declarations, definitions, comment lines).
+    std::vector<std::string> items;
+    std::set<std::string> seen;
+
+    /// Meta-information differs among shards (e.g. counts), so it is not
+    /// deduplicated by the whole lines, see mergeMetaInformation().
+    bool isMeta() const
+    {
+        return header.find("Meta-Information") != std::string::npos;
+    }
+
+    void add(const std::string& item)
+    {
+        if (isMeta() || seen.insert(item).second)
+        {
+            items.push_back(item);
+        }
+    }
+};
+
+bool isComment(const std::string& line)
+{
+    auto pos = line.find_first_not_of(" \t");
+    return pos != std::string::npos && line.compare(pos, 2, "//") == 0;
+}
+
+/**
+ * Brace depth change on the line, and its last character which is not
+ * a white space or a part of a comment. String/char literals and comments
+ * are skipped.
+ */
+int scanLine(const std::string& line, char& last)
+{
+    int delta = 0;
+    char quote = 0;
+    last = 0;
+    for (std::size_t i = 0; i < line.size(); ++i)
+    {
+        char c = line[i];
+        if (quote)
+        {
+            if (c == '\\')
+                ++i;
+            else if (c == quote)
+                quote = 0;
+        }
+        else if (c == '"' || c == '\'')
+            quote = c;
+        else if (c == '/' && i + 1 < line.size() && line[i + 1] == '/')
+            break;
+        else if (c == '{')
+            ++delta;
+        else if (c == '}')
+            --delta;
+
+        if (c != ' ' && c != '\t')
+            last = c;
+    }
+    return delta;
+}
+
+/**
+ * Split the output into sections and their top-level items, and add them to
+ * the given sections. Sections new to @p sections are inserted after the
+ * preceding section of this output, so that the original order is kept.
+ */
+void splitOutput(const std::string& output, std::vector<Section>& sections)
+{
+    // Everything before the first header (comments, includes).
+    std::size_t section = 0;
+    if (sections.empty())
+    {
+        sections.emplace_back();
+    }
+
+    std::vector<std::string> pending;
+    int depth = 0;
+
+    auto flush = [&]()
+    {
+        if (pending.empty())
+        {
+            return;
+        }
+        bool comments = std::all_of(pending.begin(), pending.end(), isComment);
+        if (comments && section != 0)
+        {
+            // Stand-alone comments are deduplicated line by line, except
+            // for the file header.
+            for (auto& l : pending)
+            {
+                sections[section].add(l);
+            }
+        }
+        else
+        {
+            std::string item;
+            for (auto& l : pending)
+            {
+                item += l + "\n";
+            }
+            item.pop_back();
+            sections[section].add(item);
+        }
+        pending.clear();
+    };
+
+    std::istringstream ss(output);
+    std::string line;
+    while (std::getline(ss, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (depth == 0 && isSectionHeader(line))
+        {
+            flush();
+            auto it = std::find_if(sections.begin(), sections.end(),
+                    [&line](const Section& s) { return s.header == line; });
+            if (it == sections.end())
+            {
+                it = sections.insert(sections.begin() + section + 1, Section());
+                it->header = line;
+            }
+            section = std::distance(sections.begin(), it);
+            continue;
+        }
+
+        if (depth == 0 && isBlank(line))
+        {
+            flush();
+            continue;
+        }
+
+        pending.push_back(line);
+        char c = 0;
+        depth += scanLine(line, c);
+
+        // Comments preceding a declaration belong to it.
+        if (depth <= 0 && !isComment(line))
+        {
+            if (c == ';' || c == '}' || line[0] == '#')
+            {
+                depth = 0;
+                flush();
+            }
+        }
+    }
+    flush();
+}
+
+/**
+ * Merge "// Key: value" meta-information lines - integer values are summed
+ * (e.g. function counts), the first value is kept otherwise.
+ */
+void mergeMetaInformation(Section& meta)
+{
+    std::vector<std::string> keys;
+    std::map<std::string, std::vector<std::string>> values;
+    std::vector<std::string> other;
+    std::set<std::string> seen;
+
+    for (auto& item : meta.items)
+    {
+        auto colon = item.find(": ");
+        if (item.find('\n') != std::string::npos
+                || !isComment(item)
+                || colon == std::string::npos)
+        {
+            if (seen.insert(item).second)
+            {
+                other.push_back(item);
+            }
+            continue;
+        }
+        std::string key = item.substr(0, colon);
+        if (values.count(key) == 0)
+        {
+            keys.push_back(key);
+        }
+        values[key].push_back(item.substr(colon + 2));
+    }
+
+    meta.items.clear();
+    for (auto& key : keys)
+    {
+        auto& vals = values[key];
+        bool numbers = std::all_of(vals.begin(), vals.end(),
+                [](const std::string& v)
+                {
+                    return !v.empty()
+                            && v.find_first_not_of("0123456789") == std::string::npos;
+                });
+
+        std::string value = vals.front();
+        if (numbers)
+        {
+            unsigned long long sum = 0;
+            for (auto& v : vals)
+            {
+                sum += std::stoull(v);
+            }
+            value = std::to_string(sum);
+        }
+        meta.items.push_back(key + ": " + value);
+    }
+    meta.items.insert(meta.items.end(), other.begin(), other.end());
+}
+
+} // anonymous namespace
+
+std::string mergeShards(const std::vector<Shard>& shards)
+{
+    TRACE_SCOPE("mergeShards");
+    std::vector<Section> sections;
+    for (auto& s : shards)
+    {
+        if (s.status == Shard::Status::DONE)
+        {
+            splitOutput(s.output, sections);
+        }
+    }
+
+    for (auto& s : sections)
+    {
+        if (s.isMeta())
+        {
+            mergeMetaInformation(s);
+        }
+    }
+
+    std::stringstream ss;
+    for (auto& s : sections)
+    {
+        if (s.items.empty())
+        {
+            continue;
+        }
+        if (!s.header.empty())
+        {
+            ss << s.header << "\n\n";
+        }
+        for (std::size_t i = 0; i < s.items.size(); ++i)
+        {
+            ss << s.items[i] << "\n";
+            // Single-line items (prototypes, globals, includes) are kept
+            // together, multi-line items are separated.
+            bool single = s.items[i].find('\n') == std::string::npos;
+            bool nextSingle = i + 1 < s.items.size()
+                    && s.items[i + 1].find('\n') == std::string::npos;
+            if (i + 1 == s.items.size() || !single || !nextSingle)
+            {
+                ss << "\n";
+            }
+        }
+    }
+
+    for (auto& s : shards)
+    {
+        if (s.status == Shard::Status::FAILED)
+        {
+            ss << "// Decompilation of [" << std::hex << std::showbase
+               << s.start << ", " << s.end << ") failed: "
+               << s.error << "\n";
+        }
+    }
+
+    return ss.str();
+}
@@ -0,0 +1,70 @@
+#ifndef RETDEC_SHARDS_H
+#define RETDEC_SHARDS_H
+
+#include <string>
+#include <vector>
+
+#include "utils.h"
+
+/**
+ * Sharded full decompilation.
+ *
+ * The program's functions are partitioned into address-range shards of
+ * roughly the same size. Shards are decompiled as separate selective
+ * decompilations by a pool of workers (see decompileShards()), and their C
+ * outputs are merged into one file - the shared parts (includes, structures,
+ * prototypes, globals, ...) are deduplicated.
+ */
+
+/**
+ * One address-range shard.
+ */
+struct Shard
+{
+    enum class Status
+    {
+        QUEUED,
+        RUNNING,
+        DONE,
+        FAILED,
+    };
+
+    /// Decompiled range [start, end).
+    ea_t start = BADADDR;
+    ea_t end = BADADDR;
+    /// Number of functions in the range.
+    std::size_t functions = 0;
+
+    Status status = Status::QUEUED;
+    /// Decompilation time in seconds.
+    double seconds = 0.0;
+    /// Decompiler (C) output.
+    std::string output;
+    /// Error message, empty on success.
+    std::string error;
+};
+
+/**
+ * Partition the functions in the database into at most @p count shards
+ * with about the same number of bytes.
+ * Must be called from the main thread.
+ */
+std::vector<Shard> createShards(std::size_t count);
+
+/**
+ * Merge C outputs of the decompiled shards into one output.
+ */
+std::string mergeShards(const std::vector<Shard>& shards);
+
+/**
+ * Is the output line a section header, e.g. "// ------- Functions -------"?
+ * Sets @p title (if given) to the section title.
+ */
+bool isSectionHeader(const std::string& line, std::string* title = nullptr);
+
+/**
+ * Is the output line empty or made of white spaces only?
+ */
+bool isBlank(const std::string& line);
+
+#endif
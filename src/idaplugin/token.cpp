@@ -1,14 +1,15 @@
+#include <cstdio>
+#include <cstring>
 #include <map>
 
 #include <lines.hpp>
 #include <pro.h>
 
-#include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
-
-#include <retdec/common/address.h>
+#include <rapidjson/reader.h>
 
 #include "token.h"
+#include "trace.h"
 
 std::map<Token::Kind, std::string> TokenColors =
 {
@@ -60,9 +61,35 @@ std::map<Token::Kind, std::string> TokenKindStrings =
     {Token::Kind::COMMENT, "COMMENT"},
 };
 
+/// Token kinds in the RetDec JSON output.
+std::map<Token::Kind, std::string> TokenJsonKinds =
+{
+    {Token::Kind::NEW_LINE, "nl"},
+    {Token::Kind::WHITE_SPACE, "ws"},
+    {Token::Kind::PUNCTUATION, "punc"},
+    {Token::Kind::OPERATOR, "op"},
+    {Token::Kind::ID_GVAR, "i_gvar"},
+    {Token::Kind::ID_LVAR, "i_lvar"},
+    {Token::Kind::ID_MEM, "i_mem"},
+    {Token::Kind::ID_LAB, "i_lab"},
+    {Token::Kind::ID_FNC, "i_fnc"},
+    {Token::Kind::ID_ARG, "i_arg"},
+    {Token::Kind::KEYWORD, "keyw"},
+    {Token::Kind::TYPE, "type"},
+    {Token::Kind::PREPROCESSOR, "preproc"},
+    {Token::Kind::INCLUDE, "inc"},
+    {Token::Kind::LITERAL_BOOL, "l_bool"},
+    {Token::Kind::LITERAL_INT, "l_int"},
+    {Token::Kind::LITERAL_FP, "l_fp"},
+    {Token::Kind::LITERAL_STR, "l_str"},
+    {Token::Kind::LITERAL_SYM, "l_sym"},
+    {Token::Kind::LITERAL_PTR, "l_ptr"},
+    {Token::Kind::COMMENT, "cmnt"},
+};
+
 Token::Token() {}
 
-Token::Token(Kind k, ea_t a, const std::string& v) : kind(k), ea(a), value(v) {}
+Token::Token(Kind k, ea_t a, std::string v) : kind(k), ea(a), value(std::move(v)) {}
 
 const std::string& Token::getKindString() const
 {
@@ -74,98 +101,341 @@ const std::string& Token::getColorTag() const
     return TokenColors[kind];
 }
 
+const std::string& Token::getColorTag(Kind k)
+{
+    return TokenColors[k];
+}
+
+namespace {
+
+/**
+ * Map RetDec JSON token kind string to token kind.
+ * Returns \c false if the kind is unknown.
+ */
+bool kindFromString(const char* str, rapidjson::SizeType len, Token::Kind& kind)
+{
+    auto is = [str](const char* lit, std::size_t n)
+    {
+        return std::memcmp(str, lit, n) == 0;
+    };
+
+    switch (len)
+    {
+        case 2:
+            if (is("nl", 2)) { kind = Token::Kind::NEW_LINE; return true; }
+            if (is("ws", 2)) { kind = Token::Kind::WHITE_SPACE; return true; }
+            if (is("op", 2)) { kind = Token::Kind::OPERATOR; return true; }
+            return false;
+        case 3:
+            if (is("inc", 3)) { kind = Token::Kind::INCLUDE; return true; }
+            return false;
+        case 4:
+            if (is("punc", 4)) { kind = Token::Kind::PUNCTUATION; return true; }
+            if (is("keyw", 4)) { kind = Token::Kind::KEYWORD; return true; }
+            if (is("type", 4)) { kind = Token::Kind::TYPE; return true; }
+            if (is("l_fp", 4)) { kind = Token::Kind::LITERAL_FP; return true; }
+            if (is("cmnt", 4)) { kind = Token::Kind::COMMENT; return true; }
+            return false;
+        case 5:
+            if (str[0] == 'i' && str[1] == '_')
+            {
+                if (is("i_mem", 5)) { kind = Token::Kind::ID_MEM; return true; }
+                if (is("i_lab", 5)) { kind = Token::Kind::ID_LAB; return true; }
+                if (is("i_fnc", 5)) { kind = Token::Kind::ID_FNC; return true; }
+                if (is("i_arg", 5)) { kind = Token::Kind::ID_ARG; return true; }
+            }
+            else if (str[0] == 'l' && str[1] == '_')
+            {
+                if (is("l_int", 5)) { kind = Token::Kind::LITERAL_INT; return true; }
+                if (is("l_str", 5)) { kind = Token::Kind::LITERAL_STR; return true; }
+                if (is("l_sym", 5)) { kind = Token::Kind::LITERAL_SYM; return true; }
+                if (is("l_ptr", 5)) { kind = Token::Kind::LITERAL_PTR; return true; }
+            }
+            return false;
+        case 6:
+            if (is("i_gvar", 6)) { kind = Token::Kind::ID_GVAR; return true; }
+            if (is("i_lvar", 6)) { kind = Token::Kind::ID_LVAR; return true; }
+            if (is("l_bool", 6)) { kind = Token::Kind::LITERAL_BOOL; return true; }
+            return false;
+        case 7:
+            if (is("preproc", 7)) { kind = Token::Kind::PREPROCESSOR; return true; }
+            return false;
+        default:
+            return false;
+    }
+}
+
+/**
+ * Parse address string - hexadecimal with "0x" prefix, or decimal.
+ * Returns \c false if the string is not a valid address.
+ */
+bool parseAddress(const char* str, rapidjson::SizeType len, ea_t& ea)
+{
+    unsigned base = 10;
+    if (len > 2 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X'))
+    {
+        base = 16;
+        str += 2;
+        len -= 2;
+    }
+    if (len == 0)
+    {
+        return false;
+    }
+
+    ea_t val = 0;
+    for (rapidjson::SizeType i = 0; i < len; ++i)
+    {
+        char c = str[i];
+        unsigned d = 0;
+        if (c >= '0' && c <= '9')
+            d = c - '0';
+        else if (base == 16 && c >= 'a' && c <= 'f')
+            d = c - 'a' + 10;
+        else if (base == 16 && c >= 'A' && c <= 'F')
+            d = c - 'A' + 10;
+        else
+            return false;
+        val = val * base + d;
+    }
+
+    ea = val;
+    return true;
+}
+
+/**
+ * SAX handler building tokens directly from the RetDec JSON output:
+ * { "tokens" : [ { "addr" : "0x..." }, { "kind" : "...", "val" : "..." }, ... ] }
+ */
+class TokenHandler
+        : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, TokenHandler>
+{
+public:
+    TokenHandler(std::vector<Token>& tokens, ea_t defaultEa)
+            : m_tokens(tokens)
+            , m_defaultEa(defaultEa)
+            , m_ea(defaultEa)
+    {
+    }
+
+    bool foundTokens() const
+    {
+        return m_foundTokens;
+    }
+
+    bool StartObject()
+    {
+        ++m_depth;
+        if (m_inTokens && m_depth == tokenDepth)
+        {
+            m_hasKind = false;
+            m_hasVal = false;
+        }
+        return true;
+    }
+
+    bool EndObject(rapidjson::SizeType)
+    {
+        if (m_inTokens && m_depth == tokenDepth && m_hasKind && m_hasVal)
+        {
+            m_tokens.emplace_back(Token(m_kind, m_ea, std::move(m_val)));
+            m_val.clear();
+        }
+        --m_depth;
+        return true;
+    }
+
+    bool StartArray()
+    {
+        if (m_depth == 1 && m_key == Field::TOKENS)
+        {
+            m_inTokens = true;
+            m_foundTokens = true;
+        }
+        ++m_depth;
+        return true;
+    }
+
+    bool EndArray(rapidjson::SizeType)
+    {
+        --m_depth;
+        if (m_depth == 1)
+        {
+            m_inTokens = false;
+        }
+        return true;
+    }
+
+    bool Key(const char* str, rapidjson::SizeType len, bool)
+    {
+        m_key = Field::OTHER;
+        if (m_depth == 1 && len == 6 && std::memcmp(str, "tokens", 6) == 0)
+        {
+            m_key = Field::TOKENS;
+        }
+        else if (m_inTokens && m_depth == tokenDepth)
+        {
+            if (len == 4 && std::memcmp(str, "addr", 4) == 0)
+                m_key = Field::ADDR;
+            else if (len == 4 && std::memcmp(str, "kind", 4) == 0)
+                m_key = Field::KIND;
+            else if (len == 3 && std::memcmp(str, "val", 3) == 0)
+                m_key = Field::VAL;
+        }
+        return true;
+    }
+
+    bool String(const char* str, rapidjson::SizeType len, bool)
+    {
+        if (!m_inTokens || m_depth != tokenDepth)
+        {
+            return true;
+        }
+
+        switch (m_key)
+        {
+            case Field::ADDR:
+                if (!parseAddress(str, len, m_ea))
+                {
+                    m_ea = m_defaultEa;
+                }
+                break;
+            case Field::KIND:
+                m_hasKind = kindFromString(str, len, m_kind);
+                break;
+            case Field::VAL:
+                m_val.assign(str, len);
+                m_hasVal = true;
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+
+private:
+    enum class Field
+    {
+        OTHER,
+        TOKENS,
+        ADDR,
+        KIND,
+        VAL,
+    };
+
+    /// Root object = 1, tokens array = 2, token objects = 3.
+    static const unsigned tokenDepth = 3;
+
+    std::vector<Token>& m_tokens;
+    ea_t m_defaultEa = BADADDR;
+
+    unsigned m_depth = 0;
+    Field m_key = Field::OTHER;
+    bool m_inTokens = false;
+    bool m_foundTokens = false;
+
+    /// Current address - applies to all the following tokens.
+    ea_t m_ea = BADADDR;
+    Token::Kind m_kind = Token::Kind::NEW_LINE;
+    bool m_hasKind = false;
+    std::string m_val;
+    bool m_hasVal = false;
+};
+
+} // anonymous namespace
+
 std::vector<Token> parseTokens(const std::string& json, ea_t defaultEa)
 {
+    TRACE_SCOPE("parseTokens");
     std::vector<Token> res;
+    // Rough estimate of the number of tokens - avoids most reallocations.
+    res.reserve(json.size() / 32);
 
+    TokenHandler handler(res, defaultEa);
     rapidjson::StringStream rss(json.c_str());
-    rapidjson::Document d;
-    rapidjson::ParseResult ok = d.ParseStream(rss);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult ok = reader.Parse(rss, handler);
     if (!ok)
     {
         std::string errMsg = GetParseError_En(ok.Code());
         WARNING_GUI("Unable to parse decompilation output: " << errMsg << std::endl);
+        res.clear();
         return res;
     }
 
-    auto tokens = d.FindMember("tokens");
-    if (tokens == d.MemberEnd() || !tokens->value.IsArray())
+    if (!handler.foundTokens())
     {
         WARNING_GUI("Unable to parse tokens from decompilation output.\n");
         return res;
     }
 
-    ea_t ea = defaultEa;
+    traceCounter("tokens", res.size());
+    return res;
+}
+
+/**
+ * Append the string to @p out as a JSON string literal.
+ */
+void appendJsonString(std::string& out, const std::string& str)
+{
+    static const char hex[] = "0123456789abcdef";
 
-    for (auto i = tokens->value.Begin(), e = tokens->value.End(); i != e; ++i)
+    out += '"';
+    for (char c : str)
     {
-        auto& obj = *i;
-        if (obj.IsNull())
+        switch (c)
         {
-            continue;
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    out += "\\u00";
+                    out += hex[(c >> 4) & 0xf];
+                    out += hex[c & 0xf];
+                }
+                else
+                {
+                    out += c;
+                }
+                break;
         }
+    }
+    out += '"';
+}
 
-        auto addr = obj.FindMember("addr");
-        if (addr != obj.MemberEnd() && addr->value.IsString())
-        {
-            retdec::common::Address a(addr->value.GetString());
-            ea = a.isDefined() ? a.getValue() : defaultEa;
-        }
-        auto kind = obj.FindMember("kind");
-        auto val = obj.FindMember("val");
-        if (kind != obj.MemberEnd() && kind->value.IsString()
-            && val != obj.MemberEnd() && val->value.IsString())
+std::string serializeTokens(const std::vector<Token>& tokens)
+{
+    std::string out;
+    out.reserve(tokens.size() * 32);
+    out += "{\"tokens\":[";
+
+    bool first = true;
+    ea_t ea = BADADDR;
+    char buf[32];
+    for (auto& t : tokens)
+    {
+        if (t.ea != ea || first)
         {
-            Token::Kind kk;
-            std::string k = kind->value.GetString();
-            if (k == "nl")
-                kk = Token::Kind::NEW_LINE;
-            else if (k == "ws")
-                kk = Token::Kind::WHITE_SPACE;
-            else if (k == "punc")
-                kk = Token::Kind::PUNCTUATION;
-            else if (k == "op")
-                kk = Token::Kind::OPERATOR;
-            else if (k == "i_gvar")
-                kk = Token::Kind::ID_GVAR;
-            else if (k == "i_lvar")
-                kk = Token::Kind::ID_LVAR;
-            else if (k == "i_mem")
-                kk = Token::Kind::ID_MEM;
-            else if (k == "i_lab")
-                kk = Token::Kind::ID_LAB;
-            else if (k == "i_fnc")
-                kk = Token::Kind::ID_FNC;
-            else if (k == "i_arg")
-                kk = Token::Kind::ID_ARG;
-            else if (k == "keyw")
-                kk = Token::Kind::KEYWORD;
-            else if (k == "type")
-                kk = Token::Kind::TYPE;
-            else if (k == "preproc")
-                kk = Token::Kind::PREPROCESSOR;
-            else if (k == "inc")
-                kk = Token::Kind::INCLUDE;
-            else if (k == "l_bool")
-                kk = Token::Kind::LITERAL_BOOL;
-            else if (k == "l_int")
-                kk = Token::Kind::LITERAL_INT;
-            else if (k == "l_fp")
-                kk = Token::Kind::LITERAL_FP;
-            else if (k == "l_str")
-                kk = Token::Kind::LITERAL_STR;
-            else if (k == "l_sym")
-                kk = Token::Kind::LITERAL_SYM;
-            else if (k == "l_ptr")
-                kk = Token::Kind::LITERAL_PTR;
-            else if (k == "cmnt")
-                kk = Token::Kind::COMMENT;
-            else
-                continue;
-
-            res.emplace_back(Token(kk, ea, val->value.GetString()));
+            ea = t.ea;
+            std::snprintf(buf, sizeof(buf), "0x%llx", static_cast<unsigned long long>(ea));
+            out += first ? "\n" : ",\n";
+            out += "{\"addr\":\"";
+            out += buf;
+            out += "\"}";
+            first = false;
         }
+
+        out += ",\n{\"kind\":\"";
+        out += TokenJsonKinds[t.kind];
+        out += "\",\"val\":";
+        appendJsonString(out, t.value);
+        out += "}";
     }
 
-    return res;
+    out += "\n]}\n";
+    return out;
 }
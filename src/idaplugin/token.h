@@ -2,6 +2,7 @@
 #define RETDEC_TOKEN_H
 
 #include <string>
+#include <vector>
 
 #include "utils.h"
 
@@ -43,12 +44,19 @@ struct Token
     std::string value;
 
     Token();
-    Token(Kind k, ea_t a, const std::string& v);
+    Token(Kind k, ea_t a, std::string v);
 
     const std::string& getKindString() const;
     const std::string& getColorTag() const;
+    static const std::string& getColorTag(Kind k);
 };
 
 std::vector<Token> parseTokens(const std::string& json, ea_t defaultEa);
 
+/**
+ * Write tokens in the RetDec JSON output format - parseTokens() of the
+ * result gives the same tokens.
+ */
+std::string serializeTokens(const std::vector<Token>& tokens);
+
 #endif
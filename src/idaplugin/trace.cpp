@@ -0,0 +1,361 @@
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include "trace.h"
+
+/**
+ * One recorded interval or counter value.
+ */
+struct TraceEvent
+{
+    const char* name = nullptr;
+    bool counter = false;
+    std::int64_t start = 0;
+    /// Duration of intervals, value of counters.
+    std::int64_t value = 0;
+    unsigned tid = 0;
+};
+
+/**
+ * One run in the ring buffer.
+ */
+struct TraceRunData
+{
+    TraceRunId id = 0;
+    std::string name;
+    /// Not started by the user, see TraceRun::TraceRun().
+    bool background = false;
+    unsigned tid = 0;
+    std::int64_t start = 0;
+    /// End of the run's scope, or of its last event if later.
+    /// -1 while the scope is in progress.
+    std::int64_t end = -1;
+    std::vector<TraceEvent> events;
+};
+
+static const auto traceEpoch = std::chrono::steady_clock::now();
+
+static std::mutex traceMutex;
+static std::deque<TraceRunData> traceRuns;
+static std::deque<TraceRunData> traceBackgroundRuns;
+static TraceRunId lastTraceRun = 0;
+/// Small thread numbers, more readable than the system ids.
+static std::map<std::thread::id, unsigned> traceThreads;
+
+static thread_local TraceRunId traceRun = 0;
+
+/**
+ * traceMutex must be locked.
+ */
+unsigned traceThread()
+{
+    auto id = std::this_thread::get_id();
+    auto it = traceThreads.find(id);
+    if (it == traceThreads.end())
+    {
+        it = traceThreads.emplace(id, unsigned(traceThreads.size()) + 1).first;
+    }
+    return it->second;
+}
+
+/**
+ * traceMutex must be locked.
+ * Returns \c nullptr if the run was already dropped from the ring buffer.
+ */
+TraceRunData* findTraceRun(TraceRunId id)
+{
+    for (auto* runs : {&traceRuns, &traceBackgroundRuns})
+    {
+        for (auto& r : *runs)
+        {
+            if (r.id == id)
+            {
+                return &r;
+            }
+        }
+    }
+    return nullptr;
+}
+
+void recordTraceEvent(TraceEvent e)
+{
+    if (traceRun == 0)
+    {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+    if (auto* r = findTraceRun(traceRun))
+    {
+        e.tid = traceThread();
+        r->events.push_back(e);
+        // Parts running in the background may finish after the run's scope.
+        if (r->end >= 0)
+        {
+            r->end = std::max(r->end, e.start + (e.counter ? 0 : e.value));
+        }
+    }
+}
+
+std::int64_t traceNow()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - traceEpoch).count();
+}
+
+TraceRunId currentTraceRun()
+{
+    return traceRun;
+}
+
+void traceInterval(const char* name, std::int64_t start, std::int64_t end)
+{
+    TraceEvent e;
+    e.name = name;
+    e.start = start;
+    e.value = end - start;
+    recordTraceEvent(e);
+}
+
+void traceCounter(const char* name, std::int64_t value)
+{
+    TraceEvent e;
+    e.name = name;
+    e.counter = true;
+    e.start = traceNow();
+    e.value = value;
+    recordTraceEvent(e);
+}
+
+/**
+ * Escape the string for JSON.
+ */
+std::string traceJsonString(const std::string& str)
+{
+    std::string ret = "\"";
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"': ret += "\\\""; break;
+            case '\\': ret += "\\\\"; break;
+            case '\n': ret += "\\n"; break;
+            case '\t': ret += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) >= 0x20)
+                {
+                    ret += c;
+                }
+                break;
+        }
+    }
+    return ret + "\"";
+}
+
+bool exportTrace(const std::string& path)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        return true;
+    }
+
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    auto sep = [&out, &first]()
+    {
+        out << (first ? "\n" : ",\n");
+        first = false;
+    };
+
+    // Runs started by the user are process 1, background runs process 2.
+    for (int pid : {1, 2})
+    {
+        sep();
+        out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+            << ",\"args\":{\"name\":"
+            << (pid == 1 ? "\"decompilations\"" : "\"background decompilations\"")
+            << "}}";
+    }
+
+    for (auto* runs : {&traceRuns, &traceBackgroundRuns})
+    {
+        for (auto& r : *runs)
+        {
+            int pid = r.background ? 2 : 1;
+            std::int64_t end = r.end >= 0 ? r.end : traceNow();
+            sep();
+            out << "{\"name\":" << traceJsonString(r.name)
+                << ",\"cat\":\"run\",\"ph\":\"X\",\"pid\":" << pid
+                << ",\"tid\":" << r.tid
+                << ",\"ts\":" << r.start
+                << ",\"dur\":" << end - r.start
+                << ",\"args\":{\"run\":" << r.id << "}}";
+
+            for (auto& e : r.events)
+            {
+                sep();
+                out << "{\"name\":" << traceJsonString(e.name)
+                    << ",\"pid\":" << pid << ",\"tid\":" << e.tid
+                    << ",\"ts\":" << e.start;
+                if (e.counter)
+                {
+                    out << ",\"cat\":\"counter\",\"ph\":\"C\""
+                        << ",\"args\":{\"value\":" << e.value << "}}";
+                }
+                else
+                {
+                    out << ",\"cat\":\"stage\",\"ph\":\"X\""
+                        << ",\"dur\":" << e.value
+                        << ",\"args\":{\"run\":" << r.id << "}}";
+                }
+            }
+        }
+    }
+
+    out << "\n]}\n";
+    return !out;
+}
+
+std::string traceSummary()
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    std::stringstream ss;
+    ss.setf(std::ios::fixed);
+    ss.precision(1);
+    for (auto& r : traceRuns)
+    {
+        ss << "#" << r.id << " " << r.name << ": ";
+        if (r.end < 0)
+        {
+            ss << "running";
+        }
+        else
+        {
+            ss << (r.end - r.start) / 1000.0 << " ms";
+        }
+
+        // Stages in the order of their first occurrence, times summed up.
+        // Counters with their last values.
+        std::vector<TraceEvent> stages;
+        for (auto& e : r.events)
+        {
+            auto it = std::find_if(stages.begin(), stages.end(),
+                    [&e](auto& s) { return std::string(s.name) == e.name; });
+            if (it == stages.end())
+            {
+                stages.push_back(e);
+            }
+            else
+            {
+                it->value = e.counter ? e.value : it->value + e.value;
+            }
+        }
+
+        const char* delim = " (";
+        for (auto& s : stages)
+        {
+            ss << delim << s.name << ": ";
+            if (s.counter)
+            {
+                ss << s.value;
+            }
+            else
+            {
+                ss << s.value / 1000.0 << " ms";
+            }
+            delim = ", ";
+        }
+        ss << (stages.empty() ? "" : ")") << "\n";
+    }
+    if (!traceBackgroundRuns.empty())
+    {
+        ss << traceBackgroundRuns.size() << " background runs (lazy, synced, "
+              "prefetch) are only in the exported trace.\n";
+    }
+    return ss.str();
+}
+
+//
+//==============================================================================
+// TraceRun
+//==============================================================================
+//
+
+TraceRun::TraceRun(const std::string& name, bool background)
+        : m_prev(traceRun)
+        , m_start(traceNow())
+{
+    std::lock_guard<std::mutex> lock(traceMutex);
+
+    TraceRunData r;
+    r.id = ++lastTraceRun;
+    r.name = name;
+    r.background = background;
+    r.tid = traceThread();
+    r.start = m_start;
+    auto& runs = background ? traceBackgroundRuns : traceRuns;
+    runs.push_back(std::move(r));
+    while (runs.size() > traceRunCount)
+    {
+        runs.pop_front();
+    }
+
+    traceRun = lastTraceRun;
+}
+
+TraceRun::~TraceRun()
+{
+    {
+        std::lock_guard<std::mutex> lock(traceMutex);
+        if (auto* r = findTraceRun(traceRun))
+        {
+            r->end = std::max(r->end, traceNow());
+        }
+    }
+    traceRun = m_prev;
+}
+
+//
+//==============================================================================
+// TraceRunScope
+//==============================================================================
+//
+
+TraceRunScope::TraceRunScope(TraceRunId run)
+        : m_prev(traceRun)
+{
+    traceRun = run;
+}
+
+TraceRunScope::~TraceRunScope()
+{
+    traceRun = m_prev;
+}
+
+//
+//==============================================================================
+// TraceTimer
+//==============================================================================
+//
+
+TraceTimer::TraceTimer(const char* name)
+        : m_name(name)
+        , m_start(traceNow())
+{
+}
+
+TraceTimer::~TraceTimer()
+{
+    traceInterval(m_name, m_start, traceNow());
+}
@@ -0,0 +1,106 @@
+#ifndef RETDEC_TRACE_H
+#define RETDEC_TRACE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Instrumentation of the decompilation round-trip.
+ *
+ * Timed scopes and counters are recorded into runs - one run is e.g. one
+ * selective or full decompilation, including its parts executed on worker
+ * threads. The last runs are kept in a ring buffer and can be exported in
+ * the Chrome trace event format (chrome://tracing, https://ui.perfetto.dev).
+ * Runs the user did not start (prefetch, lazy and synced decompilations)
+ * happen on every navigation - they have a ring buffer of their own, so that
+ * they do not push the user's runs out.
+ *
+ * Events are recorded only inside runs. Thread-safe.
+ */
+
+/// Run identifier, 0 = no run.
+using TraceRunId = std::size_t;
+
+/// Number of runs kept in each ring buffer.
+constexpr std::size_t traceRunCount = 32;
+
+/// Microseconds since the plugin was loaded.
+std::int64_t traceNow();
+/// Run the current thread records to.
+TraceRunId currentTraceRun();
+
+/// Record a finished interval [@p start, @p end] of the current run.
+void traceInterval(const char* name, std::int64_t start, std::int64_t end);
+/// Record a value of the named counter in the current run.
+void traceCounter(const char* name, std::int64_t value);
+
+/// Export the runs in the ring buffers to a Chrome trace JSON file -
+/// background runs as a separate process.
+/// Returns \c true on error.
+bool exportTrace(const std::string& path);
+/// One line per run started by the user - name and duration of its stages.
+std::string traceSummary();
+
+/**
+ * Starts a new run, which is current on this thread for the lifetime of the
+ * object. The whole lifetime is recorded as the run's top-level interval.
+ */
+class TraceRun
+{
+public:
+    /// @param background The run was not started by the user, it goes to
+    ///                   the background ring buffer.
+    explicit TraceRun(const std::string& name, bool background = false);
+    ~TraceRun();
+
+    TraceRun(const TraceRun&) = delete;
+    TraceRun& operator=(const TraceRun&) = delete;
+
+private:
+    TraceRunId m_prev = 0;
+    std::int64_t m_start = 0;
+};
+
+/**
+ * Makes an existing run current on this thread for the lifetime of the
+ * object - used to attribute work done on worker threads, or in callbacks,
+ * to the run which started it.
+ */
+class TraceRunScope
+{
+public:
+    explicit TraceRunScope(TraceRunId run);
+    ~TraceRunScope();
+
+    TraceRunScope(const TraceRunScope&) = delete;
+    TraceRunScope& operator=(const TraceRunScope&) = delete;
+
+private:
+    TraceRunId m_prev = 0;
+};
+
+/**
+ * Records the lifetime of the object as a named interval of the current run.
+ */
+class TraceTimer
+{
+public:
+    /// @param name Stage name, must be a string literal.
+    explicit TraceTimer(const char* name);
+    ~TraceTimer();
+
+    TraceTimer(const TraceTimer&) = delete;
+    TraceTimer& operator=(const TraceTimer&) = delete;
+
+private:
+    const char* m_name = nullptr;
+    std::int64_t m_start = 0;
+};
+
+#define TRACE_CONCAT_IMPL(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_IMPL(a, b)
+
+/// Time the rest of the enclosing scope as the stage @p name.
+#define TRACE_SCOPE(name) TraceTimer TRACE_CONCAT(traceTimer, __LINE__)(name)
+
+#endif
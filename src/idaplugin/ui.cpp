@@ -1,6 +1,8 @@
+#include "batch.h"
 #include "config.h"
 #include "place.h"
 #include "retdec.h"
+#include "trace.h"
 #include "ui.h"
 #include "utils.h"
 
@@ -23,6 +25,76 @@ action_state_t idaapi fullDecompilation_ah_t::update(action_update_ctx_t*)
     return AST_ENABLE_ALWAYS;
 }
 
+//
+//==============================================================================
+// options_ah_t
+//==============================================================================
+//
+
+options_ah_t::options_ah_t(RetDec& p) : plg(p) {}
+
+int idaapi options_ah_t::activate(action_activation_ctx_t*)
+{
+    Settings old = plg.settings;
+    if (plg.settings.ask(plg.fnc2fnc.statistics()))
+    {
+        plg.fnc2fnc.setBudget(std::size_t(plg.settings.cacheBudgetMb) * 1024 * 1024);
+
+        // Restarting kills the running decompilations - only when needed.
+        if (plg.settings.workerProcesses != old.workerProcesses
+                || plg.settings.workerMemoryMb != old.workerMemoryMb
+                || plg.settings.workerTimeoutSeconds != old.workerTimeoutSeconds)
+        {
+            plg.startWorkers();
+        }
+    }
+    return 0;
+}
+
+action_state_t idaapi options_ah_t::update(action_update_ctx_t*)
+{
+    return AST_ENABLE_ALWAYS;
+}
+
+//
+//==============================================================================
+// exportTrace_ah_t
+//==============================================================================
+//
+
+exportTrace_ah_t::exportTrace_ah_t(RetDec& p) : plg(p) {}
+
+int idaapi exportTrace_ah_t::activate(action_activation_ctx_t*)
+{
+    INFO_MSG("Last decompilations:\n" << traceSummary());
+
+    std::string defaultOut = getInputPath() + ".trace.json";
+    char* out = ask_file(
+            true,
+            defaultOut.data(),
+            "%s",
+            "Save RetDec trace (chrome://tracing)");
+    if (out == nullptr) // canceled
+    {
+        return 0;
+    }
+
+    if (exportTrace(out))
+    {
+        WARNING_GUI("Unable to write the trace file: " << out << "\n");
+    }
+    else
+    {
+        INFO_MSG("Trace saved: " << out << "\n");
+    }
+    return 0;
+}
+
+action_state_t idaapi exportTrace_ah_t::update(action_update_ctx_t*)
+{
+    return AST_ENABLE_ALWAYS;
+}
+
 //
 //==============================================================================
 // jump2asm_ah_t
@@ -56,7 +128,7 @@ int idaapi jump2asm_ah_t::activate(action_activation_ctx_t* ctx)
 
 action_state_t idaapi jump2asm_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -67,13 +139,31 @@ action_state_t idaapi jump2asm_ah_t::update(action_update_ctx_t* ctx)
 
 copy2asm_ah_t::copy2asm_ah_t(RetDec& p) : plg(p) {}
 
-int idaapi copy2asm_ah_t::activate(action_activation_ctx_t*)
+int idaapi copy2asm_ah_t::activate(action_activation_ctx_t* ctx)
 {
+    VERIFY(nullptr != ctx);
+    if (nullptr == ctx)
+    {
+        return 0;
+    }
+
+    // The main viewer, or a pinned one.
+    auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(ctx->widget,
+                                                                        false, // mouse
+                                                                        nullptr, // x
+                                                                        nullptr)); // y
+    auto* fnc = place ? place->getFunction() : nullptr;
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
+    {
+        return 0;
+    }
+
     static const char* text = "Copying pseudocode to disassembly will destroy existing comments.\n"
                               "Do you want to continue?";
     if (ask_yn(ASKBTN_NO, text) == ASKBTN_YES)
     {
-        for (auto& p : plg.m_pFunction->toLines())
+        for (auto& p : fnc->toLines())
         {
             ea_t addr = p.second;
             auto& line = p.first;
@@ -84,16 +174,6 @@ int idaapi copy2asm_ah_t::activate(action_activation_ctx_t*)
         }
 
         // Focus to IDA view.
-        auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(plg.custViewer,
-                                                                            false, // mouse
-                                                                            nullptr, // x
-                                                                            nullptr)); // y
-        VERIFY(nullptr != place);
-        if (nullptr == place)
-        {
-            return 0;
-        }
-
         jumpto(place->toea(), 0, UIJMP_ACTIVATE | UIJMP_IDAVIEW);
     }
 
@@ -102,7 +182,7 @@ int idaapi copy2asm_ah_t::activate(action_activation_ctx_t*)
 
 action_state_t idaapi copy2asm_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -113,9 +193,21 @@ action_state_t idaapi copy2asm_ah_t::update(action_update_ctx_t* ctx)
 
 funcComment_ah_t::funcComment_ah_t(RetDec& p) : plg(p) {}
 
-int idaapi funcComment_ah_t::activate(action_activation_ctx_t*)
+int idaapi funcComment_ah_t::activate(action_activation_ctx_t* ctx)
 {
-    auto* fnc = plg.m_pFunction ? plg.m_pFunction->get_func_t() : nullptr;
+    VERIFY(nullptr != ctx);
+    if (nullptr == ctx)
+    {
+        return 0;
+    }
+
+    // The main viewer, or a pinned one.
+    auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(ctx->widget,
+                                                                        false, // mouse
+                                                                        nullptr, // x
+                                                                        nullptr)); // y
+    auto* pFunction = place ? place->getFunction() : nullptr;
+    auto* fnc = pFunction ? pFunction->get_func_t() : nullptr;
     VERIFY(nullptr != fnc);
     if (fnc == nullptr)
     {
@@ -141,7 +233,7 @@ int idaapi funcComment_ah_t::activate(action_activation_ctx_t*)
 
 action_state_t idaapi funcComment_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -164,9 +256,9 @@ int idaapi renameGlobalObj_ah_t::activate(action_activation_ctx_t* ctx)
                                                                         false, // mouse
                                                                         nullptr, // x
                                                                         nullptr)); // y
-    auto* token = (nullptr != place) ? place->token() : nullptr;
-    VERIFY(nullptr != token);
-    if (token == nullptr)
+    auto token = (nullptr != place) ? place->token() : std::nullopt;
+    VERIFY(token.has_value());
+    if (!token)
     {
         return 0;
     }
@@ -207,14 +299,13 @@ int idaapi renameGlobalObj_ah_t::activate(action_activation_ctx_t* ctx)
 
     std::string oldName = token->value;
     plg.modifyFunctions(token->kind, oldName, newName);
-    fillConfig(plg.config);
 
     return 0;
 }
 
 action_state_t idaapi renameGlobalObj_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -237,9 +328,9 @@ int idaapi openXrefs_ah_t::activate(action_activation_ctx_t* ctx)
                                                                         false, // mouse
                                                                         nullptr, // x
                                                                         nullptr)); // y
-    auto* token = (nullptr != place) ? place->token() : nullptr;
-    VERIFY(nullptr != token);
-    if (token == nullptr)
+    auto token = (nullptr != place) ? place->token() : std::nullopt;
+    VERIFY(token.has_value());
+    if (!token)
     {
         return 0;
     }
@@ -266,7 +357,7 @@ int idaapi openXrefs_ah_t::activate(action_activation_ctx_t* ctx)
 
 action_state_t idaapi openXrefs_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -289,9 +380,9 @@ int idaapi openCalls_ah_t::activate(action_activation_ctx_t* ctx)
                                                                         false, // mouse
                                                                         nullptr, // x
                                                                         nullptr)); // y
-    auto* token = place ? place->token() : nullptr;
-    VERIFY(nullptr != token);
-    if (token == nullptr)
+    auto token = place ? place->token() : std::nullopt;
+    VERIFY(token.has_value());
+    if (!token)
     {
         return 0;
     }
@@ -318,7 +409,7 @@ int idaapi openCalls_ah_t::activate(action_activation_ctx_t* ctx)
 
 action_state_t idaapi openCalls_ah_t::update(action_update_ctx_t* ctx)
 {
-    return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
 //
@@ -341,9 +432,9 @@ int idaapi changeFuncType_ah_t::activate(action_activation_ctx_t* ctx)
                                                                         false, // mouse
                                                                         nullptr, // x
                                                                         nullptr)); // y
-    auto* token = place ? place->token() : nullptr;
-    VERIFY(nullptr != token);
-    if (token == nullptr)
+    auto token = place ? place->token() : std::nullopt;
+    VERIFY(token.has_value());
+    if (!token)
     {
         return 0;
     }
@@ -390,9 +481,144 @@ int idaapi changeFuncType_ah_t::activate(action_activation_ctx_t* ctx)
 
 action_state_t idaapi changeFuncType_ah_t::update(action_update_ctx_t* ctx)
 {
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+}
+
+//
+//==============================================================================
+// cancelDecompilation_ah_t
+//==============================================================================
+//
+
+cancelDecompilation_ah_t::cancelDecompilation_ah_t(RetDec& p) : plg(p) {}
+
+int idaapi cancelDecompilation_ah_t::activate(action_activation_ctx_t* ctx)
+{
+    VERIFY(nullptr != ctx);
+    if (nullptr == ctx)
+    {
+        return 0;
+    }
+
+    // The viewer the menu was invoked in - the main one or a pinned one.
+    auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(ctx->widget,
+                                                                        false, // mouse
+                                                                        nullptr, // x
+                                                                        nullptr)); // y
+    plg.cancelDecompilation(place ? place->getFunction() : nullptr);
+    return 0;
+}
+
+action_state_t idaapi cancelDecompilation_ah_t::update(action_update_ctx_t* ctx)
+{
+    return plg.isCustViewer(ctx->widget) ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+}
+
+//
+//==============================================================================
+// pinViewer_ah_t
+//==============================================================================
+//
+
+pinViewer_ah_t::pinViewer_ah_t(RetDec& p) : plg(p) {}
+
+int idaapi pinViewer_ah_t::activate(action_activation_ctx_t* ctx)
+{
+    VERIFY(nullptr != ctx);
+    if (nullptr == ctx)
+    {
+        return 0;
+    }
+
+    auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(ctx->widget,
+                                                                        false, // mouse
+                                                                        nullptr, // x
+                                                                        nullptr)); // y
+    auto* fnc = place ? place->getFunction() : nullptr;
+    VERIFY(nullptr != fnc);
+    if (nullptr == fnc)
+    {
+        return 0;
+    }
+
+    plg.pinViewer(fnc, place->yx());
+    return 0;
+}
+
+action_state_t idaapi pinViewer_ah_t::update(action_update_ctx_t* ctx)
+{
+    // Pinned viewers are pinned already.
     return ctx->widget == plg.custViewer ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
 }
 
+//
+//==============================================================================
+// batchDecompilation_ah_t
+//==============================================================================
+//
+
+batchDecompilation_ah_t::batchDecompilation_ah_t(RetDec& p) : plg(p) {}
+
+int idaapi batchDecompilation_ah_t::activate(action_activation_ctx_t* ctx)
+{
+    VERIFY(nullptr != ctx);
+    if (nullptr == ctx)
+    {
+        return 0;
+    }
+
+    std::vector<func_t*> fncs;
+    ea_t start = BADADDR;
+    ea_t end = BADADDR;
+    bool neighbourhood = false;
+    if (ctx->widget_type == BWN_FUNCS)
+    {
+        // Functions selected in the Functions window.
+        for (auto i : ctx->chooser_selection)
+        {
+            if (func_t* f = getn_func(i))
+            {
+                fncs.push_back(f);
+            }
+        }
+    }
+    else if (read_range_selection(ctx->widget, &start, &end))
+    {
+        // Functions starting in the selected range.
+        for (func_t* f = get_next_func(start - 1);
+                f != nullptr && f->start_ea < end;
+                f = get_next_func(f->start_ea))
+        {
+            fncs.push_back(f);
+        }
+    }
+    else if (func_t* f = get_func(ctx->cur_ea))
+    {
+        // Function under the cursor and its callees.
+        fncs = getCallNeighbourhood(f);
+        neighbourhood = true;
+    }
+
+    if (fncs.empty())
+    {
+        WARNING_GUI("Select the functions to decompile.\n");
+        return 0;
+    }
+
+    plg.batchDecompilation(fncs, false);
+    if (neighbourhood)
+    {
+        plg.selectiveDecompilationAndDisplay(ctx->cur_ea, false);
+    }
+    return 0;
+}
+
+action_state_t idaapi batchDecompilation_ah_t::update(action_update_ctx_t* ctx)
+{
+    return ctx->widget_type == BWN_FUNCS || ctx->widget_type == BWN_DISASM
+            ? AST_ENABLE_FOR_WIDGET : AST_DISABLE_FOR_WIDGET;
+}
+
 //
 //==============================================================================
 // on_event
@@ -426,11 +652,24 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
             }
 
             VERIFY(nullptr != prd);
-            if ((nullptr == prd) || (view != prd->custViewer && view != prd->codeViewer))
+            if (nullptr == prd)
+            {
+                return 0;
+            }
+
+            auto type = get_widget_type(view);
+            if (type == BWN_FUNCS || type == BWN_DISASM)
             {
+                attach_action_to_popup(view, popup, batchDecompilation_ah_t::actionName);
                 return 0;
             }
 
+            if (!prd->isViewer(view))
+            {
+                return 0;
+            }
+            bool mainViewer = view == prd->custViewer || view == prd->codeViewer;
+
             auto* place = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(view,
                                                                                 false,      // mouse
                                                                                 nullptr,    // x
@@ -441,9 +680,18 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
                 return 0;
             }
 
-            auto* token = place->token();
-            VERIFY(nullptr != token);
-            if (token == nullptr)
+            auto* fnc = place->getFunction();
+            if (fnc != nullptr
+                    && fnc->isPlaceholder()
+                    && prd->decompiler.isPending(fnc->getStart()))
+            {
+                attach_action_to_popup(view, popup, cancelDecompilation_ah_t::actionName);
+                return 0;
+            }
+
+            auto token = place->token();
+            VERIFY(token.has_value());
+            if (!token)
             {
                 return 0;
             }
@@ -455,8 +703,8 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
                 attach_action_to_popup(view, popup, openXrefs_ah_t::actionName);
                 attach_action_to_popup(view, popup, openCalls_ah_t::actionName);
 
-                VERIFY(nullptr != prd->m_pFunction);
-                if ((nullptr != prd->m_pFunction) && (prd->m_pFunction->get_func_t() == tfnc))
+                VERIFY(nullptr != fnc);
+                if ((nullptr != fnc) && (fnc->get_func_t() == tfnc))
                 {
                     attach_action_to_popup(view, popup, changeFuncType_ah_t::actionName);
                 }
@@ -473,6 +721,11 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
             attach_action_to_popup(view, popup, jump2asm_ah_t::actionName);
             attach_action_to_popup(view, popup, copy2asm_ah_t::actionName);
             attach_action_to_popup(view, popup, funcComment_ah_t::actionName);
+            if (mainViewer)
+            {
+                attach_action_to_popup(view, popup, "-");
+                attach_action_to_popup(view, popup, pinViewer_ah_t::actionName);
+            }
 
             break;
         }
@@ -480,27 +733,20 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
 #if IDA_SDK_VERSION >= 750
         case ui_get_lines_rendering_info:
         {
-            auto* demoSyncGroup = get_synced_group(custViewer);
-            if (demoSyncGroup == nullptr)
-            {
-                return 0;
-            }
-
-            auto* demoPlace = dynamic_cast<retdec_place_t*>(get_custom_viewer_place(custViewer,
-                                                                                    false,      // mouse
-                                                                                    nullptr,    // x
-                                                                                    nullptr));  // y
-            if (demoPlace == nullptr)
+            // Called on every repaint of every view - the addresses of the
+            // current line are kept up to date by cv_location_changed().
+            if (nullptr == prd || nullptr == prd->custViewer || prd->syncedEas.empty())
             {
                 return 0;
             }
-            auto eas = demoPlace->fnc()->yx_2_eas(demoPlace->yx());
+            auto& eas = prd->syncedEas;
 
             lines_rendering_output_t* out = va_arg(va, lines_rendering_output_t*);
             TWidget* view = va_arg(va, TWidget*);
             lines_rendering_input_t* info = va_arg(va, lines_rendering_input_t*);
 
-            if (view == nullptr || info->sync_group != demoSyncGroup)
+            if (view == nullptr || info->sync_group == nullptr
+                    || info->sync_group != get_synced_group(prd->custViewer))
             {
                 return 0;
             }
@@ -508,7 +754,7 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
             for (auto& sl : info->sections_lines)
             for (auto& l : sl)
             {
-                if (eas.count(l->at->toea()))
+                if (std::binary_search(eas.begin(), eas.end(), l->at->toea()))
                 {
                     out->entries.push_back(new line_rendering_output_entry_t(
                         l,
@@ -529,16 +775,25 @@ ssize_t idaapi RetDec::on_event(RetDec *prd, int code, va_list va)
             VERIFY(nullptr != view);
             VERIFY(nullptr != prd);
 
-            if ((nullptr == view) || (nullptr == prd) || (view != prd->custViewer && view != prd->codeViewer))
+            if ((nullptr == view) || (nullptr == prd) || !prd->isViewer(view))
             {
                 FUNC_LEAVE("ui_widget_invisible - nullptr");
                 return 0;
             }
 
-            unhook_from_notification_point(HT_UI, retdec_ui_hook_callback, prd);
+            // The hook stays - other viewers (and the popups of the other
+            // widgets) still need it.
+            auto pit = prd->findPinnedViewer(view);
+            if (pit != prd->pinnedViewers.end())
+            {
+                prd->fnc2fnc.release(pit->second.fnc);
+                prd->pinnedViewers.erase(pit);
+                break;
+            }
 
             prd->custViewer = nullptr;
             prd->codeViewer = nullptr;
+            prd->syncedEas.clear();
 
             break;
         }
@@ -613,9 +868,9 @@ bool idaapi cv_double(TWidget* cv, int shift, void* ud)
         return false;
     }
 
-    auto* token = place->token();
-    VERIFY(nullptr != token);
-    if (token == nullptr || token->kind != Token::Kind::ID_FNC)
+    auto token = place->token();
+    VERIFY(token.has_value());
+    if (!token || token->kind != Token::Kind::ID_FNC)
     {
         return false;
     }
@@ -665,7 +920,7 @@ void idaapi cv_location_changed(TWidget* v,
         return;
     }
 
-    if (p_old->getFunction() != p_new->getFunction())
+    if (p_old->getFunctionStart() != p_new->getFunctionStart())
     {
         auto *p_new_fnc = p_new->getFunction();
         VERIFY(nullptr != p_new_fnc);
@@ -676,8 +931,30 @@ void idaapi cv_location_changed(TWidget* v,
 
         retdec_place_t min(p_new_fnc, p_new_fnc->min_yx());
         retdec_place_t max(p_new_fnc, p_new_fnc->max_yx());
-        set_custom_viewer_range(ctx->custViewer, &min, &max);
+        set_custom_viewer_range(v, &min, &max);
+
+        // A pinned viewer moves to another function only through its
+        // history or a sync with the disassembly.
+        auto pit = ctx->pinnedViewers.find(v);
+        if (pit != ctx->pinnedViewers.end())
+        {
+            ctx->fnc2fnc.hold(p_new_fnc->getStart());
+            ctx->fnc2fnc.release(pit->second.fnc);
+            pit->second.fnc = p_new_fnc->getStart();
+            return;
+        }
+
         ctx->m_pFunction = p_new_fnc;
+        ctx->fnc2fnc.pin(p_new_fnc->getStart());
+        ctx->updateSyncedEas(p_new_fnc, p_new->yx());
+    }
+    else if (p_old->y() != p_new->y() && v == ctx->custViewer)
+    {
+        auto *p_new_fnc = p_new->getFunction();
+        if (nullptr != p_new_fnc)
+        {
+            ctx->updateSyncedEas(p_new_fnc, p_new->yx());
+        }
     }
 }
 
@@ -18,6 +18,32 @@ struct fullDecompilation_ah_t : public action_handler_t
     virtual action_state_t idaapi update(action_update_ctx_t*) override;
 };
 
+struct options_ah_t : public action_handler_t
+{
+    inline static const char* actionName = "retdec:ActionOptions";
+    inline static const char* actionLabel = "RetDec options...";
+    inline static const char* actionHotkey = "";
+
+    RetDec& plg;
+    options_ah_t(RetDec& p);
+
+    virtual int idaapi activate(action_activation_ctx_t*) override;
+    virtual action_state_t idaapi update(action_update_ctx_t*) override;
+};
+
+struct exportTrace_ah_t : public action_handler_t
+{
+    inline static const char* actionName = "retdec:ActionExportTrace";
+    inline static const char* actionLabel = "RetDec trace...";
+    inline static const char* actionHotkey = "";
+
+    RetDec& plg;
+    exportTrace_ah_t(RetDec& p);
+
+    virtual int idaapi activate(action_activation_ctx_t*) override;
+    virtual action_state_t idaapi update(action_update_ctx_t*) override;
+};
+
 struct jump2asm_ah_t : public action_handler_t
 {
     inline static const char* actionName = "retdec:ActionJump2Asm";
@@ -109,6 +135,45 @@ struct changeFuncType_ah_t : public action_handler_t
     virtual action_state_t idaapi update(action_update_ctx_t*) override;
 };
 
+struct cancelDecompilation_ah_t : public action_handler_t
+{
+    inline static const char* actionName = "retdec:CancelDecompilation";
+    inline static const char* actionLabel = "Cancel decompilation";
+    inline static const char* actionHotkey = "";
+
+    RetDec& plg;
+    cancelDecompilation_ah_t(RetDec& p);
+
+    virtual int idaapi activate(action_activation_ctx_t*) override;
+    virtual action_state_t idaapi update(action_update_ctx_t*) override;
+};
+
+struct pinViewer_ah_t : public action_handler_t
+{
+    inline static const char* actionName = "retdec:PinViewer";
+    inline static const char* actionLabel = "Pin to a new tab";
+    inline static const char* actionHotkey = "";
+
+    RetDec& plg;
+    pinViewer_ah_t(RetDec& p);
+
+    virtual int idaapi activate(action_activation_ctx_t*) override;
+    virtual action_state_t idaapi update(action_update_ctx_t*) override;
+};
+
+struct batchDecompilation_ah_t : public action_handler_t
+{
+    inline static const char* actionName = "retdec:ActionBatchDecompilation";
+    inline static const char* actionLabel = "Decompile functions RetDec";
+    inline static const char* actionHotkey = "";
+
+    RetDec& plg;
+    batchDecompilation_ah_t(RetDec& p);
+
+    virtual int idaapi activate(action_activation_ctx_t*) override;
+    virtual action_state_t idaapi update(action_update_ctx_t*) override;
+};
+
 bool idaapi cv_double(TWidget* cv, int shift, void* ud);
 void idaapi cv_adjust_place(TWidget* v, lochist_entry_t* loc, void* ud);
 int idaapi cv_get_place_xcoord(
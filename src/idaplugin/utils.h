@@ -2,11 +2,22 @@
 #ifndef RETDEC_UTILS_H
 #define RETDEC_UTILS_H
 
-#include <windows.h>
 #include <string>
 #include <sstream>
 
+#ifdef _WIN32
+#include <windows.h>
+
 #pragma comment(lib, "kernel32.lib")
+#else
+#include <cstdio>
+
+/// There is no debugger output - debug messages go to the standard error.
+inline void OutputDebugStringA(const char* str)
+{
+    std::fputs(str, stderr);
+}
+#endif
 
 // IDA SDK includes.
 //
@@ -48,10 +59,10 @@ enum ida_version_t
 #define PRINT_WARNING true
 #define PRINT_INFO    true
 
-#define VERIFY(x) if (!(x)) { DBG_MSG(__FUNCTION__ " - Verify failed (" #x ")\n"); }
+#define VERIFY(x) if (!(x)) { DBG_MSG(__FUNCTION__ << " - Verify failed (" #x ")\n"); }
 
-#define FUNC_ENTER(...) DBG_MSG(__FUNCTION__ " " __VA_ARGS__ " enter.\n");
-#define FUNC_LEAVE(...) DBG_MSG(__FUNCTION__ " " __VA_ARGS__ " leave.\n");
+#define FUNC_ENTER(...) DBG_MSG(__FUNCTION__ << " " __VA_ARGS__ " enter.\n");
+#define FUNC_LEAVE(...) DBG_MSG(__FUNCTION__ << " " __VA_ARGS__ " leave.\n");
 
 // HTC - do not call IDA msg function in the callback function
 #define DBG_MSG(body)                                                          \
@@ -99,6 +110,7 @@ enum ida_version_t
 
 /**
  * Is the file currently loaded to IDA relocable?
+ * Memoized, see profile.h.
  */
 bool isRelocatable();
 
@@ -110,7 +122,8 @@ bool isX86();
 /**
  * Get full path to the file currently loaded to IDA.
  * Returns empty string if it is unable to get the file.
- * May ask user to specify the file in a GUI dialog.
+ * Never asks the user, see locateInputFile() in profile.h for that.
+ * Memoized, see profile.h.
  */
 std::string getInputPath();
 
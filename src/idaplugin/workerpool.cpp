@@ -0,0 +1,660 @@
+#include <atomic>
+#include <chrono>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+    #include <cerrno>
+    #include <csignal>
+    #include <fcntl.h>
+    #include <pthread.h>
+    #include <sys/resource.h>
+    #include <sys/wait.h>
+    #include <unistd.h>
+#endif
+
+#include "worker/protocol.h"
+
+#include "config.h"
+#include "trace.h"
+#include "workerpool.h"
+
+/**
+ * On Windows, handles are inherited by all the processes created at the same
+ * time - workers must be created one by one, so that they get only their own
+ * pipes.
+ */
+static std::mutex spawnMutex;
+
+#ifdef _WIN32
+
+static bool writeAll(HANDLE h, const void* buff, std::size_t size)
+{
+    auto* p = static_cast<const char*>(buff);
+    while (size)
+    {
+        DWORD n = 0;
+        DWORD chunk = DWORD(std::min<std::size_t>(size, 1 << 20));
+        if (!WriteFile(h, p, chunk, &n, nullptr) || n == 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+static bool readAll(HANDLE h, void* buff, std::size_t size)
+{
+    auto* p = static_cast<char*>(buff);
+    while (size)
+    {
+        DWORD n = 0;
+        DWORD chunk = DWORD(std::min<std::size_t>(size, 1 << 20));
+        if (!ReadFile(h, p, chunk, &n, nullptr) || n == 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+#else
+
+/**
+ * Writing to the pipe of a dead worker raises SIGPIPE, which would kill
+ * IDA. The signal is blocked in the writing thread, and the one raised by
+ * the write is consumed before it is unblocked.
+ */
+static bool writeAll(int fd, const void* buff, std::size_t size)
+{
+    sigset_t pipeSet;
+    sigset_t oldSet;
+    sigemptyset(&pipeSet);
+    sigaddset(&pipeSet, SIGPIPE);
+    pthread_sigmask(SIG_BLOCK, &pipeSet, &oldSet);
+
+    sigset_t pending;
+    sigpending(&pending);
+    bool wasPending = sigismember(&pending, SIGPIPE);
+
+    bool ok = true;
+    auto* p = static_cast<const char*>(buff);
+    while (size)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            ok = false;
+            break;
+        }
+        p += n;
+        size -= n;
+    }
+
+    if (!ok && !wasPending)
+    {
+        sigpending(&pending);
+        if (sigismember(&pending, SIGPIPE))
+        {
+            int sig = 0;
+            sigwait(&pipeSet, &sig);
+        }
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSet, nullptr);
+    return ok;
+}
+
+static bool readAll(int fd, void* buff, std::size_t size)
+{
+    auto* p = static_cast<char*>(buff);
+    while (size)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * Wait at most @p ms milliseconds until the process exits, without reaping
+ * it - its pid must stay valid until kill() reaps it.
+ * Returns \c true if it exited, how is in @p info.
+ */
+static bool waitExited(pid_t pid, unsigned ms, siginfo_t& info)
+{
+    for (unsigned waited = 0; ; waited += 10)
+    {
+        info = siginfo_t();
+        if (waitid(P_PID, id_t(pid), &info, WEXITED | WNOHANG | WNOWAIT) != 0)
+        {
+            return false;
+        }
+        if (info.si_pid == pid)
+        {
+            return true;
+        }
+        if (waited >= ms)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+#endif
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+}
+
+bool WorkerPool::start(
+        const std::string& path,
+        std::size_t count,
+        std::size_t memoryMb,
+        unsigned timeoutSeconds)
+{
+    stop();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_path = path;
+    m_timeoutSeconds = timeoutSeconds;
+
+#ifdef _WIN32
+    // Workers die with IDA, even if it crashes.
+    m_job = CreateJobObjectA(nullptr, nullptr);
+    if (m_job)
+    {
+        JOBOBJECT_EXTENDED_LIMIT_INFORMATION li = {};
+        li.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+        if (memoryMb)
+        {
+            li.BasicLimitInformation.LimitFlags |= JOB_OBJECT_LIMIT_PROCESS_MEMORY;
+            li.ProcessMemoryLimit = SIZE_T(memoryMb) * 1024 * 1024;
+        }
+        SetInformationJobObject(m_job, JobObjectExtendedLimitInformation, &li, sizeof(li));
+    }
+#else
+    // Set in each worker by spawn().
+    m_memoryMb = memoryMb;
+#endif
+
+    for (std::size_t i = 0; i < count; ++i)
+    {
+        auto w = spawn();
+        if (w == nullptr)
+        {
+            break;
+        }
+        m_idle.push_back(std::move(w));
+    }
+    m_count = m_idle.size();
+
+    return m_count == 0;
+}
+
+void WorkerPool::stop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+#ifdef _WIN32
+    if (m_count == 0 && m_job == nullptr)
+#else
+    if (m_count == 0)
+#endif
+    {
+        return;
+    }
+
+    // Running decompilations are killed, their callers get errors.
+    ++m_generation;
+    m_stopping = true;
+    for (auto* w : m_busy)
+    {
+        terminate(*w);
+    }
+    m_cond.notify_all();
+    m_cond.wait(lock, [this] { return m_busy.empty(); });
+
+    for (auto& w : m_idle)
+    {
+        kill(*w);
+    }
+    m_idle.clear();
+    m_count = 0;
+    m_stopping = false;
+
+#ifdef _WIN32
+    if (m_job)
+    {
+        CloseHandle(m_job);
+        m_job = nullptr;
+    }
+#endif
+}
+
+bool WorkerPool::isRunning() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_count != 0 && !m_stopping;
+}
+
+std::size_t WorkerPool::size() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stopping ? 0 : m_count;
+}
+
+#ifdef _WIN32
+
+std::unique_ptr<WorkerPool::Worker> WorkerPool::spawn()
+{
+    std::lock_guard<std::mutex> lock(spawnMutex);
+
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    HANDLE inRead = nullptr;
+    HANDLE inWrite = nullptr;
+    HANDLE outRead = nullptr;
+    HANDLE outWrite = nullptr;
+    if (!CreatePipe(&inRead, &inWrite, &sa, 0))
+    {
+        return nullptr;
+    }
+    if (!CreatePipe(&outRead, &outWrite, &sa, 0))
+    {
+        CloseHandle(inRead);
+        CloseHandle(inWrite);
+        return nullptr;
+    }
+    // Only the worker's ends are inherited.
+    SetHandleInformation(inWrite, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(outRead, HANDLE_FLAG_INHERIT, 0);
+
+    STARTUPINFOA si = {};
+    si.cb = sizeof(si);
+    si.dwFlags = STARTF_USESTDHANDLES;
+    si.hStdInput = inRead;
+    si.hStdOutput = outWrite;
+    si.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+
+    // Suspended until it is in the job - it must not allocate over the limit.
+    PROCESS_INFORMATION pi = {};
+    std::string cmd = "\"" + m_path + "\"";
+    BOOL ok = CreateProcessA(
+            m_path.c_str(),
+            &cmd[0],
+            nullptr,
+            nullptr,
+            TRUE,
+            CREATE_NO_WINDOW | CREATE_SUSPENDED,
+            nullptr,
+            nullptr,
+            &si,
+            &pi);
+    CloseHandle(inRead);
+    CloseHandle(outWrite);
+    if (!ok)
+    {
+        CloseHandle(inWrite);
+        CloseHandle(outRead);
+        return nullptr;
+    }
+
+    if (m_job && !AssignProcessToJobObject(m_job, pi.hProcess))
+    {
+        WARNING_MSG("Decompilation worker is not limited, unable to assign "
+                "it to a job object (error " << GetLastError() << ").\n");
+    }
+    ResumeThread(pi.hThread);
+    CloseHandle(pi.hThread);
+
+    auto w = std::make_unique<Worker>();
+    w->process = pi.hProcess;
+    w->input = inWrite;
+    w->output = outRead;
+    return w;
+}
+
+void WorkerPool::kill(Worker& w)
+{
+    // Closed input stops an idle worker, a busy one must be terminated.
+    CloseHandle(w.input);
+    if (WaitForSingleObject(w.process, 1000) != WAIT_OBJECT_0)
+    {
+        TerminateProcess(w.process, 1);
+    }
+    CloseHandle(w.output);
+    CloseHandle(w.process);
+    w = Worker();
+}
+
+void WorkerPool::terminate(Worker& w)
+{
+    TerminateProcess(w.process, 1);
+}
+
+std::string WorkerPool::exitReason(Worker& w)
+{
+    DWORD code = 0;
+    WaitForSingleObject(w.process, 1000);
+    GetExitCodeProcess(w.process, &code);
+
+    std::stringstream ss;
+    ss << "exit code " << std::hex << std::showbase << code;
+    return ss.str();
+}
+
+#else
+
+std::unique_ptr<WorkerPool::Worker> WorkerPool::spawn()
+{
+    std::lock_guard<std::mutex> lock(spawnMutex);
+
+    int in[2] = { -1, -1 };
+    int out[2] = { -1, -1 };
+    if (pipe(in) != 0)
+    {
+        return nullptr;
+    }
+    if (pipe(out) != 0)
+    {
+        close(in[0]);
+        close(in[1]);
+        return nullptr;
+    }
+    // No end is inherited through exec - the worker gets its ends as the
+    // standard input and output (dup2() clears the flag).
+    for (int fd : {in[0], in[1], out[0], out[1]})
+    {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    // Only async-signal-safe calls are allowed in the child of
+    // a multi-threaded process - everything is prepared before fork().
+    const char* path = m_path.c_str();
+    struct rlimit limit = {};
+    limit.rlim_cur = rlim_t(m_memoryMb) * 1024 * 1024;
+    limit.rlim_max = limit.rlim_cur;
+
+    pid_t pid = fork();
+    if (pid == 0)
+    {
+        if (dup2(in[0], STDIN_FILENO) < 0 || dup2(out[1], STDOUT_FILENO) < 0)
+        {
+            _exit(127);
+        }
+        if (m_memoryMb)
+        {
+            setrlimit(RLIMIT_AS, &limit);
+        }
+        execl(path, path, static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    close(in[0]);
+    close(out[1]);
+    if (pid < 0)
+    {
+        close(in[1]);
+        close(out[0]);
+        return nullptr;
+    }
+
+    auto w = std::make_unique<Worker>();
+    w->process = pid;
+    w->input = in[1];
+    w->output = out[0];
+    return w;
+}
+
+void WorkerPool::kill(Worker& w)
+{
+    // Closed input stops an idle worker, a busy one must be terminated.
+    close(w.input);
+    siginfo_t info;
+    if (!waitExited(w.process, 1000, info))
+    {
+        ::kill(w.process, SIGKILL);
+    }
+    waitpid(w.process, nullptr, 0);
+    close(w.output);
+    w = Worker();
+}
+
+void WorkerPool::terminate(Worker& w)
+{
+    ::kill(w.process, SIGKILL);
+}
+
+std::string WorkerPool::exitReason(Worker& w)
+{
+    siginfo_t info;
+    if (!waitExited(w.process, 1000, info))
+    {
+        return "still running";
+    }
+
+    std::stringstream ss;
+    if (info.si_code == CLD_EXITED)
+    {
+        ss << "exit code " << info.si_status;
+    }
+    else
+    {
+        ss << "signal " << info.si_status;
+    }
+    return ss.str();
+}
+
+#endif
+
+bool WorkerPool::run(
+        Worker& w,
+        const std::string& request,
+        bool wantOutput,
+        std::string* output,
+        std::string& error)
+{
+    // Watchdog - kills the worker when the time limit is exceeded, which
+    // breaks the pipe the decompilation waits on.
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool done = false;
+    std::atomic<bool> timedOut{false};
+    std::thread watchdog;
+    if (m_timeoutSeconds)
+    {
+        watchdog = std::thread([&]()
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (!cond.wait_for(lock, std::chrono::seconds(m_timeoutSeconds), [&] { return done; }))
+            {
+                timedOut = true;
+                terminate(w);
+            }
+        });
+    }
+
+    uint8_t status = WORKER_ERROR;
+    uint32_t size = 0;
+    std::string payload;
+    bool ok = writeAll(w.input, request.data(), request.size())
+            && readAll(w.output, &status, sizeof(status))
+            && readAll(w.output, &size, sizeof(size));
+    if (ok)
+    {
+        payload.resize(size);
+        ok = readAll(w.output, &payload[0], size);
+    }
+
+    if (watchdog.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            done = true;
+        }
+        cond.notify_one();
+        watchdog.join();
+    }
+
+    if (!ok)
+    {
+        std::stringstream ss;
+        ss << "Decompilation exception: ";
+        if (timedOut)
+        {
+            ss << "time limit (" << m_timeoutSeconds << " s) exceeded";
+        }
+        else
+        {
+            ss << "decompilation worker failed (" << exitReason(w)
+               << "), it may have exceeded the memory limit";
+        }
+        error = ss.str();
+        return true;
+    }
+
+    if (status != WORKER_OK)
+    {
+        error = payload;
+    }
+    else if (wantOutput && output)
+    {
+        *output = std::move(payload);
+    }
+    return false;
+}
+
+bool WorkerPool::decompile(
+        const retdec::config::Config& config,
+        std::string* output,
+        std::string* error)
+{
+    std::string request;
+    {
+        TRACE_SCOPE("Config::generateJsonString");
+        std::string json = config.generateJsonString();
+        uint8_t flags = output ? workerRequestOutput : 0;
+        uint32_t size = uint32_t(json.size());
+        request.reserve(sizeof(flags) + sizeof(size) + json.size());
+        request.append(reinterpret_cast<const char*>(&flags), sizeof(flags));
+        request.append(reinterpret_cast<const char*>(&size), sizeof(size));
+        request += json;
+    }
+
+    std::unique_ptr<Worker> w;
+    Worker* busy = nullptr;
+    unsigned generation = 0;
+    {
+        auto waitStart = traceNow();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cond.wait(lock, [this]
+        {
+            return !m_idle.empty() || m_count == 0 || m_stopping;
+        });
+        traceInterval("worker wait", waitStart, traceNow());
+
+        if (m_idle.empty() || m_stopping)
+        {
+            if (error)
+            {
+                *error = "Decompilation exception: no decompilation worker";
+            }
+            return true;
+        }
+        w = std::move(m_idle.back());
+        m_idle.pop_back();
+        busy = w.get();
+        m_busy.push_back(busy);
+        generation = m_generation;
+    }
+
+    std::string err;
+    bool failed = false;
+    {
+        TRACE_SCOPE("worker decompilation");
+        failed = run(*w, request, output != nullptr, output, err);
+    }
+
+    // A failed worker is replaced right away - the pool stays warm.
+    if (failed)
+    {
+        bool stopped = false;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy.erase(std::find(m_busy.begin(), m_busy.end(), busy));
+            stopped = generation != m_generation;
+        }
+        m_cond.notify_all();
+
+        kill(*w);
+        w = stopped ? nullptr : spawn();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!failed)
+        {
+            m_busy.erase(std::find(m_busy.begin(), m_busy.end(), busy));
+        }
+
+        if (generation != m_generation)
+        {
+            // The pool was stopped in the meantime, it does not count this
+            // worker anymore.
+            if (w)
+            {
+                kill(*w);
+            }
+        }
+        else if (w)
+        {
+            m_idle.push_back(std::move(w));
+        }
+        else
+        {
+            --m_count;
+        }
+    }
+    m_cond.notify_all();
+
+    if (!err.empty())
+    {
+        if (error)
+        {
+            *error = err;
+        }
+        return true;
+    }
+    return false;
+}
+
+WorkerPool& getWorkerPool()
+{
+    static WorkerPool pool;
+    return pool;
+}
+
+std::string getWorkerPath()
+{
+    return (getDecompilerConfigPath().parent_path() / workerExecutableName).string();
+}
@@ -0,0 +1,138 @@
+#ifndef RETDEC_WORKERPOOL_H
+#define RETDEC_WORKERPOOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+    #include <sys/types.h>
+#endif
+
+#include <retdec/config/config.h>
+
+#include "utils.h"
+
+/**
+ * Pool of decompilation worker processes (see worker/protocol.h).
+ *
+ * RetDec runs out of the IDA process - its crashes and runaway memory use
+ * take down only the worker, which is then replaced. The workers are started
+ * in advance and reused, so a decompilation does not pay for a process
+ * start. Unlike in-process decompilations, which are serialized (RetDec is
+ * not reentrant), the workers decompile in parallel.
+ *
+ * Each worker is limited to the given memory - on Windows, all the workers
+ * are in one job object, which also kills them with IDA; elsewhere, the
+ * address space of the worker is limited (setrlimit), and workers exit when
+ * their input is closed with IDA. A decompilation running longer than the
+ * time limit is killed.
+ */
+class WorkerPool
+{
+public:
+    ~WorkerPool();
+
+    /// Start @p count workers of the executable @p path.
+    /// @param memoryMb Memory limit of each worker (MB), 0 = unlimited.
+    /// @param timeoutSeconds Time limit of each decompilation, 0 = unlimited.
+    /// Returns \c true if something went wrong (no worker started).
+    bool start(
+            const std::string& path,
+            std::size_t count,
+            std::size_t memoryMb,
+            unsigned timeoutSeconds);
+    /// Stop all the workers. The running decompilations are killed (their
+    /// callers get errors), waits until their calls return.
+    void stop();
+    /// Are there any workers?
+    bool isRunning() const;
+    /// Number of workers.
+    std::size_t size() const;
+
+    /// Decompile @p config in a free worker - waits for one if all of them
+    /// are busy. Safe to call from any thread, calls from several threads
+    /// run in parallel.
+    /// @param output If not null, the decompiler output is stored here.
+    ///               Otherwise it is written to the output file in the
+    ///               config.
+    /// @param error  If not null, error message is stored here on failure.
+    /// @return \c true if something went wrong.
+    bool decompile(
+            const retdec::config::Config& config,
+            std::string* output = nullptr,
+            std::string* error = nullptr);
+
+private:
+    struct Worker
+    {
+#ifdef _WIN32
+        HANDLE process = nullptr;
+        /// Write end of the worker's standard input.
+        HANDLE input = nullptr;
+        /// Read end of the worker's standard output.
+        HANDLE output = nullptr;
+#else
+        pid_t process = -1;
+        /// Write end of the worker's standard input.
+        int input = -1;
+        /// Read end of the worker's standard output.
+        int output = -1;
+#endif
+    };
+
+    /// Start a worker. Returns \c nullptr if it fails.
+    std::unique_ptr<Worker> spawn();
+    /// Kill the worker and close its handles.
+    static void kill(Worker& w);
+    /// Terminate the worker right away, its handles stay open.
+    static void terminate(Worker& w);
+    /// How the failed worker ended - waits for it a while.
+    static std::string exitReason(Worker& w);
+    /// Run one request in the worker. Returns \c true if the worker failed
+    /// (it must not be reused), the decompilation error is in @p error.
+    bool run(
+            Worker& w,
+            const std::string& request,
+            bool wantOutput,
+            std::string* output,
+            std::string& error);
+
+private:
+    mutable std::mutex m_mutex;
+    std::condition_variable m_cond;
+    /// Workers waiting for a decompilation.
+    std::vector<std::unique_ptr<Worker>> m_idle;
+    /// Workers running a decompilation.
+    std::vector<Worker*> m_busy;
+    /// Number of workers (idle + busy).
+    std::size_t m_count = 0;
+    /// stop() killed the busy workers and waits until their calls return.
+    bool m_stopping = false;
+    /// Incremented by stop() - workers of a stopped pool are not returned.
+    unsigned m_generation = 0;
+
+    std::string m_path;
+    unsigned m_timeoutSeconds = 0;
+#ifdef _WIN32
+    HANDLE m_job = nullptr;
+#else
+    std::size_t m_memoryMb = 0;
+#endif
+};
+
+/**
+ * Worker pool used by runDecompilation() - decompilations run in-process if
+ * it is not running.
+ */
+WorkerPool& getWorkerPool();
+
+/**
+ * Path to the worker executable, next to decompiler-config.json.
+ */
+std::string getWorkerPath();
+
+#endif
@@ -0,0 +1,118 @@
+/**
+ * Decompilation worker process - decompiles configs sent by the plugin,
+ * see protocol.h. Runs RetDec out of the IDA process, so that its crashes
+ * and memory use do not take IDA down.
+ */
+
+#include <cstdio>
+#include <string>
+
+#ifdef _WIN32
+    #include <fcntl.h>
+    #include <io.h>
+    #define dup _dup
+    #define dup2 _dup2
+    #define fdopen _fdopen
+    #define fileno _fileno
+#else
+    #include <unistd.h>
+#endif
+
+#include <retdec/config/config.h>
+#include <retdec/retdec/retdec.h>
+
+#include "protocol.h"
+
+/**
+ * Responses - the original standard output. RetDec's own messages go to
+ * the standard error, they must not get mixed with the responses.
+ */
+static FILE* responses = nullptr;
+
+static bool readBytes(void* buff, std::size_t size)
+{
+    return std::fread(buff, 1, size, stdin) == size;
+}
+
+static bool writeBytes(const void* buff, std::size_t size)
+{
+    return std::fwrite(buff, 1, size, responses) == size;
+}
+
+static bool respond(WorkerStatus status, const std::string& payload)
+{
+    uint8_t s = status;
+    uint32_t size = uint32_t(payload.size());
+    return writeBytes(&s, sizeof(s))
+            && writeBytes(&size, sizeof(size))
+            && writeBytes(payload.data(), payload.size())
+            && std::fflush(responses) == 0;
+}
+
+int main()
+{
+#ifdef _WIN32
+    _setmode(fileno(stdin), _O_BINARY);
+    _setmode(fileno(stdout), _O_BINARY);
+#endif
+
+    std::fflush(stdout);
+    int out = dup(fileno(stdout));
+    if (out < 0 || dup2(fileno(stderr), fileno(stdout)) < 0)
+    {
+        return 1;
+    }
+    responses = fdopen(out, "wb");
+    if (responses == nullptr)
+    {
+        return 1;
+    }
+
+    while (true)
+    {
+        uint8_t flags = 0;
+        uint32_t size = 0;
+        if (!readBytes(&flags, sizeof(flags)) || !readBytes(&size, sizeof(size)))
+        {
+            // Input closed - the plugin stops the worker.
+            return 0;
+        }
+
+        std::string json(size, '\0');
+        if (!readBytes(&json[0], size))
+        {
+            return 1;
+        }
+
+        std::string output;
+        std::string error;
+        try
+        {
+            auto config = retdec::config::Config::fromJsonString(json);
+            auto rc = retdec::decompile(
+                    config,
+                    (flags & workerRequestOutput) ? &output : nullptr);
+            if (rc != 0)
+            {
+                error = "Decompilation exception: decompilation error code = "
+                        + std::to_string(rc);
+            }
+        }
+        catch (const std::exception& e)
+        {
+            error = std::string("Decompilation exception: ") + e.what();
+        }
+        catch (...)
+        {
+            error = "Decompilation exception: unknown";
+        }
+
+        bool ok = error.empty()
+                ? respond(WORKER_OK, output)
+                : respond(WORKER_ERROR, error);
+        if (!ok)
+        {
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef RETDEC_WORKER_PROTOCOL_H
+#define RETDEC_WORKER_PROTOCOL_H
+
+#include <cstdint>
+
+/**
+ * Protocol of the decompilation worker process (retdec-idaplugin-worker).
+ *
+ * The plugin writes requests to the worker's standard input, the worker
+ * writes a response to its standard output for each of them, in order.
+ * The worker decompiles requests until its input is closed.
+ *
+ * Request:  uint8_t flags, uint32_t size, config JSON (size bytes).
+ * Response: uint8_t status, uint32_t size, output or error message.
+ *
+ * Integers are in the native byte order - both ends run on the same machine.
+ */
+
+/// Return the output in the response. Otherwise RetDec writes it to the
+/// output file set in the config.
+constexpr uint8_t workerRequestOutput = 0x01;
+
+/// Response status.
+enum WorkerStatus : uint8_t
+{
+    WORKER_OK = 0,
+    WORKER_ERROR = 1,
+};
+
+/// Name of the worker executable - installed next to decompiler-config.json.
+#ifdef _WIN32
+constexpr const char* workerExecutableName = "retdec-idaplugin-worker.exe";
+#else
+constexpr const char* workerExecutableName = "retdec-idaplugin-worker";
+#endif
+
+#endif